@@ -0,0 +1,141 @@
+#pragma once
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include "../../Common/main.hpp"
+#include "../../Common/board.hpp"
+#include "../../Common/play_event.hpp"
+#include "../../Common/game_archive.hpp"
+#include "../../2048Server/src/stats.hpp"
+
+/**!
+    \ingroup analyzer
+    \brief Statistics of players computed by replaying their archived games.
+
+    Each worker thread maps games into its own analysis by \ref add, analyses of all workers are then
+    reduced by \ref merge. Games are replayed by the same \ref board as on the server, and turned into
+    \ref stats the same way as \ref player_data::play does, so the result is comparable with stats_global.
+    Statistics of a player are combined by \ref stats::combine with the rules of \ref sql_connection::save_stats,
+    which makes the reduction independent of order of games and workers. Only stats::TOTAL_TIME_PLAYED,
+    which the server measures by sessions, cannot be computed from games and stays 0.
+*/
+class game_analysis
+{
+    public:
+        using players_t = std::unordered_map<std::uint32_t, stats::container_t>; //!< Statistics of each player.
+
+        game_analysis() : m_games(0), m_moves(0), m_corrupted(0), m_mismatched(0) { }
+
+        //! Replays the game and adds its statistics to its player.
+        //! \param rec the game.
+        void add(const game_archive::record& rec)
+        {
+            if (!game_archive::start(rec, m_board))
+            {
+                ++m_corrupted;
+                return;
+            }
+
+            stats game;
+            if (!(rec.flags & game_archive::RESUMED))
+                game.restart();
+            // Server counts a win after every move of a won game at its current time, so the fastest is the time
+            // of the win and the slowest is the time of the last move. A won game is never counted as lost.
+            std::chrono::duration<long long> won_at(rec.won_at), duration(rec.duration);
+            bool won = false;
+            for (std::uint32_t i = 0; i < rec.moves; ++i)
+            {
+                play_event event;
+                if (!m_board.play(rec.move(i), &event))
+                    continue;
+                for (const auto& oper : event)
+                {
+                    if (oper.first == play_event::MOVE)
+                    {
+                        game.move();
+                        continue;
+                    }
+                    game.merge();
+                    game.maximal_block(m_board.rects()[oper.second.second.first][oper.second.second.second]);
+                }
+                game.play(rec.move(i));
+                game.score(event.score());
+                game.highest_score(m_board.score());
+                if (m_board.won())
+                {
+                    game.won(won ? duration : won_at);
+                    won = true;
+                }
+                else if (m_board.is_game_over())
+                    game.game_over(duration);
+            }
+            game.update_time_played(0);
+
+            if (!game_archive::finished(rec, m_board))
+            {
+                ++m_mismatched;
+                return;
+            }
+            ++m_games;
+            m_moves += rec.moves;
+            stats::container_t& player = m_players[rec.player];
+            if (player.empty())
+                player = game.get_impl();
+            else
+                stats::combine(player, game.get_impl());
+        }
+
+        //! Merges statistics of another analysis into this one.
+        //! \param other the analysis.
+        void merge(const game_analysis& other)
+        {
+            for (const auto& item : other.m_players)
+            {
+                stats::container_t& player = m_players[item.first];
+                if (player.empty())
+                    player = item.second;
+                else
+                    stats::combine(player, item.second);
+            }
+            m_games += other.m_games;
+            m_moves += other.m_moves;
+            m_corrupted += other.m_corrupted;
+            m_mismatched += other.m_mismatched;
+        }
+
+        //! Combines statistics of all players.
+        //! \return statistics of the whole server.
+        stats::container_t global() const
+        {
+            stats::container_t res(stats::MAX_STATS, 0);
+            for (const auto& item : m_players)
+                stats::combine(res, item.second);
+            return res;
+        }
+
+        //! Getter for \ref m_players.
+        //! \return statistics of each player.
+        const players_t& players() const { return m_players; }
+        //! Getter for \ref m_games.
+        //! \return number of analysed games.
+        std::uint64_t games() const { return m_games; }
+        //! Getter for \ref m_moves.
+        //! \return number of replayed moves of analysed games.
+        std::uint64_t moves() const { return m_moves; }
+        //! Getter for \ref m_corrupted.
+        //! \return number of games, which could not be decoded.
+        std::uint64_t corrupted() const { return m_corrupted; }
+        //! Counts corrupted record, which was not passed to \ref add.
+        void add_corrupted() { ++m_corrupted; }
+        //! Getter for \ref m_mismatched.
+        //! \return number of games, whose replay did not end as recorded.
+        std::uint64_t mismatched() const { return m_mismatched; }
+
+    private:
+        board m_board; //!< Board to replay games on, reused by all games of the worker.
+        players_t m_players; //!< Statistics of each player.
+        std::uint64_t m_games; //!< Analysed games.
+        std::uint64_t m_moves; //!< Replayed moves of analysed games.
+        std::uint64_t m_corrupted; //!< Games, which could not be decoded.
+        std::uint64_t m_mismatched; //!< Games, whose replay did not end as recorded.
+};
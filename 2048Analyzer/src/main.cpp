@@ -0,0 +1,287 @@
+/** \defgroup analyzer Parallel analysis of archived games. */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "../../Common/main.hpp"
+#include "../../Common/game_archive.hpp"
+#include "game_analysis.hpp"
+
+namespace
+{
+    const std::size_t CHUNK = 4096; //!< Games taken by a worker at once.
+    const std::size_t PRINTED_DIFFERENCES = 20; //!< Differences printed by \ref check.
+
+    //! Prints usage of the program.
+    void usage(const char* name)
+    {
+        std::cerr << "Usage: " << name << " [options] archive_dir" << std::endl
+                  << "  -o FILE    bulk file of per-player stats (stats_global.txt)" << std::endl
+                  << "  -j N       worker threads (number of cores)" << std::endl
+                  << "  -c FILE    compare with dump of stats_global (player_id, stats_id, value separated by tabs)" << std::endl
+                  << "  -p ID      only list games of the player" << std::endl
+                  << "  -t FROM-TO only list games, which ended in range of unix times (TO excluded)" << std::endl
+                  << "  -g S:I     only replay game I of segment S and print its final board" << std::endl;
+    }
+
+    //! Compares computed statistics with stats of the server, except stats::TOTAL_TIME_PLAYED, which is not computed.
+    //! Players missing on either side have zero statistics.
+    //! \param result the analysis.
+    //! \param path dump of stats_global, e.g. by <em>mysql -B -N -e "SELECT player_id, stats_id, value FROM stats_global"</em>.
+    //! \return number of differing values.
+    //! \throws std::runtime_error if the dump can not be read.
+    std::size_t check(const game_analysis& result, const std::string& path)
+    {
+        std::ifstream in(path);
+        if (!in)
+            throw std::runtime_error("Failed to open '" + path + "'.");
+        std::map<std::uint32_t, stats::container_t> expected;
+        std::uint32_t player;
+        std::size_t id;
+        long long value;
+        while (in >> player >> id >> value)
+        {
+            stats::container_t& values = expected[player];
+            if (values.empty())
+                values.assign(stats::MAX_STATS, 0);
+            if (id < stats::MAX_STATS)
+                values[id] = value;
+        }
+        if (!in.eof())
+            throw std::runtime_error("'" + path + "' is not a dump of stats_global.");
+        for (const auto& item : result.players())
+            if (expected.find(item.first) == expected.end())
+                expected[item.first].assign(stats::MAX_STATS, 0);
+
+        const stats::container_t none(stats::MAX_STATS, 0);
+        std::size_t differences = 0;
+        for (const auto& item : expected)
+        {
+            auto it = result.players().find(item.first);
+            const stats::container_t& replayed = it != result.players().end() ? it->second : none;
+            for (std::size_t i = 0; i < stats::MAX_STATS; ++i)
+                if (i != stats::TOTAL_TIME_PLAYED && replayed[i] != item.second[i] && ++differences <= PRINTED_DIFFERENCES)
+                    std::cout << "player " << item.first << ": " << stats::name(static_cast<stats::StatTypes>(i))
+                              << " is " << item.second[i] << ", replayed " << replayed[i] << std::endl;
+        }
+        return differences;
+    }
+
+    //! Prints one line of game listing.
+    //! \param loc location of the game.
+    //! \param entry index entry of the game.
+    //! \param rec the game.
+    void print_game(const game_archive::location& loc, const game_archive::index_entry& entry, const game_archive::record& rec)
+    {
+        std::cout << loc.segment << ':' << loc.index << "\tplayer " << rec.player << "\tended " << entry.time << "\tduration " << rec.duration
+                  << "s\tmoves " << rec.moves << "\tscore " << rec.final_score << "\tmax block " << (1 << rec.max_block)
+                  << ((rec.flags & game_archive::RESUMED) ? "\tresumed" : "") << ((rec.flags & game_archive::WON) ? "\twon" : "")
+                  << ((rec.flags & game_archive::LOST) ? "\tlost" : "") << std::endl;
+    }
+
+    //! Lists games of the archive.
+    //! \param reader the archive.
+    //! \param games locations of the games.
+    //! \return true if all games were decoded, false otherwise.
+    bool list(archive_reader& reader, const std::vector<game_archive::location>& games)
+    {
+        bool res = true;
+        game_archive::record rec;
+        for (const auto& loc : games)
+        {
+            if (reader.get(loc, rec))
+                print_game(loc, reader.segment(loc.segment).entry(loc.index), rec);
+            else
+            {
+                std::cout << loc.segment << ':' << loc.index << "\tcorrupted" << std::endl;
+                res = false;
+            }
+        }
+        std::cout << games.size() << " games." << std::endl;
+        return res;
+    }
+
+    //! Replays single game and prints its final board.
+    //! \param reader the archive.
+    //! \param loc location of the game.
+    //! \return true if the replay ended as recorded, false otherwise.
+    bool replay(archive_reader& reader, const game_archive::location& loc)
+    {
+        game_archive::record rec;
+        if (loc.segment < 1 || loc.segment > reader.segments() || loc.index >= reader.segment(loc.segment).size())
+            throw std::runtime_error("There is no game " + std::to_string(loc.segment) + ":" + std::to_string(loc.index) + ".");
+        if (!reader.get(loc, rec))
+        {
+            std::cout << "Game is corrupted." << std::endl;
+            return false;
+        }
+        print_game(loc, reader.segment(loc.segment).entry(loc.index), rec);
+        board b;
+        bool matched = game_archive::replay(rec, b);
+        for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
+        {
+            for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
+                std::cout << std::setw(6) << (b.rects()[x][y] ? 1 << b.rects()[x][y] : 0);
+            std::cout << std::endl;
+        }
+        std::cout << "Score " << b.score() << (matched ? ", replay ended as recorded." : ", replay did not end as recorded.") << std::endl;
+        return matched;
+    }
+
+    //! Analyses one segment by all workers. Workers take chunks of games, so the segment is shared evenly.
+    //! \param segment the segment.
+    //! \param workers analyses of the workers, one per thread.
+    void analyse(const archive_segment& segment, std::vector<game_analysis>& workers)
+    {
+        std::atomic<std::size_t> next(0);
+        std::vector<std::thread> threads;
+        for (auto& worker : workers)
+            threads.emplace_back([&segment, &worker, &next]()
+            {
+                game_archive::record rec;
+                std::size_t begin;
+                while ((begin = next.fetch_add(CHUNK)) < segment.size())
+                    for (std::size_t i = begin; i < std::min(begin + CHUNK, segment.size()); ++i)
+                    {
+                        if (segment.get(i, rec))
+                            worker.add(rec);
+                        else
+                            worker.add_corrupted();
+                    }
+            });
+        for (auto& thread : threads)
+            thread.join();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string output = "stats_global.txt", expected;
+    char lookup = 0;
+    std::uint64_t from = 0, to = 0;
+    game_archive::location game{ 0, 0 };
+
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc)
+        {
+            std::string val = argv[++i];
+            try
+            {
+                switch (arg[1])
+                {
+                    case 'o': output = val; break;
+                    case 'c': expected = val; break;
+                    case 'j': threads = std::max<std::size_t>(1, std::stoul(val)); break;
+                    case 'p': from = std::stoul(val); lookup = 'p'; break;
+                    case 't':
+                        if (val.find('-') == std::string::npos)
+                            throw std::invalid_argument("range");
+                        from = std::stoull(val);
+                        to = std::stoull(val.substr(val.find('-') + 1));
+                        lookup = 't';
+                        break;
+                    case 'g': game.segment = std::stoul(val); game.index = std::stoul(val.substr(val.find(':') + 1)); lookup = 'g'; break;
+                    default: usage(argv[0]); return EXIT_FAILURE;
+                }
+            }
+            catch (std::exception&)
+            {
+                std::cerr << "Invalid value '" << val << "' of " << arg << "." << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg[0] == '-')
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else
+            positional.push_back(arg);
+    }
+    if (positional.size() != 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        if (lookup)
+        {
+            archive_reader reader(positional[0]);
+            bool ok = lookup == 'g' ? replay(reader, game)
+                : list(reader, lookup == 'p' ? reader.by_player(static_cast<std::uint32_t>(from)) : reader.by_time(from, to));
+            return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        std::uint32_t segments = archive_reader(positional[0]).segments();
+        std::cout << "Analysing " << segments << " segments of '" << positional[0] << "' by " << threads << " threads." << std::endl;
+
+        // Segments are streamed, only the analysed one is mapped and its pages are released when it is unmapped.
+        auto start = std::chrono::steady_clock::now();
+        std::vector<game_analysis> workers(threads);
+        for (std::uint32_t s = 1; s <= segments; ++s)
+            analyse(archive_segment(positional[0], s), workers);
+
+        game_analysis result;
+        for (const auto& worker : workers)
+            result.merge(worker);
+        double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::ofstream out(output);
+        if (!out)
+            throw std::runtime_error("Failed to create '" + output + "'.");
+        std::vector<std::uint32_t> players;
+        for (const auto& item : result.players())
+            players.push_back(item.first);
+        std::sort(players.begin(), players.end());
+        for (std::uint32_t player : players)
+        {
+            const stats::container_t& values = result.players().at(player);
+            for (std::size_t i = 0; i < values.size(); ++i)
+                if (i != stats::TOTAL_TIME_PLAYED) // not computed, loading the file keeps it
+                    out << player << '\t' << i << '\t' << values[i] << '\n';
+        }
+        out.close();
+        if (out.fail())
+            throw std::runtime_error("Failed to write '" + output + "'.");
+
+        std::cout << std::endl << "Games: " << result.games() << " replayed, " << result.mismatched() << " mismatched, " << result.corrupted() << " corrupted." << std::endl
+                  << "Moves: " << result.moves() << " in " << std::fixed << std::setprecision(2) << total << "s ("
+                  << std::setprecision(0) << result.games() / total << " games/s, " << result.moves() / total << " moves/s)." << std::endl
+                  << "Players: " << players.size() << ", written into '" << output << "'." << std::endl << std::endl;
+        stats::container_t global = result.global();
+        for (std::size_t i = 0; i < global.size(); ++i)
+            if (i != stats::TOTAL_TIME_PLAYED)
+                std::cout << std::left << std::setw(28) << stats::name(static_cast<stats::StatTypes>(i)) << std::right << " " << global[i] << std::endl;
+
+        if (!expected.empty())
+        {
+            std::cout << std::endl << "Comparing with '" << expected << "':" << std::endl;
+            std::size_t differences = check(result, expected);
+            std::cout << differences << " differences." << std::endl;
+            if (differences)
+                return EXIT_FAILURE;
+        }
+        if (result.mismatched() || result.corrupted())
+            return EXIT_FAILURE;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
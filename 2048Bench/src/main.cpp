@@ -0,0 +1,206 @@
+/** \defgroup bench Headless benchmark of client rendering. */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <random>
+#include <cstdlib>
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <boost/asio.hpp>
+#include "../../Common/main.hpp"
+#include "../../Common/board.hpp"
+#include "../../Common/histogram.hpp"
+#include "../../2048Client/src/client.hpp"
+#include "../../2048Client/src/2048Game/Program/Program.hpp"
+#include "../../2048Client/src/2048Game/Game/Game.hpp"
+#include "../../2048Client/src/2048Game/Window/GameWindow.hpp"
+using boost::asio::ip::tcp;
+
+namespace
+{
+    std::atomic<unsigned long long> allocations(0); //!< Number of calls of operator new.
+
+    //! Prints usage of the program.
+    void usage(const char* name)
+    {
+        std::cerr << "Usage: " << name << " [options]" << std::endl
+                  << "  -d SEC     duration of the benchmark (10)" << std::endl
+                  << "  -t MS      time between scripted turns, 0 plays a turn every frame (100)" << std::endl
+                  << "  -s SEED    seed of scripted turns and spawned blocks (1)" << std::endl
+                  << "  -p 0|1     draw the profiler overlay (0)" << std::endl;
+    }
+
+    //! Plays one scripted turn on the board.
+    //! \param b board to play on, it is restarted when the game is over.
+    //! \param random generator of directions.
+    //! \param game game, which receives the turn as if the server responded.
+    void scripted_turn(board& b, std::mt19937& random, Game& game)
+    {
+        if (b.is_game_over())
+        {
+            game.apply_restart(b.restart());
+            return;
+        }
+
+        play_event event;
+        Directions first = (Directions) (random() % 4);
+        for (int i = 0; i < 4 && !event.played(); ++i)
+            b.play((Directions) ((first + i) % 4), &event);
+        game.apply_play(event);
+    }
+
+    //! Prints one line of frame phase report.
+    void report_phase(const char* name, double total_ms, std::size_t frames)
+    {
+        std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(9) << total_ms / frames << " ms/frame" << std::endl;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* res = std::malloc(size ? size : 1))
+        return res;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+int main(int argc, char* argv[])
+{
+    long long duration = 10, turn_ms = 100;
+    unsigned seed = 1;
+    bool overlay = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.size() != 2 || arg[0] != '-' || i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        std::string val = argv[++i];
+        try
+        {
+            switch (arg[1])
+            {
+                case 'd': duration = std::stoll(val); break;
+                case 't': turn_ms = std::stoll(val); break;
+                case 's': seed = std::stoul(val); break;
+                case 'p': overlay = std::stoi(val) != 0; break;
+                default: usage(argv[0]); return EXIT_FAILURE;
+            }
+        }
+        catch (std::exception&)
+        {
+            std::cerr << "Invalid value '" << val << "' of " << arg << "." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // No display is needed: frames are drawn by the software renderer into a window of the dummy video driver,
+    // unless SDL_VIDEODRIVER selects another one (e.g. offscreen of newer SDL).
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    SDL_SetHint(SDL_HINT_FRAMEBUFFER_ACCELERATION, "0");
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0 || TTF_Init() != 0)
+    {
+        std::cerr << "Cannot initialize SDL: " << SDL_GetError() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int retvalue = EXIT_SUCCESS;
+    try
+    {
+        // The client is never connected, its io_service does not run. Turns are scripted on a board
+        // and passed to the game as if the server responded to them.
+        boost::asio::io_service io_service;
+        std::atomic<bool> connected(false);
+        listener list(connected);
+        client cl(io_service, list, connected);
+
+        GameWindow window(Definitions::GAME_WINDOW_WIDTH, Definitions::GAME_WINDOW_HEIGHT, Definitions::GAME_WINDOW_NAME);
+        window.limit_frames(false);
+        if (overlay)
+            window.toggle_profiler();
+        std::string empty = "0";
+        for (std::size_t i = 1; i < BLOCK_COUNT_X * BLOCK_COUNT_Y; ++i)
+            empty += "|0";
+        Game game(window, client_data_tuple(empty, false, 0), cl);
+        board b;
+        b.seed(seed);
+        std::mt19937 random(seed);
+        game.apply_restart(b.restart());
+
+        std::cout << "Drawing frames for " << duration << "s, turn every " << turn_ms << "ms, "
+                  << SDL_GetCurrentVideoDriver() << " video driver." << std::endl;
+        FrameProfiler& profiler = window.get_profiler();
+        profiler.start(); // warm up caches of the renderer, first frame also measures startup
+        profiler.end_phase(FrameProfiler::EVENTS);
+        Program::draw_frame(window, game, 0);
+
+        histogram frame_times;
+        double phases[FrameProfiler::MAX_PHASES] = { };
+        unsigned long long frame_allocations = 0, max_allocations = 0, turns = 0;
+        std::size_t frames = 0;
+        Uint32 start = SDL_GetTicks(), next_turn = start;
+        SDL_Event event;
+        while ((long long) (SDL_GetTicks() - start) < duration * 1000)
+        {
+            unsigned long long before = allocations;
+            Uint32 frame_start = SDL_GetTicks();
+            profiler.start();
+            while (SDL_PollEvent(&event))
+                game.event_handler(event);
+            if (SDL_GetTicks() >= next_turn)
+            {
+                scripted_turn(b, random, game);
+                next_turn += (Uint32) turn_ms;
+                ++turns;
+            }
+            profiler.end_phase(FrameProfiler::EVENTS);
+            Program::draw_frame(window, game, 0);
+
+            ++frames;
+            frame_times.record((unsigned long long) (profiler.frame_ms(0) * 1000));
+            for (int phase = 0; phase < FrameProfiler::MAX_PHASES; ++phase)
+                phases[phase] += profiler.last_ms((FrameProfiler::Phases) phase);
+            unsigned long long count = allocations - before;
+            frame_allocations += count;
+            if (count > max_allocations)
+                max_allocations = count;
+            if (next_turn < frame_start) // do not catch up, when frames are slower than turns
+                next_turn = frame_start;
+        }
+        double total = (SDL_GetTicks() - start) / 1000.;
+
+        std::cout << std::endl << "Frames: " << frames << " (" << std::fixed << std::setprecision(1) << frames / total << " frames/s), turns: " << turns << "." << std::endl
+                  << "Frame time: p50=" << frame_times.percentile(50) << "us p99=" << frame_times.percentile(99)
+                  << "us max=" << frame_times.max() << "us" << std::endl;
+        if (frames)
+        {
+            report_phase("EVENTS", phases[FrameProfiler::EVENTS], frames);
+            report_phase("ANIMATION", phases[FrameProfiler::ANIMATION], frames);
+            report_phase("DRAW", phases[FrameProfiler::DRAW], frames);
+            report_phase("PRESENT", phases[FrameProfiler::PRESENT], frames);
+            std::cout << "Allocations: " << std::setprecision(2) << (double) frame_allocations / frames << " per frame, at most " << max_allocations << " in a frame." << std::endl;
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        retvalue = EXIT_FAILURE;
+    }
+
+    TTF_Quit();
+    SDL_Quit();
+    return retvalue;
+}
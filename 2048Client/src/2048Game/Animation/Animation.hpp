@@ -1,26 +1,86 @@
 #pragma once
 #include <SDL.h>
+#include <vector>
+#include <math.h>
+#include "../Definitions/Definitions.hpp"
 #include "../Definitions/Rect.hpp"
 
+//! Easing, which starts fast and slows down towards the end.
+//! \param t Progress of animation, 0 <= t <= 1.
+//! \return Eased progress.
+inline float ease_out_cubic(float t) { return 1 - (1 - t) * (1 - t) * (1 - t); }
+
+//! Easing, which rises to 1 in the middle and returns back to 0.
+//! \param t Progress of animation, 0 <= t <= 1.
+//! \return Eased progress.
+inline float ease_pulse(float t) { return (float) sin(3.14159265358979 * t); }
+
 /**!
     \ingroup client
-    \brief Interface for animating events throughout playthrough.
+    \brief Base of pools of animations of one type, stored as structure of arrays.
+
+    Pool has the same duration for all its animations, which are started by time in milliseconds (SDL_GetTicks()),
+    so they are independent of frame rate. Columns are preallocated for every block of the board, so adding
+    an animation does not allocate. Derived pools add their own columns and keep them in the same order.
+    \sa Animator, Move, Merge, Spawn
 */
 class Animation
 {
     public:
-        //! Default virtual destructor.
-        virtual ~Animation() = default;
+        //! Checks whether all animations have finished.
+        //! \return True if there is no running animation, false otherwise.
+        bool empty() const { return m_rects.empty(); }
+
+        //! Gets number of running animations.
+        //! \return Number of animations, including those not started yet.
+        std::size_t size() const { return m_rects.size(); }
 
-        //! Pure virtual method called when animation is required.
-        //! \return True if animation has finished, false otherwise.
-        virtual bool animate() = 0;
     protected:
-        //! Default copy contructor
-        Animation(const Animation&) = default;
-        //! Constructs an object from given Rect
-        //! \param rect C-Pointer to Rect to be animated.
-        //! \sa Rect
-        Animation(Rect* rect) : m_rect(rect) { }
-        Rect* m_rect; //!< Pointer to animated Rect.
+        //! Constructs an empty pool.
+        //! \param duration Duration of every animation in milliseconds.
+        Animation(Uint32 duration) : m_duration(duration)
+        {
+            reserve(m_rects);
+            reserve(m_start);
+        }
+
+        //! Preallocates a column for every block of the board.
+        //! \param column Column to preallocate.
+        template<typename T>
+        static void reserve(std::vector<T>& column) { column.reserve(Definitions::BLOCK_COUNT_X * Definitions::BLOCK_COUNT_Y); }
+
+        //! Adds common columns of an animation.
+        //! \param rect Animated Rect.
+        //! \param start Ticks, when the animation starts. May be in the future.
+        void add(Rect& rect, Uint32 start)
+        {
+            m_rects.push_back(&rect);
+            m_start.push_back(start);
+        }
+
+        //! Computes progress of an animation.
+        //! \param i Index of the animation.
+        //! \param now Current ticks.
+        //! \return Negative if animation has not started yet, otherwise progress in range <0, 1>.
+        float progress(std::size_t i, Uint32 now) const
+        {
+            Sint32 elapsed = (Sint32) (now - m_start[i]);
+            if (elapsed < 0)
+                return -1;
+            return elapsed >= (Sint32) m_duration ? 1 : (float) elapsed / m_duration;
+        }
+
+        //! Removes an animation by moving the last one in its place.
+        //! \param column Column to remove from.
+        //! \param i Index of the animation.
+        template<typename T>
+        static void remove(std::vector<T>& column, std::size_t i)
+        {
+            column[i] = column.back();
+            column.pop_back();
+        }
+
+        std::vector<Rect*> m_rects; //!< Animated Rects.
+        std::vector<Uint32> m_start; //!< Ticks, when animations start.
+        Uint32 m_duration; //!< Duration of animations in milliseconds.
 };
@@ -1,43 +1,74 @@
 #pragma once
 #include <SDL.h>
-#include <memory>
-#include <vector>
-#include <algorithm>
 #include "../Definitions/Definitions.hpp"
 #include "../Definitions/Rect.hpp"
-#include "Animation.hpp"
+#include "Move.hpp"
+#include "Merge.hpp"
+#include "Spawn.hpp"
 
 /**!
     \ingroup client
     \brief Animation class handles procession of animation of Rects.
+
+    Animations are kept in a preallocated pool per type, so a turn does not allocate and no virtual call is made per block.
+    Merges and spawns start after moves of the turn have finished.
     \sa Merge, Move, Spawn
 */
 class Animator
 {
     public:
-        /*! Adds specific Animation event to list of animated events. 
-         * @tparam T Type of Animation
-         * \sa Merge, Move, Spawn
-         * @tparam Ts Arguments of T constructor
-         * \param vals Arguments to pass to T's constructor.
-         */
-        template<typename T, typename... Ts>
-        void add(Ts&&... vals) { m_animation.emplace_back(std::make_shared<T>(std::forward<Ts>(vals)...)); } // black magic
+        //! Moves a block.
+        //! \param rect Reference to moving rect.
+        //! \param point Const reference to target point.
+        void move(Rect& rect, const SDL_Point& point) { m_move.add(rect, point, SDL_GetTicks()); }
+
+        //! Merges a block, after moves have finished.
+        //! \param rect Reference to merged rect.
+        //! \param point Const reference to point, where the block is merged.
+        void merge(Rect& rect, const SDL_Point& point) { m_merge.add(rect, point, SDL_GetTicks() + Definitions::MOVE_DURATION); }
+
+        //! Spawns a block, after moves have finished.
+        //! \param rect Reference to spawning rect.
+        //! \param point Const reference to target point.
+        void spawn(Rect& rect, const SDL_Point& point) { m_spawn.add(rect, point, SDL_GetTicks() + Definitions::MOVE_DURATION); }
 
         //! Handles animating of Animation events
-        //! \sa Animation, Animation::animate()
+        //! \sa Move::animate(), Merge::animate(), Spawn::animate()
         void animate()
         {
-            m_animation.erase(std::remove_if(begin(m_animation), end(m_animation), [](std::shared_ptr<Animation>& m){ return m->animate(); }), end(m_animation));
+            Uint32 now = SDL_GetTicks();
+            m_move.animate(now);
+            m_merge.animate(now);
+            m_spawn.animate(now);
+        }
+
+        //! Fast-forwards all animations to their end, e.g. when the player plays before they have finished.
+        void finish()
+        {
+            m_move.animate(0, true);
+            m_merge.animate(0, true);
+            m_spawn.animate(0, true);
         }
+
         //! Checks whether all animations have finished and if player can play next turn.
         //! \return True if all animations have processed, false otherwise.
-        bool can_play() const { return m_animation.empty(); }
+        bool can_play() const { return m_move.empty() && m_merge.empty() && m_spawn.empty(); }
+
+        //! Gets number of running animations.
+        //! \return Number of animations of all types.
+        std::size_t size() const { return m_move.size() + m_merge.size() + m_spawn.size(); }
 
         //! Cancels all animations.
         //! \sa Game::restart()
-        void clear() { m_animation.clear(); }
+        void clear()
+        {
+            m_move.clear();
+            m_merge.clear();
+            m_spawn.clear();
+        }
 
     private:
-        std::vector<std::shared_ptr<Animation>> m_animation; //!< Saved animation events
+        Move m_move;    //!< Running moves.
+        Merge m_merge;  //!< Running merges.
+        Spawn m_spawn;  //!< Running spawns.
 };
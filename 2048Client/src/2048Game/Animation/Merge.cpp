@@ -1,23 +1,35 @@
 #include "Merge.hpp"
 
-bool Merge::animate()
+void Merge::animate(Uint32 now, bool finish)
 {
-    SDL_Rect& rect = m_rect->get_rect();
-
-    if ((rect.w += m_speed) >= (int) m_size_x)
-        rect.w = m_size_x;
-    if ((rect.h += m_speed) >= (int) m_size_y)
-        rect.h = m_size_y;
-    rect.x = m_point.x + ((int) Definitions::BLOCK_SIZE_X - rect.w) / 2;
-    rect.y = m_point.y + ((int) Definitions::BLOCK_SIZE_Y - rect.h) / 2;
-    
-    if (rect.w == m_size_x && rect.h == m_size_y)
+    for (std::size_t i = 0; i < m_rects.size();)
     {
-        rect.w = Definitions::BLOCK_SIZE_X;
-        rect.h = Definitions::BLOCK_SIZE_Y;
-        rect.x = m_point.x + (Definitions::BLOCK_SIZE_X - rect.w) / 2;
-        rect.y = m_point.y + (Definitions::BLOCK_SIZE_Y - rect.w) / 2;
-        return true;
+        float t = finish ? 1 : progress(i, now);
+        if (t < 0)
+        {
+            ++i;
+            continue;
+        }
+
+        SDL_Rect& rect = m_rects[i]->get_rect();
+        float scale = 1 + (m_enlargement - 100) / 100.f * ease_pulse(t);
+        rect.w = (int) (Definitions::BLOCK_SIZE_X * scale);
+        rect.h = (int) (Definitions::BLOCK_SIZE_Y * scale);
+        if (t >= 1)
+        {
+            rect.w = Definitions::BLOCK_SIZE_X;
+            rect.h = Definitions::BLOCK_SIZE_Y;
+        }
+        rect.x = m_point[i].x + (Definitions::BLOCK_SIZE_X - rect.w) / 2;
+        rect.y = m_point[i].y + (Definitions::BLOCK_SIZE_Y - rect.h) / 2;
+
+        if (t < 1)
+        {
+            ++i;
+            continue;
+        }
+        remove(m_rects, i);
+        remove(m_start, i);
+        remove(m_point, i);
     }
-    else return false;
 }
@@ -1,6 +1,5 @@
 #pragma once
 #include <SDL.h>
-#include <memory>
 #include <vector>
 #include "../Definitions/Definitions.hpp"
 #include "../Definitions/Rect.hpp"
@@ -8,39 +7,46 @@
 
 /**!
     \ingroup client
-    \brief Merge class handling animation of merging of blocks.
+    \brief Pool of animations of merging of blocks, which pulse around their centers.
     \sa Animation
 */
 class Merge : public Animation
 {
     public:
-        //! Constructor for Merge animation
-        //! \param rect Reference to merging rect
-        //! \param speed Speed of merging. Default \sa Definitions::DEFAULT_MERGE_SPEED
-        //! \param enlargement Procentual enlargement of merged block. Default \sa Definitions::DEFAULT_MERGE_ENLARGEMENT
-        //! \sa Animator::add()
-        Merge(Rect& rect, int speed = Definitions::DEFAULT_MERGE_SPEED, int enlargement = Definitions::DEFAULT_MERGE_ENLARGEMENT) :
-            Animation(&rect), m_point({rect.get_rect().x, rect.get_rect().y}), m_speed(speed)
-        { m_size_x = rect.get_rect().w * enlargement/100; m_size_y = rect.get_rect().h * enlargement/100; }
+        //! Constructs an empty pool.
+        //! \param duration Duration of merging in milliseconds. Default Definitions::MERGE_DURATION.
+        //! \param enlargement Procentual enlargement of merged block in the middle of merging. Default \sa Definitions::DEFAULT_MERGE_ENLARGEMENT
+        Merge(Uint32 duration = Definitions::MERGE_DURATION, int enlargement = Definitions::DEFAULT_MERGE_ENLARGEMENT) :
+            Animation(duration), m_enlargement(enlargement)
+        {
+            reserve(m_point);
+        }
 
-        //! Default copy constructor
-        Merge(const Merge& m) : Animation(m.m_rect), m_point(m.m_point), m_speed(m.m_speed), m_size_x(m.m_size_x), m_size_y(m.m_size_y) { }
-        
-        //! Default copy assignment
-        Merge& operator=(const Merge&) = default;
-        
-        //! Default virtual destructor
-        virtual ~Merge() = default;
+        //! Adds merging of a block.
+        //! \param rect Reference to merged rect.
+        //! \param point Const reference to point, where the block is merged.
+        //! \param start Ticks, when merging starts.
+        //! \sa Animator::merge()
+        void add(Rect& rect, const SDL_Point& point, Uint32 start)
+        {
+            Animation::add(rect, start);
+            m_point.push_back(point);
+        }
 
-        //! Virtual method called when animation is required.
-        //! Merges m_rect at m_point position at m_speed speed.
-        //! \return True if animation has finished, false otherwise.
-        //! \sa Animation::animate()
-        virtual bool animate();
+        //! Resizes merged blocks, finished merges are removed.
+        //! \param now Current ticks.
+        //! \param finish True to finish all animations at once, including those not started yet.
+        void animate(Uint32 now, bool finish = false);
+
+        //! Cancels all merges.
+        void clear()
+        {
+            m_rects.clear();
+            m_start.clear();
+            m_point.clear();
+        }
 
     private:
-        SDL_Point m_point; //!< Target of merge animation.
-        int m_speed; //!< Speed of merge animation.
-        int m_size_x; //!< Targetted size_x of Animation::m_rect.
-        int m_size_y; //!< Targetted size_y of Animation::m_rect.
+        std::vector<SDL_Point> m_point; //!< Points, where blocks are merged.
+        int m_enlargement; //!< Procentual enlargement of merged blocks.
 };
@@ -1,22 +1,31 @@
 #include "Move.hpp"
 
-bool Move::animate()
+void Move::animate(Uint32 now, bool finish)
 {
-    SDL_Rect& rect = m_rect->get_rect();
+    for (std::size_t i = 0; i < m_rects.size();)
+    {
+        float t = finish ? 1 : progress(i, now);
+        if (t < 0)
+        {
+            ++i;
+            continue;
+        }
 
-    if (m_point.x - rect.x > m_speed)
-        rect.x += m_speed;
-    else if (m_point.x - rect.x < -m_speed)
-        rect.x -= m_speed;
-    else
-        rect.x = m_point.x;
+        SDL_Rect& rect = m_rects[i]->get_rect();
+        float eased = ease_out_cubic(t);
+        rect.x = m_from[i].x + (int) ((m_to[i].x - m_from[i].x) * eased);
+        rect.y = m_from[i].y + (int) ((m_to[i].y - m_from[i].y) * eased);
 
-    if (m_point.y - rect.y > m_speed)
-        rect.y += m_speed;
-    else if (m_point.y - rect.y < -m_speed)
-        rect.y -= m_speed;
-    else
-        rect.y = m_point.y;
-
-    return rect.x == m_point.x && rect.y == m_point.y;
+        if (t < 1)
+        {
+            ++i;
+            continue;
+        }
+        rect.x = m_to[i].x;
+        rect.y = m_to[i].y;
+        remove(m_rects, i);
+        remove(m_start, i);
+        remove(m_from, i);
+        remove(m_to, i);
+    }
 }
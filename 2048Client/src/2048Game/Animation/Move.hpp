@@ -1,6 +1,5 @@
 #pragma once
 #include <SDL.h>
-#include <memory>
 #include <vector>
 #include "../Definitions/Definitions.hpp"
 #include "../Definitions/Rect.hpp"
@@ -8,36 +7,47 @@
 
 /**!
     \ingroup client
-    \brief Move class handling animation of moving of blocks.
+    \brief Pool of animations of moving blocks.
     \sa Animation
 */
 class Move : public Animation
 {
     public:
-        //! Base constructor for Move Animation.
-        //! \param rect Reference to moving rect
-        //! \param point Const reference to target point
-        //! \param speed Speed of moving animation. Default Definitions::DEFAULT_MOVE_SPEED
-        //! \sa Animator::add()
-        Move(Rect& rect, const SDL_Point& point, int speed = Definitions::DEFAULT_MOVE_SPEED) :
-            Animation(&rect), m_point(point), m_speed(speed) { }
+        //! Constructs an empty pool.
+        //! \param duration Duration of moving in milliseconds. Default Definitions::MOVE_DURATION.
+        Move(Uint32 duration = Definitions::MOVE_DURATION) : Animation(duration)
+        {
+            reserve(m_from);
+            reserve(m_to);
+        }
 
-        //! Default copy constructor
-        Move(const Move& m) : Animation(m.m_rect), m_point(m.m_point), m_speed(m.m_speed) { }
-        
-        //! Default copy assignment
-        Move& operator=(const Move&) = default;
+        //! Adds moving of a block from its current position.
+        //! \param rect Reference to moving rect.
+        //! \param point Const reference to target point.
+        //! \param start Ticks, when moving starts.
+        //! \sa Animator::move()
+        void add(Rect& rect, const SDL_Point& point, Uint32 start)
+        {
+            Animation::add(rect, start);
+            m_from.push_back({ rect.get_rect().x, rect.get_rect().y });
+            m_to.push_back(point);
+        }
 
-        //! Default virtual destructor.
-        virtual ~Move() = default;
+        //! Moves blocks towards their targets, finished moves are removed.
+        //! \param now Current ticks.
+        //! \param finish True to finish all animations at once, including those not started yet.
+        void animate(Uint32 now, bool finish = false);
 
-        //! Virtual method called when animation is required.
-        //! Moves m_rect to m_point at m_speed.
-        //! \return True if animation is finished, false otherwise.
-        //! \sa Animation::animate()
-        virtual bool animate();
+        //! Cancels all moves.
+        void clear()
+        {
+            m_rects.clear();
+            m_start.clear();
+            m_from.clear();
+            m_to.clear();
+        }
 
     private:
-        SDL_Point m_point; //!< Target of move animation.
-        int m_speed; //!< Speed of the animation.
+        std::vector<SDL_Point> m_from; //!< Positions, where moves started.
+        std::vector<SDL_Point> m_to; //!< Targets of moves.
 };
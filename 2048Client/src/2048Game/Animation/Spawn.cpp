@@ -1,15 +1,31 @@
 #include "Spawn.hpp"
 #include "../Definitions/Definitions.hpp"
 
-bool Spawn::animate()
+void Spawn::animate(Uint32 now, bool finish)
 {
-    SDL_Rect& rect = m_rect->get_rect();
-    if ((rect.w += m_speed) >= (int) m_size_x)
-        rect.w = m_size_x;
-    if ((rect.h += m_speed) >= (int) m_size_y)
-        rect.h = m_size_y;
-    rect.x = m_point.x + (Definitions::BLOCK_SIZE_X - rect.w) / 2;
-    rect.y = m_point.y + (Definitions::BLOCK_SIZE_Y - rect.h) / 2;
-    
-    return rect.w == m_size_x && rect.h == m_size_y;
+    for (std::size_t i = 0; i < m_rects.size();)
+    {
+        float t = finish ? 1 : progress(i, now);
+        if (t < 0)
+        {
+            ++i;
+            continue;
+        }
+
+        SDL_Rect& rect = m_rects[i]->get_rect();
+        float eased = ease_out_cubic(t);
+        rect.w = (int) (Definitions::BLOCK_SIZE_X * eased);
+        rect.h = (int) (Definitions::BLOCK_SIZE_Y * eased);
+        rect.x = m_point[i].x + (Definitions::BLOCK_SIZE_X - rect.w) / 2;
+        rect.y = m_point[i].y + (Definitions::BLOCK_SIZE_Y - rect.h) / 2;
+
+        if (t < 1)
+        {
+            ++i;
+            continue;
+        }
+        remove(m_rects, i);
+        remove(m_start, i);
+        remove(m_point, i);
+    }
 }
@@ -1,6 +1,5 @@
 #pragma once
 #include <SDL.h>
-#include <memory>
 #include <vector>
 #include "../Definitions/Definitions.hpp"
 #include "../Definitions/Rect.hpp"
@@ -8,41 +7,43 @@
 
 /**!
     \ingroup client
-    \brief Spawn class handling animation of spawning of new blocks.
+    \brief Pool of animations of spawning of new blocks, which grow from their centers.
     \sa Animation
 */
 class Spawn : public Animation
 {
     public:
-        //! Base constructor for Spawn Animation.
-        //! \param rect Reference to spawning rect
-        //! \param point Const reference to target point
-        //! \param size_x Final x coord size
-        //! \param size_y Final y coord size
-        //! \param speed Speed of spawning animation. Default Definitions::DEFAULT_SPAWN_SPEED
-        //! \sa Animator::add()
-        Spawn(Rect& rect, const SDL_Point& point, int size_x = Definitions::BLOCK_SIZE_X,
-            int size_y = Definitions::BLOCK_SIZE_X, int speed = Definitions::DEFAULT_SPAWN_SPEED) :
-            Animation(&rect), m_point(point), m_speed(speed), m_size_x(size_x), m_size_y(size_y) { }
+        //! Constructs an empty pool.
+        //! \param duration Duration of spawning in milliseconds. Default Definitions::SPAWN_DURATION.
+        Spawn(Uint32 duration = Definitions::SPAWN_DURATION) : Animation(duration)
+        {
+            reserve(m_point);
+        }
 
-        //! Default copy constructor.
-        Spawn(const Spawn& s) : Animation(s.m_rect), m_point(s.m_point), m_speed(s.m_speed), m_size_x(s.m_size_x), m_size_y(s.m_size_y) { }
+        //! Adds spawning of a block.
+        //! \param rect Reference to spawning rect, which is not shown until spawning starts.
+        //! \param point Const reference to target point.
+        //! \param start Ticks, when spawning starts.
+        //! \sa Animator::spawn()
+        void add(Rect& rect, const SDL_Point& point, Uint32 start)
+        {
+            Animation::add(rect, start);
+            m_point.push_back(point);
+        }
 
-        //! Default copy assignment.
-        Spawn& operator=(const Spawn&) = default;
+        //! Enlarges blocks to Definitions::BLOCK_SIZE_X * Definitions::BLOCK_SIZE_Y, finished spawns are removed.
+        //! \param now Current ticks.
+        //! \param finish True to finish all animations at once, including those not started yet.
+        void animate(Uint32 now, bool finish = false);
 
-        //! Default virtual destructor.
-        virtual ~Spawn() = default;
-
-        //! Virtual method called when animation is required.
-        //! Enlarges m_rect to m_size_x * m_size_y size at m_speed.
-        //! \return True if animation is finished, false otherwise.
-        //! \sa Animation::animate()
-       virtual bool animate();
+        //! Cancels all spawns.
+        void clear()
+        {
+            m_rects.clear();
+            m_start.clear();
+            m_point.clear();
+        }
 
     private:
-        SDL_Point m_point; //!< Target of merge animation.
-        int m_speed; //!< Speed of spawn animation.
-        int m_size_x; //!< Targetted size_x of Animation::m_rect.
-        int m_size_y; //!< Targetted size_y of Animation::m_rect.
+        std::vector<SDL_Point> m_point; //!< Target points of spawns.
 };
@@ -8,6 +8,8 @@ const int Definitions::STATS_FONT_SIZE = 12;
 const std::string Definitions::STATS_DELIMITER = "               ";
 const int Definitions::STATS_BUTTON_HEIGHT = 25;
 const std::string Definitions::STATS_FILE_NAME = "stats.dat";
+const std::string Definitions::PROFILE_FILE_NAME = "profile.csv";
+const std::string Definitions::STATE_FILE_NAME = "state.dat";
 
 const std::size_t Definitions::BLOCK_COUNT_X = 4;
 const std::size_t Definitions::BLOCK_COUNT_Y = BLOCK_COUNT_X; // Works even if not symetrical.
@@ -40,10 +42,15 @@ const std::vector<SDL_Color> Definitions::BLOCK_COLORS = {
 
 const SDL_Color Definitions::BACKGROUND_COLOR = { 30, 30, 30 };
 
-const int Definitions::DEFAULT_MOVE_SPEED = 3;
-const int Definitions::DEFAULT_SPAWN_SPEED = 1;
-const int Definitions::DEFAULT_MERGE_SPEED = DEFAULT_SPAWN_SPEED;
+const Uint32 Definitions::MOVE_DURATION = 100;
+const Uint32 Definitions::SPAWN_DURATION = 150;
+const Uint32 Definitions::MERGE_DURATION = 150;
 const int Definitions::DEFAULT_MERGE_ENLARGEMENT = 150;
+const Uint32 Definitions::TARGET_FPS = 60;
+const int Definitions::IDLE_WAIT_MS = 250;
+const int Definitions::STARTUP_WAIT_MS = 10;
+const std::size_t Definitions::MAX_QUEUED_MOVES = 8;
+const std::size_t Definitions::MAX_PIPELINED_PLAYS = 4;
 
 const SDL_Color Definitions::BLACK_COLOR = { 0, 0, 0 };
 const SDL_Color Definitions::GREY_COLOR = { 127, 127, 127 };
@@ -12,7 +12,7 @@ class Rect;
 class NumberedRect;
 
 typedef std::vector<Rect> Rects;
-typedef std::vector<std::vector<std::shared_ptr<NumberedRect>>> NumberedRects;
+typedef std::vector<NumberedRect> NumberedRects;
 
 /**!
     \ingroup client
@@ -30,6 +30,8 @@ class Definitions
         static const std::string STATS_DELIMITER;               //!< Delimiter used in stats window.
         static const int STATS_BUTTON_HEIGHT;                   //!< Height of Global/Current stats switching button.
         static const std::string STATS_FILE_NAME;               //!< File name, where stats are saved.
+        static const std::string PROFILE_FILE_NAME;             //!< File name, where frame profile is logged (Ctrl+F3).
+        static const std::string STATE_FILE_NAME;               //!< File name, where last known game state is cached between runs.
 
         static const int GAME_X;                                //!< X-Coord where Game begins.
         static const int GAME_Y;                                //!< Y-Coord where Game begins.
@@ -47,10 +49,15 @@ class Definitions
 
         static const SDL_Color BACKGROUND_COLOR;                //!< Background color of the window.
 
-        static const int DEFAULT_MOVE_SPEED;                    //!< Default move speed of blocks in pixels per frame
-        static const int DEFAULT_SPAWN_SPEED;                   //!< Default spawn speed of blocks in pixels per frame
-        static const int DEFAULT_MERGE_SPEED;                   //!< Default merge speed of blocks in pixels per frame
+        static const Uint32 MOVE_DURATION;                      //!< Duration of moving of blocks in milliseconds.
+        static const Uint32 SPAWN_DURATION;                     //!< Duration of spawning of blocks in milliseconds.
+        static const Uint32 MERGE_DURATION;                     //!< Duration of merging of blocks in milliseconds.
         static const int DEFAULT_MERGE_ENLARGEMENT;             //!< Default percentual enlargement of merged block.
+        static const Uint32 TARGET_FPS;                         //!< Most frames drawn per second.
+        static const int IDLE_WAIT_MS;                          //!< Most milliseconds to wait for an event, when nothing is animated.
+        static const int STARTUP_WAIT_MS;                       //!< Most milliseconds to wait for an event, while the user logs in or data are retrieved.
+        static const std::size_t MAX_QUEUED_MOVES;              //!< Most moves of the player waiting to be sent, further moves are dropped.
+        static const std::size_t MAX_PIPELINED_PLAYS;           //!< Most plays sent to the server without response.
 
         static const SDL_Color WHITE_COLOR;                     //!< White color.
         static const SDL_Color BLACK_COLOR;                     //!< Black color.
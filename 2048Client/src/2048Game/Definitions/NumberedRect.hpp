@@ -1,13 +1,11 @@
 #pragma once
 #include <SDL.h>
-#include <unordered_map>
 #include "../Definitions/Definitions.hpp"
 #include "Rect.hpp"
-#include "../Window/Window.hpp"
 
 /**!
     \ingroup client
-    \brief Rect with stored number displayed on the board.
+    \brief Rect with stored number displayed on the board. Numbers are drawn by GameWindow::add().
     \sa Rect
 */
 class NumberedRect : public Rect
@@ -24,6 +22,10 @@ class NumberedRect : public Rect
         //! Default virtual destructor.
         virtual ~NumberedRect() = default;
 
+        //! Tells whether this is an empty field of the board.
+        //! \return True if there is no block, false otherwise.
+        bool empty() const { return m_number == BLOCK_0; }
+
         //! Gets value representing NumberedRect.
         //! \return Blocks representing value of NumberedRect.
         Blocks get_number() const { return m_number; }
@@ -32,25 +34,6 @@ class NumberedRect : public Rect
         //! \return Real shown number on the board.
         int next_number() { m_color = Definitions::get_block_color(++m_number); return pow2(m_number); }
 
-        //! Virtual method used when drawing is requested.
-        //! \param window Window to draw to.
-        //! \sa Rect::draw()
-        virtual void draw(Window& window) const;
-
-        //! Initializes SDL_Textures with Block number.
-        //! \param window Reference to Window class, for which Renderer will be used.
-        //! \param number Number to create.
-        //! \param font Pointer to font used. If nullptr is provided, opens default font. Default: nullptr.
-        static void init_number(Window& window, unsigned int number, TTF_Font* font = nullptr);
-
-        //! Initializion of SDL_Textures for all Block numbers
-        //! \param window Reference to Window class, for which Renderer will be used.
-        static void init_numbers(Window& window);
-
-        //! Destroyes resources used to store Block numbers.
-        static void destroy_numbers() { for (auto iter = NUMBERS.begin(); iter != NUMBERS.end(); ++iter) SDL_DestroyTexture(iter->second); }
-
     private:
         Blocks m_number; //!< NumberedRect value as Blocks. \sa Blocks
-        static std::unordered_map<std::size_t, SDL_Texture*> NUMBERS; //!< HashTable of SDL_Textures of numbers. \sa SDL_Texture
 };
@@ -46,6 +46,10 @@ class Rect
         //! \return Const reference to SDL_Rect.
         const SDL_Rect& get_rect() const { return m_rect; }
 
+        //! Returns const reference to SDL_Color, which is used when drawing the Rect.
+        //! \return Const reference to SDL_Color.
+        const SDL_Color& get_color() const { return m_color; }
+
         //! Draws Rect on the given window.
         //! \param window Window to draw on.
         virtual void draw(Window& window) const;
@@ -6,17 +6,34 @@
 #include "../Program/Program.hpp"
 #include "../Definitions/Rect.hpp"
 #include "../Definitions/NumberedRect.hpp"
-#include "../Animation/Move.hpp"
-#include "../Animation/Spawn.hpp"
-#include "../Animation/Merge.hpp"
 #include "../Window/StatsWindow.hpp"
 #include "../../../../Common/play_event.hpp"
 #define assert_coords(x, y) assert((x) >= 0 && (x) < Definitions::BLOCK_COUNT_X && (y) >= 0 && (y) < Definitions::BLOCK_COUNT_Y)
 
 Game::Game(GameWindow& window, const client_data_tuple& data, client& cl) : m_window(window), m_canplay(false), m_won(std::get<1>(data)),
-    m_score(std::get<2>(data)), m_client(cl)
+    m_score(std::get<2>(data)), m_client(cl), m_dirty(true), m_plays(0), m_online(true)
 {
-    m_rects.resize(Definitions::BLOCK_COUNT_X, std::vector<std::shared_ptr<NumberedRect>>(Definitions::BLOCK_COUNT_Y, nullptr));
+    load(data);
+
+    m_background.emplace_back(0, 0, Definitions::BACKGROUND_COLOR, Definitions::GAME_WIDTH, Definitions::GAME_HEIGHT);
+    for (std::size_t x = 0; x < Definitions::BLOCK_COUNT_X; ++x)
+        for (std::size_t y = 0; y < Definitions::BLOCK_COUNT_Y; ++y)
+        {
+            m_background.emplace_back(Definitions::GAME_X + Definitions::BLOCK_SPACE + x * (Definitions::BLOCK_SIZE_X + Definitions::BLOCK_SPACE),
+                Definitions::GAME_Y + Definitions::BLOCK_SPACE + y * (Definitions::BLOCK_SIZE_Y + Definitions::BLOCK_SPACE),
+                Definitions::get_block_color(BLOCK_0));
+        }
+
+    if (Definitions::GAME_Y > 0)
+        m_background.emplace_back(2, 2, Definitions::GREY_COLOR, Definitions::GAME_WIDTH - 4, Definitions::GAME_Y - 4);
+}
+
+void Game::load(const client_data_tuple& data)
+{
+    m_animator.clear();
+    m_won = std::get<1>(data);
+    m_score = std::get<2>(data);
+    m_rects.assign(Definitions::BLOCK_COUNT_X * Definitions::BLOCK_COUNT_Y, NumberedRect({ 0, 0 }, BLOCK_0));
 
     auto vec = split(std::get<0>(data), '|');
     for (std::size_t i = 0; i < vec.size(); ++i)
@@ -29,18 +46,48 @@ Game::Game(GameWindow& window, const client_data_tuple& data, client& cl) : m_wi
             spawn_block((Blocks) block, x, y);
         }
     }
+    m_dirty = true;
+    m_window.update_score(std::to_string(m_score) + (m_won ? " (Won)" : ""));
+}
 
-    m_background.emplace_back(0, 0, Definitions::BACKGROUND_COLOR, Definitions::GAME_WIDTH, Definitions::GAME_HEIGHT);
-    for (std::size_t x = 0; x < Definitions::BLOCK_COUNT_X; ++x)
-        for (std::size_t y = 0; y < Definitions::BLOCK_COUNT_Y; ++y)
-        {
-            m_background.emplace_back(Definitions::GAME_X + Definitions::BLOCK_SPACE + x * (Definitions::BLOCK_SIZE_X + Definitions::BLOCK_SPACE),
-                Definitions::GAME_Y + Definitions::BLOCK_SPACE + y * (Definitions::BLOCK_SIZE_Y + Definitions::BLOCK_SPACE),
-                Definitions::get_block_color(BLOCK_0));
-        }
+client_data_tuple Game::get_data() const
+{
+    std::string blocks;
+    for (std::size_t i = 0; i < Definitions::BLOCK_COUNT_X * Definitions::BLOCK_COUNT_Y; ++i)
+    {
+        int x = i / Definitions::BLOCK_COUNT_X;
+        int y = i % Definitions::BLOCK_COUNT_Y;
+        blocks += (i ? "|" : "") + std::to_string(m_rects[x * Definitions::BLOCK_COUNT_Y + y].get_number());
+    }
+    return client_data_tuple(blocks, m_won, (int) m_score);
+}
 
-    if (Definitions::GAME_Y > 0)
-        m_background.emplace_back(2, 2, Definitions::GREY_COLOR, Definitions::GAME_WIDTH - 4, Definitions::GAME_Y - 4);
+void Game::receive()
+{
+    m_client.poll();
+    if (m_online == m_client.is_online())
+        return;
+    m_online = !m_online;
+    m_dirty = true;
+    m_window.update_score(std::to_string(m_score) + (m_won ? " (Won)" : "") + (m_online ? "" : " (Reconnecting)"));
+}
+
+void Game::enable_resume()
+{
+    m_client.enable_resume([this]() { return get_data(); },
+        [this](const client_data_tuple& data, bool changed) { resumed(data, changed); });
+}
+
+void Game::resumed(const client_data_tuple& data, bool changed)
+{
+    m_plays = 0;
+    if (changed)
+    {
+        m_moves.clear(); // they were meant for the replaced board
+        load(data);
+        start();
+    }
+    send_moves();
 }
 
 void Game::event_handler(const SDL_Event& event)
@@ -59,6 +106,13 @@ void Game::event_handler(const SDL_Event& event)
             if (m_window.stats_button_clicked(event.button))
                 show_stats();
             break;
+        case SDL_WINDOWEVENT: // exposed, restored, resized, ...
+            m_dirty = true;
+            break;
+        case SDL_RENDER_TARGETS_RESET:
+            m_window.invalidate_background();
+            m_dirty = true;
+            break;
     }
 }
 
@@ -77,46 +131,80 @@ void Game::key_handler(const SDL_KeyboardEvent& keyevent)
         case SDLK_UP: play(UP); break;
         case SDLK_DOWN: play(DOWN); break;
         case SDLK_r: restart(); break;
+        case SDLK_F3:
+            if (keyevent.keysym.mod & (KMOD_RCTRL | KMOD_LCTRL))
+                m_window.get_profiler().toggle_log();
+            else
+                m_window.toggle_profiler();
+            m_dirty = true;
+            break;
     }
 }
 
 void Game::start()
 {
     m_canplay = true;
+    m_dirty = true;
     m_window.update_score(std::to_string(m_score));
 }
 
 void Game::play(Directions direction)
 {
-    if (!can_play())
+    if (!m_canplay)
         return;
 
-    play_event pl_event = m_client.play(direction);
-    if (pl_event.played())
+    if (m_moves.size() < Definitions::MAX_QUEUED_MOVES)
+        m_moves.push_back(direction);
+    m_animator.finish();
+    m_dirty = true;
+    send_moves();
+}
+
+void Game::send_moves()
+{
+    while (!m_moves.empty() && can_play())
     {
-        process_play(pl_event);
-        m_window.update_score(std::to_string(m_score) + (m_won ? " (Won)" : ""));
+        Directions direction = m_moves.front();
+        m_moves.pop_front();
+        ++m_plays;
+        m_client.play(direction, [this](const play_event& pl_event)
+        {
+            --m_plays;
+            apply_play(pl_event);
+            send_moves();
+        });
     }
 }
 
+void Game::apply_play(const play_event& pl_event)
+{
+    if (!pl_event.played())
+        return;
+
+    m_dirty = true;
+    m_animator.finish(); // turn starts where the previous one ended
+    process_play(pl_event);
+    m_window.update_score(std::to_string(m_score) + (m_won ? " (Won)" : ""));
+}
+
 void Game::move_to(int from_x, int from_y, int to_x, int to_y)
 {
     assert_coords(from_x, from_y);
     assert_coords(to_x, to_y);
-    assert(m_rects[from_x][from_y] != nullptr && m_rects[to_x][to_y] == nullptr);
-    m_animator.add<Move>(*m_rects[from_x][from_y], get_block_coords(to_x, to_y));
-    m_rects[to_x][to_y] = m_rects[from_x][from_y];
-    m_rects[from_x][from_y] = nullptr;
+    assert(!tile(from_x, from_y).empty() && tile(to_x, to_y).empty());
+    tile(to_x, to_y) = tile(from_x, from_y);
+    tile(from_x, from_y) = NumberedRect(get_block_coords(from_x, from_y), BLOCK_0);
+    m_animator.move(tile(to_x, to_y), get_block_coords(to_x, to_y));
 }
 
 void Game::merge_to(int from_x, int from_y, int to_x, int to_y)
 {
     assert_coords(from_x, from_y);
     assert_coords(to_x, to_y);
-    assert(m_rects[from_x][from_y] != nullptr && m_rects[to_x][to_y] != nullptr);
-    m_animator.add<Merge>(*m_rects[to_x][to_y]);
-    int number = m_rects[to_x][to_y]->next_number();
-    m_rects[from_x][from_y] = nullptr;
+    assert(!tile(from_x, from_y).empty() && !tile(to_x, to_y).empty());
+    m_animator.merge(tile(to_x, to_y), get_block_coords(to_x, to_y));
+    int number = tile(to_x, to_y).next_number();
+    tile(from_x, from_y) = NumberedRect(get_block_coords(from_x, from_y), BLOCK_0);
 
     if (!m_won && number == Definitions::GAME_WIN_NUMBER)
         won();
@@ -125,24 +213,30 @@ void Game::merge_to(int from_x, int from_y, int to_x, int to_y)
 bool Game::spawn_block(Blocks block, int x, int y)
 {
     assert_coords(x, y);
-    if (m_rects[x][y])
+    if (!tile(x, y).empty())
         return false;
-    m_rects[x][y] = std::make_shared<NumberedRect>(get_block_coords(x, y), block, 0, 0);
-    m_animator.add<Spawn>(*m_rects[x][y], get_block_coords(x, y));
+    tile(x, y) = NumberedRect(get_block_coords(x, y), block, 0, 0);
+    m_animator.spawn(tile(x, y), get_block_coords(x, y));
 
     return true;
 }
 
 void Game::restart()
 {
-    auto vec = m_client.restart();
+    if (!m_client.is_online())
+        return;
+    m_moves.clear(); // they were meant for the old board
+    m_client.restart([this](const std::vector<random_block_record>& vec) { apply_restart(vec); });
+}
 
+void Game::apply_restart(const std::vector<random_block_record>& blocks)
+{
     m_canplay = false;
     m_animator.clear();
     m_score = 0;
     m_won = false;
-    m_rects = NumberedRects(Definitions::BLOCK_COUNT_X, std::vector<std::shared_ptr<NumberedRect>>(Definitions::BLOCK_COUNT_Y, nullptr));
-    for (const auto& i : vec)
+    m_rects.assign(Definitions::BLOCK_COUNT_X * Definitions::BLOCK_COUNT_Y, NumberedRect({ 0, 0 }, BLOCK_0));
+    for (const auto& i : blocks)
         spawn_block(i.first, i.second.first, i.second.second);
     start();
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <SDL.h>
 #include <vector>
+#include <deque>
 #include <exception>
 #include <iostream>
 #include <time.h>
@@ -38,7 +39,7 @@ class Game
         //! \sa Window::add(), Rect
         const Rects& get_background() const { return m_background; }
 
-        //! Returns reference to vector of NumberedRects used on game field.
+        //! Returns reference to NumberedRects used on game field, stored by columns.
         //! Used for drawing game state from Window::add()
         //! \return Const reference to vector of NumberedRect.
         const NumberedRects& get_rects() const { return m_rects; }
@@ -66,6 +67,16 @@ class Game
                     (rect.get_rect().y - Definitions::GAME_Y - Definitions::BLOCK_SPACE) / (Definitions::BLOCK_SPACE + Definitions::BLOCK_SIZE_Y)};
         }
 
+        //! Replaces state of the game, e.g. when the server sends other state than the cached one.
+        //! Blocks are spawned with animation, the game is not started.
+        //! \param data Blocks serialized as by the server, won status and score.
+        void load(const client_data_tuple& data);
+
+        //! Serializes state of the game as the server sends it.
+        //! \return Blocks, won status and score.
+        //! \sa load
+        client_data_tuple get_data() const;
+
         //! Starts a new game.
         void start();
 
@@ -73,14 +84,46 @@ class Game
         //! \sa Animator, Animator::animate()
         void animate() { m_animator.animate(); }
 
-        //! Checks whether player can perform a turn.
+        //! Tells whether the scene changed since it was last drawn.
+        //! \return True if something changed or is being animated, false otherwise.
+        //! \sa Program::start()
+        bool needs_redraw() const { return m_dirty || !m_animator.can_play() || m_window.is_showing_profiler(); }
+
+        //! Marks the scene as drawn.
+        void drawn() { m_dirty = false; }
+
+        //! Handles responses of the server and shows, whether the connection is being reestablished. Called by Program::start() every frame.
+        //! \sa client::poll()
+        void receive();
+
+        //! Lets the client resume the session, when the connection is lost. Turns are queued until it is resumed.
+        //! \sa client::enable_resume()
+        void enable_resume();
+
+        //! Getter for animator.
+        //! \return Const reference to animator of the game.
+        const Animator& get_animator() const { return m_animator; }
+
+        //! Checks whether player's turn can be sent to the server now.
+        //! Turns are sent while animations of previous ones still run, up to Definitions::MAX_PIPELINED_PLAYS without response.
         //! \return True if player can play, false otherwise.
-        bool can_play() const { return m_animator.can_play() && m_canplay; }
+        bool can_play() const { return m_canplay && m_plays < Definitions::MAX_PIPELINED_PLAYS && m_client.is_online(); }
 
-        //! Processes player's turn.
+        //! Queues player's turn and fast-forwards running animations. Queued turns are sent to the server as soon as \ref can_play
+        //! allows, they are processed, when the server responds.
         //! \param direction Direction which player decided to play.
         void play(Directions direction);
 
+        //! Processes turn confirmed by the server: animates it and updates the score.
+        //! Called by handlers of \ref play, the benchmark calls it with scripted turns.
+        //! \param pl_event The turn. Nothing happens, if no block moved.
+        void apply_play(const play_event& pl_event);
+
+        //! Starts new game with blocks spawned by the server.
+        //! Called by handler of \ref restart, the benchmark calls it with scripted games.
+        //! \param blocks Starting blocks of the game.
+        void apply_restart(const std::vector<random_block_record>& blocks);
+
         //! Inserts block on given coords.
         //! \param block Block to insert.
         //! \param x x coord
@@ -89,7 +132,7 @@ class Game
         //! \sa Blocks, player_data::random_block()
         bool spawn_block(Blocks block, int x, int y);
 
-        //! Removes all progress in current game and starts new one.
+        //! Removes all progress in current game and starts new one, when the server responds.
         void restart();
 
         //! Handles end of the game, when player loses.
@@ -99,6 +142,7 @@ class Game
                 return;
 
             m_canplay = false;
+            m_moves.clear();
         }
 
         //! Handles winning of the game.
@@ -121,13 +165,23 @@ class Game
 
     private:
         Rects m_background;     //!< Rectangles which forms a background of game.
-        NumberedRects m_rects;  //!< Definitions::BLOCK_COUNT_X * Definitions::BLOCK_COUNT_Y field of NumberedRects forming state of a game.
+        NumberedRects m_rects;  //!< Definitions::BLOCK_COUNT_X * Definitions::BLOCK_COUNT_Y field of NumberedRects forming state of a game, empty fields are BLOCK_0.
         Animator m_animator;    //!< Animator class handling movement animtions.
         bool m_canplay;         //!< Tells whether player game is being played.
         bool m_won;             //!< Indicates, that player managed to win this game.
         GameWindow& m_window;   //!< Reference to Window class showing current game.
         long long m_score;      //!< Score earned in current game.
         client& m_client;       //!< Reference to client.
+        bool m_dirty;           //!< Indicates, that the scene changed since it was last drawn.
+        std::deque<Directions> m_moves; //!< Turns of the player waiting to be sent.
+        std::size_t m_plays;    //!< Turns sent to the server without response.
+        bool m_online;          //!< Indicates, that the client was online, when responses were last handled.
+
+        //! Gets field of the game.
+        //! \param x x coord
+        //! \param y y coord
+        //! \return Reference to NumberedRect on the field.
+        NumberedRect& tile(int x, int y) { return m_rects[x * Definitions::BLOCK_COUNT_Y + y]; }
 
         //! Passes movement request to animator class and updates inner state.
         //! \param from_x x coord of Rect on field.
@@ -143,6 +197,14 @@ class Game
         //! \param to_y y coord where to move.
         void merge_to(int from_x, int from_y, int to_x, int to_y);
 
+        //! Sends queued turns, while \ref can_play allows.
+        void send_moves();
+
+        //! Continues the game after the session was resumed. Turns sent before the connection was lost are forgotten.
+        //! \param data State of the server.
+        //! \param changed True if the state differs from the game's, which is replaced by it.
+        void resumed(const client_data_tuple& data, bool changed);
+
         //! Processes play_event retrieved from the server.
         //! \param pl_event reference to \ref play_event.
         void process_play(const play_event& pl_event);
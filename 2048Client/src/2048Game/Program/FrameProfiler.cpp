@@ -0,0 +1,66 @@
+#include "FrameProfiler.hpp"
+#include "../Definitions/Definitions.hpp"
+
+FrameProfiler::FrameProfiler() : m_current(), m_frames(), m_phases(), m_next(0), m_count(0), m_animations(0), m_rtt(0)
+{
+    m_mark = m_last_frame = clock::now();
+}
+
+void FrameProfiler::end_frame(std::size_t animations, long long rtt)
+{
+    clock::time_point now = clock::now();
+    m_frames[m_next] = std::chrono::duration_cast<std::chrono::microseconds>(now - m_last_frame).count();
+    for (int phase = 0; phase < MAX_PHASES; ++phase)
+        m_phases[m_next][phase] = m_current[phase];
+    m_last_frame = now;
+    m_animations = animations;
+    m_rtt = rtt;
+
+    if (m_log.is_open())
+    {
+        m_log << std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() << ',' << m_frames[m_next];
+        for (int phase = 0; phase < MAX_PHASES; ++phase)
+            m_log << ',' << m_current[phase];
+        m_log << ',' << animations << ',' << rtt << '\n';
+    }
+
+    m_next = (m_next + 1) % HISTORY;
+    if (m_count < HISTORY)
+        ++m_count;
+}
+
+bool FrameProfiler::toggle_log()
+{
+    if (m_log.is_open())
+    {
+        m_log.close();
+        return false;
+    }
+
+    m_log.clear();
+    m_log.open(Definitions::PROFILE_FILE_NAME, std::ios::app);
+    if (!m_log)
+        return false;
+    m_log.seekp(0, std::ios::end);
+    if (m_log.tellp() == 0)
+        m_log << "time_ms,frame_us,events_us,animation_us,draw_us,present_us,animations,play_rtt_us\n";
+    return true;
+}
+
+double FrameProfiler::average_ms(Phases phase) const
+{
+    if (!m_count)
+        return 0;
+    long long sum = 0;
+    for (std::size_t i = 0; i < m_count; ++i)
+        sum += m_phases[i][phase];
+    return sum / 1000. / m_count;
+}
+
+double FrameProfiler::fps() const
+{
+    long long sum = 0;
+    for (std::size_t i = 0; i < m_count; ++i)
+        sum += m_frames[i];
+    return sum ? m_count * 1000000. / sum : 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+/**!
+    \ingroup client
+    \brief Measures duration of frames and of their phases, optionally logs them into CSV file.
+
+    Program::start() marks end of each phase of a frame, which is drawn. Last \ref HISTORY frames are kept
+    for averages and for the graph of GameWindow::display_profiler().
+    \sa GameWindow
+*/
+class FrameProfiler
+{
+    public:
+        //! Phases of a frame.
+        enum Phases
+        {
+            EVENTS,     //!< Handling of SDL events and responses of the server.
+            ANIMATION,  //!< Animating of blocks.
+            DRAW,       //!< Drawing of the scene.
+            PRESENT,    //!< Presenting and waiting for next frame.
+            MAX_PHASES,
+        };
+
+        static const std::size_t HISTORY = 120; //!< Number of kept frames.
+
+        //! Constructs profiler without history.
+        FrameProfiler();
+
+        //! Starts measuring of the first phase of a frame.
+        void start() { m_mark = clock::now(); }
+
+        //! Ends a phase and starts the next one.
+        //! \param phase Ended phase.
+        void end_phase(Phases phase)
+        {
+            clock::time_point now = clock::now();
+            m_current[phase] = std::chrono::duration_cast<std::chrono::microseconds>(now - m_mark).count();
+            m_mark = now;
+        }
+
+        //! Ends a frame and stores it into history and the log.
+        //! \param animations Number of running animations.
+        //! \param rtt Smoothed round trip time of plays in microseconds.
+        void end_frame(std::size_t animations, long long rtt);
+
+        //! Starts or stops logging into Definitions::PROFILE_FILE_NAME.
+        //! \return True if logging was started, false if it was stopped or the file cannot be opened.
+        bool toggle_log();
+
+        //! Tells whether frames are logged.
+        //! \return True if they are, false otherwise.
+        bool is_logging() const { return m_log.is_open(); }
+
+        //! Gets number of kept frames.
+        //! \return Number of frames, at most \ref HISTORY.
+        std::size_t size() const { return m_count; }
+
+        //! Gets duration of a kept frame.
+        //! \param age 0 for the last frame, 1 for the one before and so on.
+        //! \return Duration in milliseconds.
+        double frame_ms(std::size_t age) const { return m_frames[(m_next + HISTORY - 1 - age) % HISTORY] / 1000.; }
+
+        //! Gets duration of a phase of the last frame.
+        //! \param phase The phase.
+        //! \return Duration in milliseconds.
+        double last_ms(Phases phase) const { return m_current[phase] / 1000.; }
+
+        //! Gets average duration of a phase over kept frames.
+        //! \param phase The phase.
+        //! \return Duration in milliseconds.
+        double average_ms(Phases phase) const;
+
+        //! Gets frames per second over kept frames.
+        //! \return Frames per second, 0 if there are none.
+        double fps() const;
+
+        //! Gets number of running animations in the last frame.
+        //! \return Number of animations.
+        std::size_t animations() const { return m_animations; }
+
+        //! Gets smoothed round trip time of plays in the last frame.
+        //! \return Round trip time in milliseconds, 0 if not measured yet.
+        double rtt_ms() const { return m_rtt / 1000.; }
+
+    private:
+        using clock = std::chrono::steady_clock; //!< Clock used for measuring.
+
+        clock::time_point m_mark;                           //!< End of the last phase.
+        clock::time_point m_last_frame;                     //!< End of the last frame.
+        long long m_current[MAX_PHASES];                    //!< Phases of the current frame in microseconds.
+        long long m_frames[HISTORY];                        //!< Durations of kept frames in microseconds.
+        long long m_phases[HISTORY][MAX_PHASES];            //!< Phases of kept frames in microseconds.
+        std::size_t m_next;                                 //!< Index of next frame in the history.
+        std::size_t m_count;                                //!< Number of kept frames.
+        std::size_t m_animations;                           //!< Running animations in the last frame.
+        long long m_rtt;                                    //!< Round trip time of plays in the last frame in microseconds.
+        std::ofstream m_log;                                //!< CSV log, closed if not logging.
+};
@@ -1,6 +1,8 @@
 #include <SDL.h>
 #include <SDL_ttf.h>
 #include <iostream>
+#include <fstream>
+#include <memory>
 #include "Program.hpp"
 #include "../Window/GameWindow.hpp"
 #include "../Game/Game.hpp"
@@ -8,32 +10,137 @@
 bool Program::m_is_running = false;
 int Program::m_ret_value = EXIT_SUCCESS;
 
-int Program::start(const client_data_tuple& data, client& cl)
+int Program::start(client& cl, std::future<void>& logged_in, std::future<client_data_tuple>& data)
 {
-    GameWindow window(Definitions::GAME_WINDOW_WIDTH, Definitions::GAME_WINDOW_HEIGHT, Definitions::GAME_WINDOW_NAME);
-    NumberedRect::init_numbers(window);
-    Game game(window, data, cl);
-    game.start();
+    GameWindow window(Definitions::GAME_WINDOW_WIDTH, Definitions::GAME_WINDOW_HEIGHT, Definitions::GAME_WINDOW_NAME, SDL_WINDOW_HIDDEN);
+    FrameProfiler& profiler = window.get_profiler();
+    std::unique_ptr<Game> cached_game;
+    client_data_tuple cached;
     m_is_running = true;
     SDL_Event event;
 
+    // Cached state is only shown, turns cannot be played until the server sends the real state.
+    // Retrieved data do not wake up the loop, so it waits for events only shortly.
+    while (data.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        if (!cached_game)
+        {
+            if (logged_in.wait_for(std::chrono::seconds(0)) == std::future_status::ready && load_state(cl.get_user(), cached))
+            {
+                cached_game.reset(new Game(window, cached, cl));
+                window.show();
+            }
+            else if (SDL_WaitEventTimeout(&event, Definitions::STARTUP_WAIT_MS) && event.type == SDL_QUIT) // e.g. interrupted console
+                return m_ret_value;
+            continue;
+        }
+
+        if (!cached_game->needs_redraw() && SDL_WaitEventTimeout(&event, Definitions::STARTUP_WAIT_MS))
+            handle_cached_event(*cached_game, event);
+        profiler.start();
+        while (SDL_PollEvent(&event))
+        {
+            handle_cached_event(*cached_game, event);
+        }
+        if (!is_running())
+            return m_ret_value;
+        if (!cached_game->needs_redraw())
+            continue;
+        profiler.end_phase(FrameProfiler::EVENTS);
+        draw_frame(window, *cached_game, 0);
+    }
+
+    client_data_tuple confirmed = data.get();
+    std::unique_ptr<Game> game_ptr(std::move(cached_game));
+    if (!game_ptr)
+        game_ptr.reset(new Game(window, confirmed, cl));
+    else if (confirmed != cached) // played elsewhere since the state was cached
+        game_ptr->load(confirmed);
+    Game& game = *game_ptr;
+    game.start();
+    window.show();
+
     std::cout << "OK." << std::endl << "Closing console..." << std::endl;
+#ifdef _WIN32
     FreeConsole();
+#endif
+
+    // Responses wake up the loop, when it waits for events.
+    cl.start_async([]()
+    {
+        SDL_Event wake;
+        SDL_zero(wake);
+        wake.type = SDL_USEREVENT;
+        SDL_PushEvent(&wake);
+    });
+    game.enable_resume();
 
     while (is_running())
     {
+        // When nothing changes, sleep until an event comes instead of redrawing the same frame.
+        if (!game.needs_redraw() && SDL_WaitEventTimeout(&event, Definitions::IDLE_WAIT_MS))
+            game.event_handler(event);
+        profiler.start();
         while (SDL_PollEvent(&event))
         {
             game.event_handler(event);
         }
-        game.animate();
-        window.clear();
-        window.add(game.get_background());
-        window.add(game.get_rects());
-        window.display_game_over(game.display_game_over());
-        window.display_score();
-        window.display_stats_button();
-        window.render_finish();
+        game.receive();
+        if (!game.needs_redraw())
+            continue;
+        profiler.end_phase(FrameProfiler::EVENTS);
+        draw_frame(window, game, cl.get_play_rtt());
     }
+    save_state(cl.get_user(), game.get_data());
     return m_ret_value;
 }
+
+void Program::handle_cached_event(Game& game, const SDL_Event& event)
+{
+    if (event.type == SDL_QUIT || event.type == SDL_WINDOWEVENT || event.type == SDL_RENDER_TARGETS_RESET)
+        game.event_handler(event);
+}
+
+bool Program::load_state(const std::string& user, client_data_tuple& data)
+{
+    std::ifstream file(Definitions::STATE_FILE_NAME);
+    std::string name, blocks;
+    bool won;
+    int score;
+    if (!(file >> name >> blocks >> won >> score) || name != user)
+        return false;
+    auto vec = split(blocks, '|');
+    if (vec.size() != Definitions::BLOCK_COUNT_X * Definitions::BLOCK_COUNT_Y)
+        return false;
+    for (const auto& block : vec)
+        if (block.empty() || block.size() > 2 || block.find_first_not_of("0123456789") != std::string::npos || std::stoi(block) >= Blocks::MAX_BLOCKS)
+            return false;
+    data = client_data_tuple(blocks, won, score);
+    return true;
+}
+
+void Program::save_state(const std::string& user, const client_data_tuple& data)
+{
+    std::ofstream file(Definitions::STATE_FILE_NAME, std::ios::trunc);
+    file << user << std::endl << std::get<0>(data) << std::endl << std::get<1>(data) << std::endl << std::get<2>(data) << std::endl;
+}
+
+void Program::draw_frame(GameWindow& window, Game& game, long long rtt)
+{
+    FrameProfiler& profiler = window.get_profiler();
+    std::size_t animations = game.get_animator().size();
+    game.animate();
+    profiler.end_phase(FrameProfiler::ANIMATION);
+    window.clear();
+    window.add(game.get_background());
+    window.add(game.get_rects());
+    window.display_game_over(game.display_game_over());
+    window.display_score();
+    window.display_stats_button();
+    window.display_profiler();
+    profiler.end_phase(FrameProfiler::DRAW);
+    window.render_finish();
+    profiler.end_phase(FrameProfiler::PRESENT);
+    profiler.end_frame(animations, rtt);
+    game.drawn();
+}
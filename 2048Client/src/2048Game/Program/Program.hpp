@@ -1,8 +1,13 @@
 #pragma once
+#include <SDL.h>
 #include <vector>
 #include <string>
+#include <future>
 #include "../../client.hpp"
 
+class GameWindow;
+class Game;
+
 /**!
     \ingroup client
     \brief Static class for handling program existence and SDL events.
@@ -10,11 +15,20 @@
 class Program
 {
     public:
-        //! Starts the program
-        //! \param data Data 
+        //! Starts the program. The window, its fonts and textures are prepared, while the user logs in.
+        //! Last known state of the user is shown after the login, until the server sends the real one.
         //! \param cl \ref client to use.
+        //! \param logged_in Becomes ready, when the user is logged in.
+        //! \param data Data of the user, which is being retrieved from the server.
         //! \return Exit code after program finishes. Unused.
-        static int start(const client_data_tuple& data, client& cl);
+        static int start(client& cl, std::future<void>& logged_in, std::future<client_data_tuple>& data);
+
+        //! Animates, draws and presents one frame of the game, measuring its phases by profiler of the window.
+        //! Events of the frame have to be handled already, its FrameProfiler::EVENTS phase ended.
+        //! \param window Window to draw into.
+        //! \param game Game to draw.
+        //! \param rtt Smoothed round trip time of plays in microseconds, shown by the profiler.
+        static void draw_frame(GameWindow& window, Game& game, long long rtt);
 
         //! Tells whether program is running
         //! \return True if running, false otherwise.
@@ -24,6 +38,22 @@ class Program
         static void stop() { m_is_running = false; }
 
     private:
+        //! Handles event while cached state is shown. Only quitting and window events are handled, turns are ignored.
+        //! \param game Game showing the cached state.
+        //! \param event The event.
+        static void handle_cached_event(Game& game, const SDL_Event& event);
+
+        //! Loads last known state of a user from Definitions::STATE_FILE_NAME.
+        //! \param user Name of the user.
+        //! \param data Loaded state.
+        //! \return True if state of the user was cached, false otherwise.
+        static bool load_state(const std::string& user, client_data_tuple& data);
+
+        //! Saves state of a user into Definitions::STATE_FILE_NAME.
+        //! \param user Name of the user.
+        //! \param data State to save.
+        static void save_state(const std::string& user, const client_data_tuple& data);
+
         static bool m_is_running; //!< Indicates whether program is running.
         static int m_ret_value; //!< Stores return value.
 
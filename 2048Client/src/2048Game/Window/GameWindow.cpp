@@ -1,45 +1,136 @@
+#include <cstdio>
 #include <SDL.h>
 #include "GameWindow.hpp"
+#include "../Definitions/NumberedRect.hpp"
 #include "../Game/Game.hpp"
 
 void GameWindow::add(const Rects& objects)
 {
-    for (auto iter = std::begin(objects); iter != std::end(objects); ++iter)
-        iter->draw(*this);
+    SDL_Renderer* renderer = const_cast<SDL_Renderer*>(get_renderer());
+    if (!background_valid && background_texture != nullptr)
+    {
+        if (SDL_SetRenderTarget(renderer, background_texture) == 0)
+        {
+            fill(objects);
+            SDL_SetRenderTarget(renderer, NULL);
+            background_valid = true;
+        }
+        else
+        {
+            SDL_DestroyTexture(background_texture);
+            background_texture = nullptr;
+        }
+    }
+
+    if (background_valid)
+        SDL_RenderCopy(renderer, background_texture, NULL, NULL);
+    else
+        fill(objects);
 }
 
 void GameWindow::add(const NumberedRects& objects)
 {
-    for (auto iter = begin(objects); iter != end(objects); ++iter)
-        for (auto jter = begin(*iter); jter != end(*iter); ++jter)
-            if (*jter != nullptr)
-                (*jter)->draw(*this);
+    SDL_Renderer* renderer = const_cast<SDL_Renderer*>(get_renderer());
+    for (auto& batch : tile_batches)
+        batch.clear();
+    for (const auto& tile : objects)
+    {
+        if (tile.empty() || tile.get_rect().w > Definitions::BLOCK_SIZE_X)
+            continue;
+        if ((std::size_t) tile.get_number() >= tile_batches.size())
+            tile_batches.resize(tile.get_number() + 1);
+        tile_batches[tile.get_number()].push_back(tile.get_rect());
+    }
+
+    for (std::size_t number = 0; number < tile_batches.size(); ++number)
+    {
+        if (tile_batches[number].empty())
+            continue;
+        SDL_Color color = Definitions::get_block_color((Blocks) number);
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRects(renderer, tile_batches[number].data(), (int) tile_batches[number].size());
+    }
+    for (std::size_t number = 0; number < tile_batches.size(); ++number)
+    {
+        if (tile_batches[number].empty())
+            continue;
+        std::string text = std::to_string(pow2(number));
+        for (const auto& rect : tile_batches[number])
+            number_atlas.draw(text, rect, Definitions::WHITE_COLOR);
+    }
+
+    for (const auto& tile : objects)
+        if (!tile.empty() && tile.get_rect().w > Definitions::BLOCK_SIZE_X)
+        {
+            tile.draw(*this);
+            number_atlas.draw(std::to_string(pow2(tile.get_number())), tile.get_rect(), Definitions::WHITE_COLOR);
+        }
+}
+
+void GameWindow::display_profiler()
+{
+    if (!showing_profiler)
+        return;
+
+    const int LINE = 16, BAR_WIDTH = 2, GRAPH_HEIGHT = 40, PX_PER_MS = 2;
+    const int width = (int) FrameProfiler::HISTORY * BAR_WIDTH + 8, height = 4 * LINE + GRAPH_HEIGHT + 12;
+    SDL_Renderer* renderer = const_cast<SDL_Renderer*>(get_renderer());
+    SDL_Rect area = { 4, Definitions::GAME_HEIGHT - height - 4, width, height };
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+    SDL_RenderFillRect(renderer, &area);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    char lines[4][96];
+    snprintf(lines[0], sizeof(lines[0]), "FPS %.1f  frame %.2f ms", profiler.fps(), profiler.size() ? profiler.frame_ms(0) : 0.);
+    snprintf(lines[1], sizeof(lines[1]), "events %.2f  anim %.2f  draw %.2f", profiler.average_ms(FrameProfiler::EVENTS),
+        profiler.average_ms(FrameProfiler::ANIMATION), profiler.average_ms(FrameProfiler::DRAW));
+    snprintf(lines[2], sizeof(lines[2]), "present %.2f ms  animations %u", profiler.average_ms(FrameProfiler::PRESENT), (unsigned) profiler.animations());
+    snprintf(lines[3], sizeof(lines[3]), "play rtt %.1f ms%s", profiler.rtt_ms(), profiler.is_logging() ? "  csv" : "");
+    for (int i = 0; i < 4; ++i)
+    {
+        std::string text = lines[i];
+        SDL_Rect rect = { area.x + 4, area.y + 4 + i * LINE, text_atlas.width(text) * LINE / text_atlas.height(), LINE };
+        text_atlas.draw(text, rect, Definitions::WHITE_COLOR);
+    }
+
+    // Graph of frames, newest on the right, line marks duration of a frame at Definitions::TARGET_FPS.
+    int bottom = area.y + area.h - 4;
+    profiler_bars.clear();
+    for (std::size_t age = 0; age < profiler.size(); ++age)
+    {
+        int bar = (int) (profiler.frame_ms(age) * PX_PER_MS);
+        if (bar > GRAPH_HEIGHT)
+            bar = GRAPH_HEIGHT;
+        profiler_bars.push_back({ area.x + 4 + (int) (FrameProfiler::HISTORY - 1 - age) * BAR_WIDTH, bottom - bar, BAR_WIDTH, bar });
+    }
+    SDL_SetRenderDrawColor(renderer, 120, 200, 120, SDL_ALPHA_OPAQUE);
+    SDL_RenderFillRects(renderer, profiler_bars.data(), (int) profiler_bars.size());
+    int target = bottom - (int) (1000. / Definitions::TARGET_FPS * PX_PER_MS);
+    SDL_SetRenderDrawColor(renderer, 220, 80, 80, SDL_ALPHA_OPAQUE);
+    SDL_RenderDrawLine(renderer, area.x + 4, target, area.x + area.w - 4, target);
 }
 
-GameWindow::GameWindow(int width, int height, std::string name) : Window(width, height, name)
+GameWindow::GameWindow(int width, int height, std::string name, Uint32 flags) : Window(width, height, name, flags),
+    text_atlas(*this, Definitions::DEFAULT_GAME_FONT_SIZE), number_atlas(*this, Definitions::BLOCK_SIZE_X),
+    game_over_text("GAME OVER! Press R for restart."), game_score_text("Score: 0"), stats_text("Show Stats"),
+    background_valid(false), tile_batches(Blocks::MAX_BLOCKS), showing_profiler(false)
 {
-    game_window_font = TTF_OpenFont(Definitions::DEFAULT_FONT_NAME.c_str(), Definitions::DEFAULT_GAME_FONT_SIZE);
-
-    SDL_Surface* textSurface = TTF_RenderText_Blended(game_window_font, "GAME OVER! Press R for restart.", Definitions::BLACK_COLOR);
-    game_over_texture = SDL_CreateTextureFromSurface(const_cast<SDL_Renderer*>(get_renderer()), textSurface);
-    game_over_rect = { (Definitions::GAME_WIDTH - textSurface->w) / 2, (Definitions::GAME_HEIGHT - textSurface->h) / 2, textSurface->w, textSurface->h };
-    SDL_FreeSurface(textSurface);
-
-    textSurface = TTF_RenderText_Blended(game_window_font, "Score: 0", Definitions::WHITE_COLOR);
-    game_score_texture = SDL_CreateTextureFromSurface(const_cast<SDL_Renderer*>(get_renderer()), textSurface);
-    game_score_rect = { 4, 4, textSurface->w, Definitions::GAME_Y - 8 };
-    SDL_FreeSurface(textSurface);
-
-    textSurface = TTF_RenderText_Blended(game_window_font, "Show Stats", Definitions::WHITE_COLOR);
-    stats_texture = SDL_CreateTextureFromSurface(const_cast<SDL_Renderer*>(get_renderer()), textSurface);
-    stats_rect = { Definitions::GAME_WIDTH - textSurface->w - 4, 4, textSurface->w, Definitions::GAME_Y - 8 };
-    SDL_FreeSurface(textSurface);
+    profiler_bars.reserve(FrameProfiler::HISTORY);
+    background_texture = SDL_CreateTexture(const_cast<SDL_Renderer*>(get_renderer()), SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+    if (background_texture != nullptr)
+        SDL_SetTextureBlendMode(background_texture, SDL_BLENDMODE_NONE); // colors are opaque, even with zero alpha
+    for (auto& batch : tile_batches)
+        batch.reserve(Definitions::BLOCK_COUNT_X * Definitions::BLOCK_COUNT_Y);
+
+    int width_over = text_atlas.width(game_over_text);
+    game_over_rect = { (Definitions::GAME_WIDTH - width_over) / 2, (Definitions::GAME_HEIGHT - text_atlas.height()) / 2, width_over, text_atlas.height() };
+    game_score_rect = { 4, 4, text_atlas.width(game_score_text), Definitions::GAME_Y - 8 };
+    int width_stats = text_atlas.width(stats_text);
+    stats_rect = { Definitions::GAME_WIDTH - width_stats - 4, 4, width_stats, Definitions::GAME_Y - 8 };
 }
 GameWindow::~GameWindow()
 {
-    TTF_CloseFont(game_window_font);
-    SDL_DestroyTexture(game_over_texture);
-    SDL_DestroyTexture(stats_texture);
-    if (game_score_texture != nullptr)
-        SDL_DestroyTexture(game_score_texture);
+    if (background_texture != nullptr)
+        SDL_DestroyTexture(background_texture);
 }
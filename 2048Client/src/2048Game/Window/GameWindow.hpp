@@ -1,7 +1,10 @@
 #pragma once
 #include <memory>
+#include <vector>
 #include <SDL.h>
 #include "Window.hpp"
+#include "GlyphAtlas.hpp"
+#include "../Program/FrameProfiler.hpp"
 #include "../Definitions/Definitions.hpp"
 
 /**!
@@ -15,38 +18,57 @@ class GameWindow : public Window
         //! \param width Window width
         //! \param height Window height
         //! \param name Window title
+        //! \param flags SDL_WindowFlags of the window.
         //! \sa Window::Window()
-        GameWindow(int width, int height, std::string name);
+        GameWindow(int width, int height, std::string name, Uint32 flags = 0);
         //! Destructor for Game Window
         ~GameWindow();
-        //! Adds Rects for showing them later as the background.
+        //! Draws the background. It is rendered into a texture on first call and later calls only copy the texture,
+        //! so the background must not change (see \ref invalidate_background).
         //! \param background Rects representing the background.
         void add(const Rects& background);
 
-        //! Adds NumberedRects for showing as game state.
+        //! Draws NumberedRects as game state. Blocks of the same number are filled by a single draw call,
+        //! blocks enlarged by merging are drawn last, so they are shown over their neighbours.
         //! \param rects NumberedRects representing game state.
         void add(const NumberedRects& rects);
 
+        //! Makes the background to be rendered again, e.g. when render targets were reset.
+        void invalidate_background() { background_valid = false; }
+
         //! Displayes game over message.
         //! \param yes Toggle for displaying or not.
-        void display_game_over(bool yes) { if (yes) SDL_RenderCopy(const_cast<SDL_Renderer*>(get_renderer()), game_over_texture, NULL, &game_over_rect); }
+        void display_game_over(bool yes) { if (yes) text_atlas.draw(game_over_text, game_over_rect, Definitions::BLACK_COLOR); }
 
         //! Displays game score.
-        void display_score() { SDL_RenderCopy(const_cast<SDL_Renderer*>(get_renderer()), game_score_texture, NULL, &game_score_rect); }
+        void display_score() { text_atlas.draw(game_score_text, game_score_rect, Definitions::WHITE_COLOR); }
 
         //! Displays statistics button.
-        void display_stats_button() { SDL_RenderCopy(const_cast<SDL_Renderer*>(get_renderer()), stats_texture, NULL, &stats_rect); }
+        void display_stats_button() { text_atlas.draw(stats_text, stats_rect, Definitions::WHITE_COLOR); }
 
-        //! Updates game score from string.
+        //! Updates game score from string. Text is composed from \ref text_atlas, when it is drawn.
         //! \param score string to show.
-        void update_score(std::string score)
+        void update_score(const std::string& score)
         {
-            SDL_Surface* textSurface = TTF_RenderText_Blended(game_window_font, ("Score: " + score).c_str(), Definitions::WHITE_COLOR);
-            game_score_texture = SDL_CreateTextureFromSurface(const_cast<SDL_Renderer*>(get_renderer()), textSurface);
-            game_score_rect.w = textSurface->w;
-            SDL_FreeSurface(textSurface);
+            game_score_text = "Score: " + score;
+            game_score_rect.w = text_atlas.width(game_score_text);
         }
         
+        //! Displays overlay with frame rate, durations of frame phases, graph of last frames, running animations and round trip time of plays.
+        //! Nothing is displayed, unless the overlay was toggled on.
+        void display_profiler();
+
+        //! Shows or hides the profiler overlay (F3).
+        void toggle_profiler() { showing_profiler = !showing_profiler; }
+
+        //! Tells whether the profiler overlay is shown.
+        //! \return True if it is, false otherwise.
+        bool is_showing_profiler() const { return showing_profiler; }
+
+        //! Getter for the profiler.
+        //! \return Reference to profiler of frames of this window.
+        FrameProfiler& get_profiler() { return profiler; }
+
         //! Tells whether mouse was clicked in Stats button.
         //! \param event SDL_MouseButtonEvent with information about mouse click.
         //! \return True if stats button was clicked, false otherwise.
@@ -57,11 +79,18 @@ class GameWindow : public Window
         }
 
     private:
-        TTF_Font* game_window_font;         //!< Font used for whowing score.
-        SDL_Texture* game_over_texture;     //!< Texture used for text display of player's game over.
+        GlyphAtlas text_atlas;              //!< Glyphs used for showing texts of the window.
+        GlyphAtlas number_atlas;            //!< Glyphs used for showing numbers of blocks.
+        std::string game_over_text;         //!< Text display of player's game over.
         SDL_Rect game_over_rect;            //!< Position of game over text.
-        SDL_Texture* game_score_texture;    //!< Texture used for displaying score.
+        std::string game_score_text;        //!< Text displaying score.
         SDL_Rect game_score_rect;           //!< Position of game score.
-        SDL_Texture* stats_texture;         //!< Texture used for displaying stats button.
+        std::string stats_text;             //!< Text of stats button.
         SDL_Rect stats_rect;                //!< Position of stats button.
+        SDL_Texture* background_texture;    //!< Texture with rendered background, nullptr if render targets are not supported.
+        bool background_valid;              //!< Indicates, that background_texture contains the background.
+        std::vector<std::vector<SDL_Rect>> tile_batches; //!< Rects of blocks of each number, reused by every frame.
+        FrameProfiler profiler;             //!< Profiler of frames drawn in the window.
+        bool showing_profiler;              //!< Indicates, that the profiler overlay is shown.
+        std::vector<SDL_Rect> profiler_bars; //!< Bars of graph of frames, reused by every frame.
 };
@@ -0,0 +1,80 @@
+#include <stdexcept>
+#include "GlyphAtlas.hpp"
+#include "Window.hpp"
+
+GlyphAtlas::GlyphAtlas(Window& window, int size, const std::string& font_name) :
+    m_renderer(const_cast<SDL_Renderer*>(window.get_renderer())), m_texture(nullptr)
+{
+    TTF_Font* font = TTF_OpenFont(font_name.c_str(), size);
+    if (font == nullptr)
+        throw std::runtime_error("Failed to open font " + font_name + ": " + TTF_GetError());
+
+    SDL_Surface* glyphs[GLYPHS];
+    int cell = 1;
+    m_height = TTF_FontHeight(font);
+    for (int i = 0; i < GLYPHS; ++i)
+    {
+        char text[] = { (char) (FIRST_GLYPH + i), '\0' };
+        glyphs[i] = TTF_RenderText_Blended(font, text, Definitions::WHITE_COLOR);
+        int advance = 0;
+        TTF_SizeText(font, text, &advance, NULL);
+        m_glyphs[i] = { 0, 0, advance, m_height };
+        if (glyphs[i] != nullptr && glyphs[i]->w > cell)
+            cell = glyphs[i]->w;
+    }
+    TTF_CloseFont(font);
+
+    int rows = (GLYPHS + COLUMNS - 1) / COLUMNS;
+    SDL_Surface* atlas = SDL_CreateRGBSurface(0, COLUMNS * cell, rows * m_height, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    for (int i = 0; i < GLYPHS; ++i)
+    {
+        m_glyphs[i].x = (i % COLUMNS) * cell;
+        m_glyphs[i].y = (i / COLUMNS) * m_height;
+        if (glyphs[i] == nullptr)
+            continue;
+        if (atlas != nullptr)
+        {
+            SDL_Rect target = { m_glyphs[i].x, m_glyphs[i].y, glyphs[i]->w, glyphs[i]->h };
+            SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE); // copy alpha as it is
+            SDL_BlitSurface(glyphs[i], NULL, atlas, &target);
+        }
+        SDL_FreeSurface(glyphs[i]);
+    }
+
+    if (atlas != nullptr)
+    {
+        m_texture = SDL_CreateTextureFromSurface(m_renderer, atlas);
+        SDL_FreeSurface(atlas);
+    }
+    if (m_texture == nullptr)
+        throw std::runtime_error(std::string("Failed to create glyph atlas: ") + SDL_GetError());
+    SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+}
+
+int GlyphAtlas::width(const std::string& text) const
+{
+    int res = 0;
+    for (char c : text)
+        if (c >= FIRST_GLYPH && c <= LAST_GLYPH)
+            res += m_glyphs[c - FIRST_GLYPH].w;
+    return res;
+}
+
+void GlyphAtlas::draw(const std::string& text, const SDL_Rect& rect, const SDL_Color& color) const
+{
+    int total = width(text);
+    if (total == 0)
+        return;
+
+    SDL_SetTextureColorMod(m_texture, color.r, color.g, color.b);
+    int x = 0;
+    for (char c : text)
+    {
+        if (c < FIRST_GLYPH || c > LAST_GLYPH)
+            continue;
+        const SDL_Rect& glyph = m_glyphs[c - FIRST_GLYPH];
+        SDL_Rect target = { rect.x + x * rect.w / total, rect.y, (x + glyph.w) * rect.w / total - x * rect.w / total, rect.h };
+        SDL_RenderCopy(m_renderer, m_texture, &glyph, &target);
+        x += glyph.w;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include "../Definitions/Definitions.hpp"
+
+class Window;
+
+/**!
+    \ingroup client
+    \brief Single texture with all printable ASCII characters of a font at one size.
+    Text is composed from the glyphs at draw time, so changing text does not rasterize the font nor upload textures.
+    Glyphs are rendered white and colored by color modulation.
+    \sa GameWindow
+*/
+class GlyphAtlas
+{
+    public:
+        static const char FIRST_GLYPH = ' ';    //!< First character in the atlas.
+        static const char LAST_GLYPH = '~';     //!< Last character in the atlas.
+        static const int COLUMNS = 16;          //!< Glyphs in a row of the atlas texture.
+
+        //! Rasterizes the font and uploads it to the renderer of the window.
+        //! \param window Window, whose renderer will draw the text.
+        //! \param size Font size.
+        //! \param font_name Font to use. Default Definitions::DEFAULT_FONT_NAME.
+        //! \throws std::runtime_error When the font cannot be opened or the texture cannot be created.
+        GlyphAtlas(Window& window, int size, const std::string& font_name = Definitions::DEFAULT_FONT_NAME);
+
+        //! Destroyes the atlas texture.
+        ~GlyphAtlas() { SDL_DestroyTexture(m_texture); }
+
+        //! Computes width of a text.
+        //! \param text Text to measure. Characters outside of the atlas are skipped.
+        //! \return Width in pixels at the atlas size.
+        int width(const std::string& text) const;
+
+        //! Gets height of a line.
+        //! \return Height in pixels at the atlas size.
+        int height() const { return m_height; }
+
+        //! Draws a text stretched into a rect.
+        //! \param text Text to draw. Characters outside of the atlas are skipped.
+        //! \param rect Rect to fill with the text.
+        //! \param color Color of the text.
+        void draw(const std::string& text, const SDL_Rect& rect, const SDL_Color& color) const;
+
+    private:
+        static const int GLYPHS = LAST_GLYPH - FIRST_GLYPH + 1; //!< Number of glyphs in the atlas.
+
+        SDL_Renderer* m_renderer;       //!< Renderer, which owns the texture.
+        SDL_Texture* m_texture;         //!< Texture with all glyphs.
+        SDL_Rect m_glyphs[GLYPHS];      //!< Positions of glyphs in the texture, their widths are advances.
+        int m_height;                   //!< Height of a line.
+
+        // Owns texture
+        GlyphAtlas(const GlyphAtlas&) = delete;
+        GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+};
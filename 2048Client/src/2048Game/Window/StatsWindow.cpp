@@ -8,7 +8,10 @@ void StatsWindow::wait_for_close()
     SDL_Event event;
     while (show)
     {
-        while (SDL_PollEvent(&event))
+        // Window is redrawn only by switch_stats(), so it sleeps until the user does something.
+        if (!SDL_WaitEventTimeout(&event, Definitions::IDLE_WAIT_MS))
+            continue;
+        do
         {
             if (event.window.event == SDL_WINDOWEVENT_CLOSE)
             {
@@ -21,7 +24,7 @@ void StatsWindow::wait_for_close()
                     switch_stats();
                 break;
             }
-        }
+        } while (SDL_PollEvent(&event));
     }
     close();
 }
@@ -1,5 +1,6 @@
 #include <SDL.h>
 #include "Window.hpp"
+#include "../Definitions/Rect.hpp"
 #include "../Game/Game.hpp"
 
 Window::~Window()
@@ -13,3 +14,34 @@ void Window::clear() const
     SDL_SetRenderDrawColor(const_cast<SDL_Renderer*>(m_renderer), 255, 255, 255, SDL_ALPHA_OPAQUE);
     SDL_RenderClear(const_cast<SDL_Renderer*>(m_renderer));
 }
+
+
+void Window::render_finish()
+{
+    SDL_RenderPresent(const_cast<SDL_Renderer*>(m_renderer));
+    Uint32 elapsed = SDL_GetTicks() - m_frame_start;
+    if (m_limit_frames && elapsed < 1000 / Definitions::TARGET_FPS)
+        SDL_Delay(1000 / Definitions::TARGET_FPS - elapsed);
+    m_frame_start = SDL_GetTicks();
+}
+
+//! Compares two colors.
+//! \return True if colors are the same, false otherwise.
+static bool same_color(const SDL_Color& a, const SDL_Color& b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+void Window::fill(const Rects& rects)
+{
+    SDL_Renderer* renderer = const_cast<SDL_Renderer*>(m_renderer);
+    for (std::size_t i = 0; i < rects.size();)
+    {
+        const SDL_Color& color = rects[i].get_color();
+        m_batch.clear();
+        for (; i < rects.size() && same_color(rects[i].get_color(), color); ++i)
+            m_batch.push_back(rects[i].get_rect());
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRects(renderer, m_batch.data(), (int) m_batch.size());
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <memory>
 #include <string>
+#include <vector>
 #include <SDL.h>
 #include "../Definitions/Definitions.hpp"
 
@@ -17,8 +18,10 @@ class Window
         //! \param width Width of the window.
         //! \param height Height of the window.
         //! \param name Window title.
-        Window(int width, int height, std::string name) : m_window(SDL_CreateWindow(name.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 
-                width, height, 0)), m_renderer(SDL_CreateRenderer(const_cast<SDL_Window*>(m_window), -1, SDL_RENDERER_ACCELERATED)) { }
+        //! \param flags SDL_WindowFlags of the window, e.g. SDL_WINDOW_HIDDEN.
+        Window(int width, int height, std::string name, Uint32 flags = 0) : m_window(SDL_CreateWindow(name.c_str(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 
+                width, height, flags)), m_renderer(SDL_CreateRenderer(const_cast<SDL_Window*>(m_window), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC)),
+                m_frame_start(SDL_GetTicks()), m_limit_frames(true) { }
 
         //! Allows manipulation of SDL_Renderer related events.
         //! \return Const reference of used SDL_Rednerer.
@@ -27,6 +30,10 @@ class Window
         //! Clears the window
         void clear() const;
 
+        //! Fills Rects by a single draw call for each run of Rects of the same color.
+        //! \param rects Rects to fill, in drawing order.
+        void fill(const Rects& rects);
+
         //! Hides the widnow.
         void hide() const { SDL_HideWindow(m_window); }
 
@@ -39,7 +46,13 @@ class Window
         void warning(const std::string& text) const { SDL_ShowSimpleMessageBox(SDL_MessageBoxFlags::SDL_MESSAGEBOX_WARNING, "Warning", text.c_str(), m_window); }
 
         //! Finishes rendering of objects in the window.
-        void render_finish() const { SDL_RenderPresent(const_cast<SDL_Renderer*>(m_renderer)); }
+        //! Presenting waits for vertical sync, if the driver supports it. The rest of the frame is slept,
+        //! so frames are not drawn faster than Definitions::TARGET_FPS even without vsync or on faster displays.
+        void render_finish();
+
+        //! Enables or disables sleeping of \ref render_finish, e.g. to measure how fast frames can be drawn.
+        //! \param limit True to limit frames to Definitions::TARGET_FPS (default), false to draw as fast as possible.
+        void limit_frames(bool limit) { m_limit_frames = limit; }
         
         //! Closes the window. Closed window cannot be reopened.
         void close() { SDL_DestroyWindow(m_window); }
@@ -50,4 +63,7 @@ class Window
     protected:
         SDL_Window* m_window; //!< C-pointer to SDL_Window. \sa SDL_Window
         const SDL_Renderer* m_renderer; //!< C-pointer to const SDL_Renderer. \sa SDL_Renderer
+        Uint32 m_frame_start; //!< Ticks, when the last frame was presented.
+        bool m_limit_frames; //!< Indicates, that \ref render_finish sleeps the rest of the frame.
+        std::vector<SDL_Rect> m_batch; //!< Rects of a single draw call, reused by \ref fill.
 };
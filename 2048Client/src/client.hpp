@@ -1,6 +1,12 @@
 #pragma once
 #include <iostream>
 #include <deque>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <random>
 #ifdef _WIN32
     #include <conio.h>
     #define ENTER_CHAR 13
@@ -18,7 +24,7 @@ using boost::asio::ip::tcp;
 
 #ifndef _WIN32
     static struct termios old, nw;
-    char _getch()
+    inline char _getch()
     {
         tcgetattr(0, &old);
         nw = old;
@@ -34,19 +40,50 @@ using boost::asio::ip::tcp;
 /**!
     \ingroup client
     \brief Class representing a client being connected to the server.
+
+    Login and data requests block until the response comes. Plays and restarts of the game loop are asynchronous,
+    their handlers are called by \ref poll, which the game loop calls every frame, so rendering never waits for the server.
+
+    When resuming is enabled by \ref enable_resume, lost connection is reestablished by \ref poll with exponential backoff
+    and jitter, and the session is resumed by the token of the server. Client sends hash of its board, so the board
+    is sent back only if it differs from the server's.
 */
 class client
 {
     public:
+        static const std::size_t MAX_WRITE_QUEUE = 64; //!< Messages waiting for write, after which the server is considered unresponsive.
+        static const int MAX_THROTTLED_RETRIES = 5; //!< Times a throttled request is repeated, before it is considered timed out.
+        static const int MAX_RECONNECT_ATTEMPTS = 8; //!< Attempts to reconnect, before the connection is considered lost.
+        static const int RECONNECT_BASE_MS = 250; //!< Upper bound of delay before first attempt to reconnect, it doubles with each attempt.
+        static const int RECONNECT_MAX_MS = 8000; //!< Upper bound of delay between attempts to reconnect.
+
         //! Consttructor of the client.
         //! \param io_service reference to boost io_service.
         //! \param endpoint_iterator tcp resolver iterator.
         //! \param list reference to \ref listener for handling incomming messages from the server.
         //! \param connected reference to connected status
-        client(boost::asio::io_service& io_service, tcp::resolver::iterator endpoint_iterator, listener& list, bool& connected) :
-            m_io_service(io_service), m_socket(io_service), m_listener(list), m_connected(connected)
+        client(boost::asio::io_service& io_service, tcp::resolver::iterator endpoint_iterator, listener& list, std::atomic<bool>& connected) :
+            client(io_service, list, connected)
+        {
+            connect(endpoint_iterator);
+        }
+
+        //! Constructs client, which is not connected until \ref connect is called.
+        //! \param io_service reference to boost io_service.
+        //! \param list reference to \ref listener for handling incomming messages from the server.
+        //! \param connected reference to connected status
+        client(boost::asio::io_service& io_service, listener& list, std::atomic<bool>& connected) :
+            m_io_service(io_service), m_socket(io_service), m_heartbeat_timer(io_service), m_rtt(0), m_play_rtt(0), m_listener(list), m_connected(connected),
+            m_resuming(false), m_resume_sent(false), m_reconnects(0), m_jitter(std::random_device()())
         {
             m_connected = false;
+        }
+
+        //! Initiates connecting to the server.
+        //! \param endpoint_iterator tcp resolver iterator.
+        void connect(tcp::resolver::iterator endpoint_iterator)
+        {
+            m_endpoints = endpoint_iterator;
             boost::asio::async_connect(m_socket, endpoint_iterator, boost::bind(&client::handle_connect, this, boost::asio::placeholders::error));
         }
 
@@ -69,6 +106,18 @@ class client
         //! \return true if it is, false otherwise.
         bool is_connected() { return m_connected; }
 
+        //! Checks whether requests can be sent, i.e. client is connected and its session is not being resumed.
+        //! \return true if they can, false otherwise.
+        bool is_online() const { return m_connected && !m_resuming; }
+
+        //! Gets smoothed round trip time of plays, from sending to receiving of the response.
+        //! \return round trip time in microseconds, 0 if not measured yet.
+        long long get_play_rtt() const { return m_play_rtt; }
+
+        //! Gets round trip time measured by last heartbeat.
+        //! \return round trip time in microseconds, 0 if not measured yet.
+        long long get_rtt() const { return m_rtt; }
+
         //! Tries to log in to the server by reading login information from stdin
         //! \return true if client was authenticated, false otherwise.
         bool login()
@@ -90,17 +139,23 @@ class client
                     passwd += c;
             }
             
-            write(message(message_types::MSG_LOGIN + user + "+" + hasher::hash(passwd)));
             std::cout << std::endl << "Logging in: ... ";
-            if (m_listener.get_response() == message_types::MSG_LOGIN_OK)
+            if (request(message_types::MSG_LOGIN + user + "+" + hasher::hash(passwd)) == message_types::MSG_LOGIN_OK)
+            {
+                m_user = user;
                 return true;
+            }
             return false;
         }
 
-        //! Sends play request to the server.
+        //! Gets name of the logged in user.
+        //! \return the name, empty if \ref login did not succeed yet.
+        const std::string& get_user() const { return m_user; }
+
+        //! Sends play request to the server without waiting for the response.
         //! \param direction direction player played to.
-        //! \return \ref play_event as result of the play.
-        play_event play(Directions direction)
+        //! \param handler function called by \ref poll with \ref play_event as result of the play.
+        void play(Directions direction, std::function<void(const play_event&)> handler)
         {
             std::string msg = message_types::MSG_PLAY;
             switch (direction)
@@ -110,44 +165,261 @@ class client
                 case UP: msg += directions::UP; break;
                 case DOWN: msg += directions::DOWN; break;
             }
-            write(message(msg));
-            std::string rsp = m_listener.get_response();
-
-            if (compare_msg(rsp, message_types::MSG_PLAY_OK))
-                return play_event(rsp.substr(rsp.find("+") + 1));
-
-            throw invalid_message("Client recieved invalid play response.");
+            request_async(msg, [handler](const std::string& rsp)
+            {
+                if (!compare_msg(rsp, message_types::MSG_PLAY_OK))
+                    throw invalid_message("Client recieved invalid play response.");
+                handler(play_event(rsp.substr(rsp.find("+") + 1)));
+            });
         }
 
         //! Sends data request to the server.
         //! \return data received from the server.
         client_data_tuple get_data()
         {
-            write(message(message_types::MSG_DATA_REQ));
-            std::string data = m_listener.get_response();
+            std::string data = request(message_types::MSG_DATA_REQ);
             auto vec = split(data, '+');
             return make_tuple(vec[1], vec[2] == "1" ? true : false, std::stoi(vec[3]));
         }
 
-        //! Sends restart game request to the server.
-        //! \return std::vector of \ref Blocks and \ref coords spawned at the beginning of the game.
-        std::vector<random_block_record> restart()
+        //! Sends restart game request to the server without waiting for the response.
+        //! \param handler function called by \ref poll with \ref Blocks and \ref coords spawned at the beginning of the game.
+        void restart(std::function<void(const std::vector<random_block_record>&)> handler)
         {
-            write(message(message_types::MSG_RESTART));
-            std::string response = m_listener.get_response();
-            std::stringstream ss(response.substr(response.find("+") + 1));
-            std::vector<random_block_record> res;
-            random_block_record rng_block; int hlp;
-            while (ss >> hlp && ss >> rng_block.second.first && ss >> rng_block.second.second)
+            request_async(message_types::MSG_RESTART, [handler](const std::string& response)
             {
-                rng_block.first = static_cast<Blocks>(hlp);
-                res.push_back(std::move(rng_block));
+                std::stringstream ss(response.substr(response.find("+") + 1));
+                std::vector<random_block_record> res;
+                random_block_record rng_block; int hlp;
+                while (ss >> hlp && ss >> rng_block.second.first && ss >> rng_block.second.second)
+                {
+                    rng_block.first = static_cast<Blocks>(hlp);
+                    res.push_back(std::move(rng_block));
+                }
+                handler(res);
+            });
+        }
+
+        //! Switches responses to asynchronous delivery by \ref poll. Blocking requests must not be used afterwards.
+        //! \param notify function called by the network thread, when a response arrives.
+        void start_async(std::function<void()> notify) { m_listener.start_async(std::move(notify)); }
+
+        //! Requests token for resuming the session, so \ref poll reconnects, when the connection is lost.
+        //! Requests waiting for response, when the connection is lost, are forgotten. Called after \ref start_async.
+        //! \param state function returning current state of the game, its board hash and score are sent when resuming.
+        //! \param resumed function called by \ref poll, when the session was resumed, with state of the server
+        //! and with true if it differs from the sent one, or with empty state and false otherwise.
+        void enable_resume(std::function<client_data_tuple()> state, std::function<void(const client_data_tuple&, bool)> resumed)
+        {
+            m_state = std::move(state);
+            m_resumed = std::move(resumed);
+            request_async(message_types::MSG_TOKEN, [this](const std::string& rsp)
+            {
+                if (!compare_msg(rsp, message_types::MSG_TOKEN_OK))
+                    throw invalid_message("Client recieved invalid token response.");
+                m_token = rsp.substr(message_types::MSG_TOKEN_OK.length() + 1);
+            });
+        }
+
+        //! Calls handlers of received responses, repeats throttled requests, which are due, and resumes lost session. Called by the game loop.
+        //! When resuming is enabled, a response, which does not come in \ref SECONDS_UNTIL_TIMEOUT, closes the connection and resumes the session.
+        //! \throws connection_timed if a response does not come in \ref SECONDS_UNTIL_TIMEOUT and resuming is not enabled, or the server keeps throttling a request.
+        //! \throws cant_connect if connection was lost and resuming is not enabled or did not succeed, or if it was lost while requests are pending.
+        void poll()
+        {
+            auto now = std::chrono::steady_clock::now();
+            bool connected = m_connected; // responses received before the loss are handled first
+            receive(now);
+            if (!connected && !m_resuming && can_resume())
+                start_resume(now);
+            if (m_resuming)
+                resume(now);
+
+            // Throttled requests are repeated one by one in their order, so they do not compete for the same allowance.
+            bool repeating = std::any_of(m_sent.begin(), m_sent.end(), [](const pending_request& req) { return req.attempts > 0; });
+            if (!repeating && !m_throttled.empty() && m_throttled.front().time <= now)
+            {
+                send(std::move(m_throttled.front()));
+                m_throttled.pop_front();
             }
 
-            return std::move(res);
+            if (!m_sent.empty() && now - m_sent.front().time > std::chrono::seconds(SECONDS_UNTIL_TIMEOUT))
+            {
+                if (!can_resume())
+                    throw connection_timed("poll(): Connection timed out.", m_sent.front().msg.substr(0, m_sent.front().msg.find('-') + 1));
+                // connection may be half-open (peer gone without reset), it is closed and the session resumed over a new one
+                m_connected = false;
+                close();
+                if (!m_resuming)
+                    start_resume(now);
+                resume(now);
+            }
+            if (!m_connected && !m_resuming && (has_pending() || m_resumed))
+                throw cant_connect("Connection to the server was lost.");
         }
 
+        //! Checks whether some asynchronous request waits for its response.
+        //! \return true if it does, false otherwise.
+        bool has_pending() const { return !m_sent.empty() || !m_throttled.empty(); }
+
     private:
+        //! Calls handlers of received responses, throttled requests are moved to \ref m_throttled.
+        //! \param now time of the poll.
+        //! \throws connection_timed if the server keeps throttling a request.
+        void receive(std::chrono::steady_clock::time_point now)
+        {
+            std::string rsp;
+            while (m_listener.poll(rsp))
+            {
+                if (m_sent.empty())
+                    continue; // nothing waits for it
+                pending_request req = std::move(m_sent.front());
+                m_sent.pop_front();
+                if (!compare_msg(rsp, message_types::MSG_THROTTLE))
+                {
+                    if (compare_msg(req.msg, message_types::MSG_PLAY))
+                    {
+                        long long rtt = std::chrono::duration_cast<std::chrono::microseconds>(now - req.time).count();
+                        m_play_rtt = m_play_rtt ? (7 * m_play_rtt + rtt) / 8 : rtt;
+                    }
+                    req.handler(rsp);
+                    continue;
+                }
+                if (++req.attempts > MAX_THROTTLED_RETRIES)
+                    throw connection_timed("poll(): Server keeps throttling requests.", req.msg.substr(0, req.msg.find('-') + 1));
+
+                long long retry_after = 0;
+                try { retry_after = std::stoll(rsp.substr(message_types::MSG_THROTTLE.length())); }
+                catch (std::logic_error&) { throw invalid_message("Client recieved invalid throttle response."); }
+                if (retry_after > static_cast<long long>(SECONDS_UNTIL_TIMEOUT) * 1000)
+                    retry_after = static_cast<long long>(SECONDS_UNTIL_TIMEOUT) * 1000;
+                req.time = now + std::chrono::milliseconds(retry_after);
+                if (req.attempts > 1) // repeated request keeps its place before later throttled ones
+                    m_throttled.push_front(std::move(req));
+                else
+                    m_throttled.push_back(std::move(req));
+            }
+        }
+
+        //! Checks whether lost session can be resumed, i.e. resuming is enabled and the server sent its token.
+        //! \return true if it can, false otherwise.
+        bool can_resume() const { return m_resumed && !m_token.empty(); }
+
+        //! Starts resuming of the session, requests waiting for response are forgotten.
+        //! \param now time of the poll.
+        void start_resume(std::chrono::steady_clock::time_point now)
+        {
+            m_resuming = true;
+            m_resume_sent = false;
+            m_sent.clear();
+            m_throttled.clear();
+            m_reconnects = 0;
+            m_reconnect_at = now + backoff(0);
+        }
+
+        //! Reconnects, until the connection is reestablished, then sends resume request.
+        //! \param now time of the poll.
+        //! \throws cant_connect if all attempts to reconnect failed or the server refused to resume the session.
+        void resume(std::chrono::steady_clock::time_point now)
+        {
+            if (m_connected)
+            {
+                if (m_resume_sent)
+                    return;
+                m_resume_sent = true;
+                client_data_tuple state = m_state();
+                std::string msg = message_types::MSG_RESUME + m_token + "+" + hasher::board(std::get<0>(state)) + "+" + std::to_string(std::get<2>(state));
+                send(pending_request{ msg, [this](const std::string& rsp)
+                {
+                    if (compare_msg(rsp, message_types::MSG_RESUME_FAIL))
+                        throw cant_connect("Server refused to resume the session.");
+                    auto vec = split(rsp, '+'); // RSM-OK, token, hash, score, and board and won status if they differ
+                    if (!compare_msg(rsp, message_types::MSG_RESUME_OK) || (vec.size() != 4 && vec.size() != 6))
+                        throw invalid_message("Client recieved invalid resume response.");
+                    m_token = vec[1];
+                    m_resuming = false;
+                    bool changed = vec.size() == 6;
+                    m_resumed(changed ? client_data_tuple(vec[4], vec[5] == "1", std::stoi(vec[3])) : client_data_tuple(), changed);
+                }, std::chrono::steady_clock::time_point(), 0 });
+                return;
+            }
+
+            if (m_resume_sent) // lost again before the server responded
+            {
+                m_resume_sent = false;
+                m_sent.clear();
+                m_throttled.clear();
+                m_reconnect_at = now + backoff(m_reconnects);
+            }
+            if (now < m_reconnect_at)
+                return;
+            if (++m_reconnects > MAX_RECONNECT_ATTEMPTS)
+                throw cant_connect("Cant reconnect to the server.");
+            m_io_service.post(boost::bind(&client::do_reconnect, this));
+            m_reconnect_at = now + backoff(m_reconnects);
+        }
+
+        //! Computes delay before next attempt to reconnect. Its upper bound grows exponentially and the delay is randomly
+        //! between half of it and it, so clients of restarted server do not reconnect all at once.
+        //! \param attempt number of failed attempts.
+        //! \return the delay.
+        std::chrono::milliseconds backoff(int attempt)
+        {
+            long long range = std::min(static_cast<long long>(RECONNECT_MAX_MS), static_cast<long long>(RECONNECT_BASE_MS) << std::min(attempt, 10));
+            return std::chrono::milliseconds(range / 2 + static_cast<long long>(m_jitter() % (range / 2 + 1)));
+        }
+
+        //! Sends request and waits for its response. Requests throttled by the server are repeated after the time it asks for.
+        //! \param msg body of the request.
+        //! \return response from the server.
+        //! \throws connection_timed if the server keeps throttling the request.
+        std::string request(const std::string& msg)
+        {
+            for (int attempt = 0; ; ++attempt)
+            {
+                write(message(msg));
+                std::string rsp = m_listener.get_response();
+                if (!compare_msg(rsp, message_types::MSG_THROTTLE))
+                    return rsp;
+                if (attempt == MAX_THROTTLED_RETRIES)
+                    throw connection_timed("request(): Server keeps throttling requests.", msg.substr(0, msg.find('-') + 1));
+
+                long long retry_after = 0;
+                try { retry_after = std::stoll(rsp.substr(message_types::MSG_THROTTLE.length())); }
+                catch (std::logic_error&) { throw invalid_message("Client recieved invalid throttle response."); }
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min(retry_after, static_cast<long long>(SECONDS_UNTIL_TIMEOUT) * 1000)));
+            }
+        }
+
+        //! Request, whose response is delivered by \ref poll.
+        struct pending_request
+        {
+            std::string msg; //!< Body of the request.
+            std::function<void(const std::string&)> handler; //!< Handler of the response.
+            std::chrono::steady_clock::time_point time; //!< When the request was sent, or when a throttled request is repeated.
+            int attempts; //!< Times the request was throttled.
+        };
+
+        //! Sends request without waiting for its response.
+        //! \param msg body of the request.
+        //! \param handler handler of the response, called by \ref poll.
+        //! \throws cant_connect if the client is not connected.
+        void request_async(const std::string& msg, std::function<void(const std::string&)> handler)
+        {
+            if (!m_connected)
+                throw cant_connect("Cant connect to server. Ensure it is running.");
+            send(pending_request{ msg, std::move(handler), std::chrono::steady_clock::time_point(), 0 });
+        }
+
+        //! Writes asynchronous request, its response is awaited by \ref poll.
+        //! \param req the request.
+        void send(pending_request req)
+        {
+            write(message(req.msg));
+            req.time = std::chrono::steady_clock::now();
+            m_sent.push_back(std::move(req));
+        }
+
         //! Handles connect to the server.
         //! \param error error code of error that may happen during connect.
         void handle_connect(const boost::system::error_code& error)
@@ -155,6 +427,7 @@ class client
             if (!error)
             {
                 m_connected = true;
+                start_heartbeat();
                 boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.data(), message::HEADER_LENGTH),
                     boost::bind(&client::handle_read_header, this, boost::asio::placeholders::error));
             }
@@ -179,7 +452,10 @@ class client
         {
             if (!error)
             {
-                m_listener.write(m_read_msg.body(), m_read_msg.body_length());
+                if (compare_msg(std::string(m_read_msg.body(), m_read_msg.body_length()), message_types::MSG_HEARTBEAT_OK))
+                    m_rtt = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_heartbeat_sent).count();
+                else
+                    m_listener.write(m_read_msg.body(), m_read_msg.body_length());
                 boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.data(), message::HEADER_LENGTH),
                     boost::bind(&client::handle_read_header, this, boost::asio::placeholders::error));
             }
@@ -187,10 +463,33 @@ class client
                 do_close();
         }
 
+        //! Schedules next heartbeat, which keeps the session alive on the server while the player is idle.
+        void start_heartbeat()
+        {
+            m_heartbeat_timer.expires_from_now(boost::posix_time::seconds(SECONDS_BETWEEN_HEARTBEATS));
+            m_heartbeat_timer.async_wait(boost::bind(&client::handle_heartbeat, this, boost::asio::placeholders::error));
+        }
+
+        //! Sends heartbeat with last measured round trip time and schedules next one.
+        //! \param error error code that may happen during waiting.
+        void handle_heartbeat(const boost::system::error_code& error)
+        {
+            if (error || !m_connected)
+                return;
+            if (m_write_msgs.empty()) // pending writes keep the session alive as well
+            {
+                m_heartbeat_sent = std::chrono::steady_clock::now();
+                do_write(message(message_types::MSG_HEARTBEAT + std::to_string(m_rtt)));
+            }
+            start_heartbeat();
+        }
+
         //! Does the writing of the message to the server by appending the message to the queue and calling \ref client::handle_write
         //! \param msg \ref message to write to the server.
         void do_write(message msg)
         {
+            if (m_write_msgs.size() >= MAX_WRITE_QUEUE) // server does not read, following requests fail as not connected
+                return do_close();
             bool write_in_progress = !m_write_msgs.empty();
             m_write_msgs.push_back(msg);
             if (!write_in_progress)
@@ -218,13 +517,41 @@ class client
         }
 
         //! Closes the connection to the server.
-        void do_close() { m_socket.close(); m_connected = false; }
+        void do_close() { m_heartbeat_timer.cancel(); m_socket.close(); m_connected = false; }
+
+        //! Connects again to endpoints of \ref connect. Unsent messages of the lost connection are dropped.
+        void do_reconnect()
+        {
+            if (m_connected)
+                return;
+            boost::system::error_code ignored;
+            m_socket.close(ignored); // cancels previous attempt
+            m_heartbeat_timer.cancel();
+            m_write_msgs.clear();
+            boost::asio::async_connect(m_socket, m_endpoints, boost::bind(&client::handle_connect, this, boost::asio::placeholders::error));
+        }
 
     private:
         boost::asio::io_service& m_io_service; //!< Reference to io_service
         tcp::socket m_socket; //!< Socket as endpoint of communication between client and server
+        boost::asio::deadline_timer m_heartbeat_timer; //!< Timer for sending heartbeats.
+        std::chrono::steady_clock::time_point m_heartbeat_sent; //!< Time, when last heartbeat was sent.
+        std::atomic<long long> m_rtt; //!< Round trip time of last heartbeat in microseconds.
+        long long m_play_rtt; //!< Smoothed round trip time of plays in microseconds. Used by the game loop only.
         message m_read_msg; //!< Message being written to the server
         std::deque<message> m_write_msgs; //!< Message being read by the client.
         listener& m_listener; //!< Reference to \ref listener.
-        bool& m_connected; //!< Reference to connected status.
+        std::deque<pending_request> m_sent; //!< Asynchronous requests waiting for response, in order they were sent. Used by the game loop only.
+        std::deque<pending_request> m_throttled; //!< Asynchronous requests waiting to be repeated. Used by the game loop only.
+        std::atomic<bool>& m_connected; //!< Reference to connected status, written by the network thread.
+        std::string m_user; //!< Name of the logged in user.
+        tcp::resolver::iterator m_endpoints; //!< Endpoints of the server, used for reconnecting.
+        std::string m_token; //!< Token for resuming the session, empty until the server sends it. Used by the game loop only.
+        bool m_resuming; //!< Indicates, that connection was lost and the session is being resumed. Used by the game loop only.
+        bool m_resume_sent; //!< Indicates, that resume request was sent over the new connection. Used by the game loop only.
+        int m_reconnects; //!< Attempts to reconnect since the connection was lost. Used by the game loop only.
+        std::chrono::steady_clock::time_point m_reconnect_at; //!< When next attempt to reconnect is due. Used by the game loop only.
+        std::mt19937 m_jitter; //!< Generator of random delays between attempts to reconnect.
+        std::function<client_data_tuple()> m_state; //!< Gets state of the game for resume request, empty if resuming is not enabled.
+        std::function<void(const client_data_tuple&, bool)> m_resumed; //!< Called, when the session was resumed, empty if resuming is not enabled.
 };
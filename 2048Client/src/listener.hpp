@@ -3,24 +3,42 @@
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <functional>
 #include "../../Common/main.hpp"
+#include "spsc_queue.hpp"
 
 /**!
     \ingroup client
     \brief Class for accepting messages from the server.
+
+    Until \ref start_async is called, responses are awaited by blocking \ref get_response (login at the console).
+    Then they are passed through lock-free queue to the game loop, which takes them by \ref poll without waiting.
 */
 class listener
 {
     public:
+        static const std::size_t QUEUE_CAPACITY = 128; //!< Most responses waiting for the game loop.
+
         //! Default constructor of listener.
         //! \param connected reference to connected status of client.
-        listener(bool& connected) : m_connected(connected) { }
+        listener(std::atomic<bool>& connected) : m_connected(connected), m_async(false) { }
 
-        //! Writes data to the listener.
+        //! Writes data to the listener. Called by the network thread.
         //! \param data ptr to data.
         //! \param lenght size of data.
         void write(char* data, std::size_t lenght)
         {
+            if (m_async.load(std::memory_order_acquire))
+            {
+                std::string response(data, lenght);
+                while (!m_queue.push(response)) // game loop drains the queue every frame
+                    std::this_thread::yield();
+                m_notify();
+                return;
+            }
+
             std::lock_guard<std::mutex> lock(m_mutex);
             m_msgs.emplace_front(data, lenght);
             m_cond.notify_all();
@@ -42,9 +60,25 @@ class listener
             return std::move(response);
         }
 
+        //! Switches delivery of responses to \ref poll. Called by the game loop, when no blocking request is pending.
+        //! \param notify function called by the network thread after a response was queued, e.g. to wake up the game loop.
+        void start_async(std::function<void()> notify)
+        {
+            m_notify = std::move(notify);
+            m_async.store(true, std::memory_order_release);
+        }
+
+        //! Takes the oldest response queued since \ref start_async without waiting.
+        //! \param response the response, if there was any.
+        //! \return true if response was taken, false if there is none.
+        bool poll(std::string& response) { return m_queue.pop(response); }
+
     private:
         std::deque<std::string> m_msgs; //!< Msgs from the server
         std::mutex m_mutex; //!< Mutex for handling access to queue.
         std::condition_variable m_cond; //!< Condition variable to implement blocking mechanics.
-        bool& m_connected; //!< Reference to connected status of the client. \sa client::m_connected
+        std::atomic<bool>& m_connected; //!< Reference to connected status of the client. \sa client::m_connected
+        std::atomic<bool> m_async; //!< Indicates, that responses are delivered through \ref m_queue.
+        std::function<void()> m_notify; //!< Called after a response was queued, set before \ref m_async.
+        spsc_queue<std::string, QUEUE_CAPACITY> m_queue; //!< Responses from the network thread to the game loop.
 };
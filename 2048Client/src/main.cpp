@@ -3,6 +3,10 @@
 #include <iostream>
 #include <string>
 #include <random>
+#include <memory>
+#include <future>
+#include <atomic>
+#include <cstdlib>
 #include <time.h>
 #include <SDL.h>
 #include <SDL_ttf.h>
@@ -18,31 +22,47 @@ int main(int argc, char* argv[])
     try
     {
         boost::asio::io_service io_service;
-        tcp::resolver resolver(io_service);
-        tcp::resolver::query query(argc > 1 ? argv[1] : HOST, argc > 2 ? argv[2] : PORT);
-        tcp::resolver::iterator iterator = resolver.resolve(query);
-
-        bool connected;
+        std::unique_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(io_service));
+        std::atomic<bool> connected(false);
         listener list(connected);
-        client cl(io_service, iterator, list, connected);
+        client cl(io_service, list, connected);
         boost::thread thr(boost::bind(&boost::asio::io_service::run, &io_service));
 
-        while (!cl.login())
+        // Handshake and login run on their own thread, while SDL, fonts and the window are initialized.
+        std::promise<void> logged_in;
+        std::future<void> logged_in_future = logged_in.get_future();
+        std::packaged_task<client_data_tuple()> handshake([&]()
         {
-            std::cout << "failed. Wrong username or password." << std::endl;
-        }
-        std::cout << "OK." << std::endl << "Retrieving data: ... ";
-        client_data_tuple data = cl.get_data();
-        std::cout << "OK." << std::endl << "Starting game now...";
+            tcp::resolver resolver(io_service);
+            tcp::resolver::query query(argc > 1 ? argv[1] : HOST, argc > 2 ? argv[2] : PORT);
+            cl.connect(resolver.resolve(query));
+
+            while (!cl.login())
+            {
+                std::cout << "failed. Wrong username or password." << std::endl;
+            }
+            std::cout << "OK." << std::endl << "Retrieving data: ... ";
+            logged_in.set_value();
+            client_data_tuple res = cl.get_data();
+            std::cout << "OK." << std::endl << "Starting game now...";
+            return res;
+        });
+        std::future<client_data_tuple> data = handshake.get_future();
+        boost::thread handshake_thr(std::move(handshake));
 
         srand((unsigned) time(NULL));
         SDL_Init(SDL_INIT_EVERYTHING);
         TTF_Init();
-        int retvalue = Program::start(data, cl);
+        int retvalue = Program::start(cl, logged_in_future, data);
         TTF_Quit();
         SDL_Quit();
 
+        // Quit before the data came, the handshake may wait for login at the console, so it is not waited for.
+        if (data.valid() && data.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            std::exit(retvalue);
+        handshake_thr.join();
         cl.close();
+        work.reset();
         thr.join();
     }
     catch (connection_timed&)
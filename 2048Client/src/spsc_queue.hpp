@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**!
+    \ingroup client
+    \brief Bounded lock-free queue of a single producer thread and a single consumer thread.
+
+    Items are stored in a preallocated ring, \a Capacity has to be a power of two. Producer owns the tail
+    and consumer owns the head, each index is written by one thread only, so neither push nor pop locks.
+    \tparam T Type of items.
+    \tparam Capacity Most items in the queue.
+*/
+template<typename T, std::size_t Capacity>
+class spsc_queue
+{
+    static_assert(Capacity && !(Capacity & (Capacity - 1)), "Capacity of spsc_queue has to be a power of two.");
+
+    public:
+        spsc_queue() : m_head(0), m_tail(0) { }
+
+        //! Appends an item. Called only by the producer.
+        //! \param item the item, it is moved from only when it was appended.
+        //! \return false if the queue is full, true otherwise.
+        bool push(T& item)
+        {
+            std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+                return false;
+            m_items[tail & (Capacity - 1)] = std::move(item);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        //! Removes the oldest item. Called only by the consumer.
+        //! \param item the item, if there was any.
+        //! \return false if the queue is empty, true otherwise.
+        bool pop(T& item)
+        {
+            std::size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+                return false;
+            item = std::move(m_items[head & (Capacity - 1)]);
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        T m_items[Capacity]; //!< Ring of items.
+        std::atomic<std::size_t> m_head; //!< Index of the oldest item, written by the consumer.
+        std::atomic<std::size_t> m_tail; //!< Index past the newest item, written by the producer.
+
+        spsc_queue(const spsc_queue&) = delete;
+        spsc_queue& operator=(const spsc_queue&) = delete;
+};
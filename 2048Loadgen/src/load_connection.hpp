@@ -0,0 +1,350 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <random>
+#include <atomic>
+#include <chrono>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include "../../Common/main.hpp"
+#include "../../Common/message.hpp"
+#include "../../Common/hasher.hpp"
+#include "../../Common/play_event.hpp"
+#include "../../Common/histogram.hpp"
+using boost::asio::ip::tcp;
+
+/**!
+    \ingroup loadgen
+    \brief Results shared by all connections of the load generator.
+*/
+struct load_stats
+{
+    //! Request types, which latency is measured.
+    enum Requests
+    {
+        LOGIN = 0,
+        DATA,
+        PLAY,
+        RESTART,
+
+        MAX_REQUESTS,
+    };
+
+    load_stats() : moves(0), games(0), connected(0), failed(0), errors(0), throttled(0) { }
+
+    histogram latency[MAX_REQUESTS]; //!< Latency in microseconds of each request type, throttle responses and plays, which did not move the board, excluded.
+    std::atomic<unsigned long long> moves; //!< Play requests answered, which moved the board.
+    std::atomic<unsigned long long> games; //!< Games finished (lost, or won and stuck) and restarted.
+    std::atomic<unsigned long long> connected; //!< Connections, which logged in.
+    std::atomic<unsigned long long> failed; //!< Connections, which failed to connect or log in.
+    std::atomic<unsigned long long> errors; //!< Connections closed because of an error.
+    std::atomic<unsigned long long> throttled; //!< Requests throttled by the server and repeated.
+};
+
+/**!
+    \ingroup loadgen
+    \brief Settings of simulated players.
+*/
+struct load_settings
+{
+    //! How players choose direction of their move.
+    enum Strategies
+    {
+        RANDOM, //!< Uniformly random direction.
+        CYCLE, //!< Left, down, right, up, ...
+        CORNER, //!< Prefers down and left, tries others only when the board does not move.
+    };
+
+    //! Distribution of time between receiving response and sending next move.
+    enum ThinkTimes
+    {
+        CONSTANT, //!< Always exactly mean.
+        UNIFORM, //!< Uniform in range <0, 2 * mean>.
+        EXPONENTIAL, //!< Exponential with given mean.
+    };
+
+    load_settings() : strategy(RANDOM), think(EXPONENTIAL), think_ms(100), moves(0) { }
+
+    Strategies strategy; //!< Move choosing strategy.
+    ThinkTimes think; //!< Think time distribution.
+    double think_ms; //!< Mean think time in milliseconds.
+    unsigned long long moves; //!< Moves per connection, 0 for unlimited.
+};
+
+/**!
+    \ingroup loadgen
+    \brief Single simulated player. Logs in, fetches its data and plays moves until stopped.
+
+    Lost game is restarted. Won game is not lost anymore, so it is restarted, when no direction moves its board.
+    Shares \ref message framing with the client, but not its \ref client class, whose login reads the console and blocks.
+*/
+class load_connection : public boost::enable_shared_from_this<load_connection>
+{
+    public:
+        //! Constructs the connection.
+        //! \param io_service reference to boost io_service.
+        //! \param user username to log in with.
+        //! \param pass password (not hashed) to log in with.
+        //! \param settings behaviour of the player.
+        //! \param stats shared results.
+        //! \param seed seed of random generator used for moves and think times.
+        load_connection(boost::asio::io_service& io_service, const std::string& user, const std::string& pass,
+            const load_settings& settings, load_stats& stats, unsigned seed) :
+            m_socket(io_service), m_timer(io_service), m_user(user), m_pass(pass), m_settings(settings), m_stats(stats),
+            m_random(seed), m_pending(load_stats::LOGIN), m_next_direction(0), m_direction(0), m_stuck(0), m_last_played(true), m_moves(0), m_stopped(false) { }
+
+        //! Connects to the server and starts playing.
+        //! \param endpoint_iterator tcp resolver iterator.
+        void start(tcp::resolver::iterator endpoint_iterator)
+        {
+            boost::asio::async_connect(m_socket, endpoint_iterator,
+                boost::bind(&load_connection::handle_connect, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Stops playing and closes the connection.
+        void stop()
+        {
+            m_stopped = true;
+            m_timer.cancel();
+            boost::system::error_code ignored;
+            m_socket.close(ignored);
+        }
+
+    private:
+        //! Handles connect to the server by sending login request.
+        //! \param error error code of error that may happen during connect.
+        void handle_connect(const boost::system::error_code& error)
+        {
+            if (error)
+            {
+                ++m_stats.failed;
+                return;
+            }
+            boost::asio::ip::tcp::no_delay option(true);
+            m_socket.set_option(option);
+            read_header();
+            request(load_stats::LOGIN, message_types::MSG_LOGIN + m_user + "+" + hasher::hash(m_pass));
+        }
+
+        //! Starts reading of message header.
+        void read_header()
+        {
+            boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.data(), message::HEADER_LENGTH),
+                boost::bind(&load_connection::handle_read_header, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Handles reading message header.
+        //! \param error error code of error that may happen during read.
+        void handle_read_header(const boost::system::error_code& error)
+        {
+            if (!error && m_read_msg.decode_header())
+            {
+                boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.body(), m_read_msg.body_length()),
+                    boost::bind(&load_connection::handle_read_body, shared_from_this(), boost::asio::placeholders::error));
+            }
+            else
+                fail();
+        }
+
+        //! Handles reading message body.
+        //! \param error error code of error that may happen during read.
+        void handle_read_body(const boost::system::error_code& error)
+        {
+            if (error)
+                return fail();
+
+            std::string rsp(m_read_msg.body(), m_read_msg.body_length());
+            long long latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_sent).count();
+            try
+            {
+                handle_response(rsp, latency);
+            }
+            catch (std::exception&)
+            {
+                return fail();
+            }
+            read_header();
+        }
+
+        //! Reacts on response to the last request and records its latency.
+        //! Throttled requests are counted separately, latency is of the repeated one.
+        //! \param rsp response from the server.
+        //! \param latency microseconds since the request was sent.
+        void handle_response(const std::string& rsp, long long latency)
+        {
+            if (m_stopped)
+                return;
+            if (!compare_msg(rsp, message_types::MSG_THROTTLE) && m_pending != load_stats::PLAY) // plays are recorded, only if they moved the board
+                m_stats.latency[m_pending].record(latency);
+            if (compare_msg(rsp, message_types::MSG_THROTTLE))
+            {
+                ++m_stats.throttled;
+                m_timer.expires_from_now(boost::posix_time::milliseconds(std::stoll(rsp.substr(message_types::MSG_THROTTLE.length()))));
+                m_timer.async_wait(boost::bind(&load_connection::handle_retry, shared_from_this(), boost::asio::placeholders::error));
+            }
+            else if (m_pending == load_stats::LOGIN)
+            {
+                if (rsp != message_types::MSG_LOGIN_OK)
+                {
+                    ++m_stats.failed;
+                    return stop();
+                }
+                ++m_stats.connected;
+                request(load_stats::DATA, message_types::MSG_DATA_REQ);
+            }
+            else if (m_pending == load_stats::DATA || m_pending == load_stats::RESTART)
+                think();
+            else if (m_pending == load_stats::PLAY)
+            {
+                if (!compare_msg(rsp, message_types::MSG_PLAY_OK))
+                    throw invalid_message("Invalid play response.");
+                play_event pl_event(rsp.substr(rsp.find("+") + 1));
+                m_last_played = pl_event.played();
+                if (m_last_played)
+                {
+                    m_stats.latency[load_stats::PLAY].record(latency);
+                    ++m_stats.moves;
+                    ++m_moves;
+                    m_stuck = 0;
+                }
+                else
+                    m_stuck |= 1 << m_direction;
+                if (pl_event.lost() || (pl_event.won() && m_stuck == 0xF)) // won game is never lost, it is restarted when no direction moves it
+                {
+                    m_stuck = 0;
+                    ++m_stats.games;
+                    request(load_stats::RESTART, message_types::MSG_RESTART);
+                }
+                else
+                    think();
+            }
+        }
+
+        //! Waits for think time and then plays next move.
+        void think()
+        {
+            if (m_settings.moves && m_moves >= m_settings.moves)
+                return stop();
+
+            m_timer.expires_from_now(boost::posix_time::microseconds(think_time()));
+            m_timer.async_wait(boost::bind(&load_connection::handle_think, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Sends next move after think time.
+        //! \param error error code that may happen during waiting.
+        void handle_think(const boost::system::error_code& error)
+        {
+            if (error || m_stopped)
+                return;
+
+            static const std::string DIRS[] = { directions::LEFT, directions::DOWN, directions::RIGHT, directions::UP };
+            m_direction = next_direction();
+            request(load_stats::PLAY, message_types::MSG_PLAY + DIRS[m_direction]);
+        }
+
+        //! Repeats throttled request after the time requested by the server.
+        //! \param error error code that may happen during waiting.
+        void handle_retry(const boost::system::error_code& error)
+        {
+            if (error || m_stopped)
+                return;
+            request(m_pending, m_request);
+        }
+
+        //! Chooses next direction by configured strategy.
+        //! \return index into left, down, right, up.
+        int next_direction()
+        {
+            switch (m_settings.strategy)
+            {
+                case load_settings::RANDOM:
+                    return std::uniform_int_distribution<int>(0, 3)(m_random);
+                case load_settings::CYCLE:
+                    return m_next_direction = (m_next_direction + 1) % 4;
+                case load_settings::CORNER:
+                    if (m_last_played)
+                        m_next_direction = m_next_direction == 0 ? 1 : 0; // alternate left and down
+                    else
+                        m_next_direction = (m_next_direction + 1) % 4; // stuck, try next
+                    return m_next_direction;
+            }
+            return 0;
+        }
+
+        //! Draws think time from configured distribution.
+        //! \return think time in microseconds.
+        long long think_time()
+        {
+            double mean = m_settings.think_ms * 1000;
+            if (mean <= 0)
+                return 0;
+            switch (m_settings.think)
+            {
+                case load_settings::CONSTANT: return static_cast<long long>(mean);
+                case load_settings::UNIFORM: return static_cast<long long>(std::uniform_real_distribution<double>(0, 2 * mean)(m_random));
+                case load_settings::EXPONENTIAL: return static_cast<long long>(std::exponential_distribution<double>(1 / mean)(m_random));
+            }
+            return 0;
+        }
+
+        //! Sends request to the server and starts measuring its latency.
+        //! \param type type of the request.
+        //! \param msg body of the request.
+        void request(load_stats::Requests type, const std::string& msg)
+        {
+            m_pending = type;
+            m_request = msg;
+            m_sent = std::chrono::steady_clock::now();
+            bool write_in_progress = !m_write_msgs.empty();
+            m_write_msgs.push_back(message(msg));
+            if (!write_in_progress)
+                write();
+        }
+
+        //! Writes first queued message.
+        void write()
+        {
+            boost::asio::async_write(m_socket, boost::asio::buffer(m_write_msgs.front().data(), m_write_msgs.front().length()),
+                boost::bind(&load_connection::handle_write, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Handles writing of the message to the server.
+        //! \param error error code of error that may happen during the writing.
+        void handle_write(const boost::system::error_code& error)
+        {
+            if (error)
+                return fail();
+            m_write_msgs.pop_front();
+            if (!m_write_msgs.empty())
+                write();
+        }
+
+        //! Closes connection after an error.
+        void fail()
+        {
+            if (m_stopped)
+                return;
+            ++m_stats.errors;
+            stop();
+        }
+
+        tcp::socket m_socket; //!< Socket connected to the server.
+        boost::asio::deadline_timer m_timer; //!< Timer used for think time.
+        std::string m_user; //!< Username.
+        std::string m_pass; //!< Password.
+        const load_settings& m_settings; //!< Behaviour of the player.
+        load_stats& m_stats; //!< Shared results.
+        std::mt19937 m_random; //!< Random generator for moves and think times.
+        message m_read_msg; //!< Message being read.
+        std::deque<message> m_write_msgs; //!< Messages to write.
+        load_stats::Requests m_pending; //!< Type of request waiting for response.
+        std::string m_request; //!< Body of request waiting for response, repeated if it is throttled.
+        std::chrono::steady_clock::time_point m_sent; //!< Time, when pending request was sent.
+        int m_next_direction; //!< Last direction played by \ref load_settings::CYCLE and \ref load_settings::CORNER.
+        int m_direction; //!< Direction of the last play, index into left, down, right, up.
+        int m_stuck; //!< Bit mask of directions, which did not move the board since its last move.
+        bool m_last_played; //!< Indicates, that last move changed the board.
+        unsigned long long m_moves; //!< Moves played by this connection.
+        bool m_stopped; //!< Indicates, that connection was stopped.
+};
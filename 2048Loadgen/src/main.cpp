@@ -0,0 +1,225 @@
+/** \defgroup loadgen Headless load generator for capacity testing of the server. */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+#include "../../Common/main.hpp"
+#include "load_connection.hpp"
+using boost::asio::ip::tcp;
+
+namespace
+{
+    //! Prints usage of the program.
+    void usage(const char* name)
+    {
+        std::cerr << "Usage: " << name << " [options] [host [port]]" << std::endl
+                  << "  -c N       number of concurrent connections (100)" << std::endl
+                  << "  -u PREFIX  users are PREFIX0 .. PREFIX<N-1> (bot)" << std::endl
+                  << "  -p PASS    password of generated users (bot)" << std::endl
+                  << "  -U FILE    file with 'user password' lines, used instead of -u and -p" << std::endl
+                  << "  -d SEC     duration of the test (60)" << std::endl
+                  << "  -r N       connections opened per second, 0 opens all at once (0)" << std::endl
+                  << "  -s NAME    move strategy: random, cycle, corner (random)" << std::endl
+                  << "  -t MS      mean think time between moves (100)" << std::endl
+                  << "  -T NAME    think time distribution: const, uniform, exp (exp)" << std::endl
+                  << "  -m N       moves per connection, 0 for unlimited (0)" << std::endl
+                  << "  -j N       worker threads (number of cores)" << std::endl;
+    }
+
+    //! Joins worker threads, when the run ends by an exception. Their io_services are stopped, so they return at once.
+    class worker_guard
+    {
+        public:
+            //! Constructs the guard.
+            //! \param services io_services run by the workers.
+            //! \param workers threads running the io_services.
+            worker_guard(std::vector<std::unique_ptr<boost::asio::io_service>>& services, std::vector<std::thread>& workers) :
+                m_services(services), m_workers(workers) { }
+
+            //! Destructor, which stops the io_services and joins workers, which were not joined yet.
+            ~worker_guard()
+            {
+                for (auto& service : m_services)
+                    service->stop();
+                for (auto& worker : m_workers)
+                    if (worker.joinable())
+                        worker.join();
+            }
+
+        private:
+            std::vector<std::unique_ptr<boost::asio::io_service>>& m_services; //!< io_services run by the workers.
+            std::vector<std::thread>& m_workers; //!< Worker threads.
+    };
+
+    //! Prints one line of latency report.
+    void report_latency(const char* name, const histogram& hist)
+    {
+        std::cout << std::left << std::setw(8) << name << std::right
+                  << " count=" << std::setw(9) << hist.count()
+                  << " p50=" << std::setw(8) << hist.percentile(50) << "us"
+                  << " p99=" << std::setw(8) << hist.percentile(99) << "us"
+                  << " p999=" << std::setw(8) << hist.percentile(99.9) << "us"
+                  << " max=" << std::setw(8) << hist.max() << "us" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t connections = 100, threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string prefix = "bot", pass = "bot", users_file, host = "localhost", port = PORT;
+    long long duration = 60, ramp = 0;
+    load_settings settings;
+
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc)
+        {
+            std::string val = argv[++i];
+            try
+            {
+                switch (arg[1])
+                {
+                    case 'c': connections = std::stoul(val); break;
+                    case 'u': prefix = val; break;
+                    case 'p': pass = val; break;
+                    case 'U': users_file = val; break;
+                    case 'd': duration = std::stoll(val); break;
+                    case 'r': ramp = std::stoll(val); break;
+                    case 't': settings.think_ms = std::stod(val); break;
+                    case 'm': settings.moves = std::stoull(val); break;
+                    case 'j': threads = std::max<std::size_t>(1, std::stoul(val)); break;
+                    case 's':
+                        if (val == "random") settings.strategy = load_settings::RANDOM;
+                        else if (val == "cycle") settings.strategy = load_settings::CYCLE;
+                        else if (val == "corner") settings.strategy = load_settings::CORNER;
+                        else throw std::invalid_argument(val);
+                        break;
+                    case 'T':
+                        if (val == "const") settings.think = load_settings::CONSTANT;
+                        else if (val == "uniform") settings.think = load_settings::UNIFORM;
+                        else if (val == "exp") settings.think = load_settings::EXPONENTIAL;
+                        else throw std::invalid_argument(val);
+                        break;
+                    default: usage(argv[0]); return EXIT_FAILURE;
+                }
+            }
+            catch (std::exception&)
+            {
+                std::cerr << "Invalid value '" << val << "' of " << arg << "." << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg[0] == '-')
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else
+            positional.push_back(arg);
+    }
+    if (positional.size() > 0)
+        host = positional[0];
+    if (positional.size() > 1)
+        port = positional[1];
+
+    std::vector<std::pair<std::string, std::string>> users;
+    if (!users_file.empty())
+    {
+        std::ifstream file(users_file);
+        std::string user, password;
+        while (file >> user >> password)
+            users.emplace_back(user, password);
+        if (users.empty())
+        {
+            std::cerr << "No users in '" << users_file << "'." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    else
+        for (std::size_t i = 0; i < connections; ++i)
+            users.emplace_back(prefix + std::to_string(i), pass);
+
+    try
+    {
+        // One io_service per thread, so handlers of single connection never run concurrently.
+        std::vector<std::unique_ptr<boost::asio::io_service>> services;
+        std::vector<std::unique_ptr<boost::asio::io_service::work>> works;
+        for (std::size_t i = 0; i < threads; ++i)
+        {
+            services.emplace_back(new boost::asio::io_service());
+            works.emplace_back(new boost::asio::io_service::work(*services.back()));
+        }
+
+        tcp::resolver resolver(*services[0]);
+        tcp::resolver::iterator iterator = resolver.resolve(tcp::resolver::query(host, port));
+
+        load_stats stats;
+        std::vector<boost::shared_ptr<load_connection>> conns;
+        std::vector<std::thread> workers;
+        worker_guard guard(services, workers);
+        for (auto& service : services)
+            workers.emplace_back([&service]() { service->run(); });
+
+        auto start = std::chrono::steady_clock::now();
+        auto end = start + std::chrono::seconds(duration);
+        unsigned long long last_moves = 0;
+        auto last_report = start;
+        std::size_t opened = 0;
+
+        std::cout << "Running " << connections << " connections against " << host << ":" << port << " for " << duration << "s." << std::endl;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::size_t target = ramp > 0 ? std::min<std::size_t>(connections, static_cast<std::size_t>(elapsed * ramp) + 1) : connections;
+            for (; opened < target; ++opened)
+            {
+                const auto& user = users[opened % users.size()];
+                boost::asio::io_service& service = *services[opened % services.size()];
+                conns.emplace_back(new load_connection(service, user.first, user.second, settings, stats, static_cast<unsigned>(opened)));
+                service.post(boost::bind(&load_connection::start, conns.back(), iterator));
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_report >= std::chrono::seconds(1))
+            {
+                unsigned long long moves = stats.moves;
+                std::cout << std::fixed << std::setprecision(1) << std::chrono::duration<double>(now - start).count() << "s"
+                          << " opened=" << opened << " logged=" << stats.connected << " failed=" << stats.failed << " errors=" << stats.errors << " throttled=" << stats.throttled
+                          << " moves/s=" << (moves - last_moves) / std::chrono::duration<double>(now - last_report).count() << std::endl;
+                last_moves = moves;
+                last_report = now;
+            }
+        }
+
+        for (std::size_t i = 0; i < conns.size(); ++i)
+            services[i % services.size()]->post(boost::bind(&load_connection::stop, conns[i]));
+        works.clear();
+        for (auto& worker : workers)
+            worker.join();
+
+        double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::endl << "Connections: " << opened << " opened, " << stats.connected << " logged in, "
+                  << stats.failed << " failed, " << stats.errors << " errors, " << stats.throttled << " requests throttled." << std::endl
+                  << "Moves: " << stats.moves << " (" << std::setprecision(1) << stats.moves / total << " moves/s), games finished: " << stats.games << "." << std::endl;
+        report_latency("LOGIN", stats.latency[load_stats::LOGIN]);
+        report_latency("DATA", stats.latency[load_stats::DATA]);
+        report_latency("PLAY", stats.latency[load_stats::PLAY]);
+        report_latency("RESTART", stats.latency[load_stats::RESTART]);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
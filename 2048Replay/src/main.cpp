@@ -0,0 +1,239 @@
+/** \defgroup replay Replay of captured traffic against the server. */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+#include "../../Common/main.hpp"
+#include "../../Common/hasher.hpp"
+#include "../../Common/capture_file.hpp"
+#include "replay_connection.hpp"
+using boost::asio::ip::tcp;
+
+namespace
+{
+    //! Prints usage of the program.
+    void usage(const char* name)
+    {
+        std::cerr << "Usage: " << name << " [options] capture_file [host [port]]" << std::endl
+                  << "  -x SPEED   replay speed, 1 is captured speed, 'max' sends as fast as responses arrive (1)" << std::endl
+                  << "  -v         print all mismatched responses, not only first " << static_cast<unsigned long long>(replay_connection::PRINTED_MISMATCHES) << std::endl
+                  << "  -U FILE    file with 'user password' lines, passwords are not captured" << std::endl;
+    }
+
+    //! Removes sessions, which were resumed. Their resume requests carry tokens, which are not captured
+    //! and which the replayed server never issued, so they can not be replayed.
+    //! \param sessions captured sessions.
+    //! \return number of removed sessions.
+    std::size_t remove_resumed(std::vector<replay_session>& sessions)
+    {
+        auto resumed = [](const replay_session& session)
+        {
+            return std::any_of(session.steps.begin(), session.steps.end(), [](const replay_session::step& step) { return compare_msg(step.body, message_types::MSG_RESUME); });
+        };
+        std::size_t size = sessions.size();
+        sessions.erase(std::remove_if(sessions.begin(), sessions.end(), resumed), sessions.end());
+        return size - sessions.size();
+    }
+
+    //! Completes captured logins, whose passwords were removed (see \ref capture_file::redact), by passwords from file.
+    //! \param sessions captured sessions.
+    //! \param users_file file with 'user password' lines, empty if not given.
+    //! \return number of logins, whose user is not in the file.
+    //! \throws std::runtime_error if the file can not be opened.
+    std::size_t complete_logins(std::vector<replay_session>& sessions, const std::string& users_file)
+    {
+        std::map<std::string, std::string> passwords;
+        if (!users_file.empty())
+        {
+            std::ifstream file(users_file);
+            if (file.fail())
+                throw std::runtime_error("Failed to open '" + users_file + "'.");
+            std::string user, password;
+            while (file >> user >> password)
+                passwords[user] = password;
+        }
+
+        std::size_t unknown = 0;
+        for (auto& session : sessions)
+            for (auto& step : session.steps)
+            {
+                if (!compare_msg(step.body, message_types::MSG_LOGIN) || step.body.back() != '+')
+                    continue;
+                auto it = passwords.find(step.body.substr(message_types::MSG_LOGIN.length(), step.body.size() - message_types::MSG_LOGIN.length() - 1));
+                if (it != passwords.end())
+                    step.body += hasher::hash(it->second);
+                else
+                    ++unknown;
+            }
+        return unknown;
+    }
+
+    //! Loads sessions from capture file.
+    //! \param file path to capture file.
+    //! \return captured sessions ordered by their ids.
+    //! \throws std::runtime_error if the file can not be opened.
+    std::vector<replay_session> load(const std::string& file)
+    {
+        capture_reader reader(file);
+        std::map<std::uint64_t, replay_session> sessions;
+        capture_file::record rec;
+        while (true)
+        {
+            try
+            {
+                if (!reader.next(rec))
+                    break;
+            }
+            catch (std::runtime_error& e)
+            {
+                // capture of killed server usually ends with partially flushed record
+                std::cerr << e.what() << " Replaying complete records only." << std::endl;
+                break;
+            }
+
+            replay_session& session = sessions[rec.session];
+            switch (rec.type)
+            {
+                case capture_file::OPEN:
+                    session.id = rec.session;
+                    session.open_time = rec.time;
+                    break;
+                case capture_file::MSG_IN:
+                    session.steps.push_back({ rec.time, std::move(rec.body), session.expected.size() });
+                    break;
+                case capture_file::MSG_OUT:
+                    if (replay_session::spectator_message(rec.body))
+                        ++session.spectator_messages;
+                    else
+                        session.expected.push_back(std::move(rec.body));
+                    break;
+                case capture_file::SEED:
+                    if (!session.has_seed && session.steps.empty()) // later seeds are set by replayed messages
+                    {
+                        session.seed = static_cast<std::uint32_t>(rec.seed);
+                        session.has_seed = true;
+                    }
+                    break;
+                case capture_file::CLOSE:
+                    break;
+            }
+        }
+
+        std::vector<replay_session> res;
+        for (auto& item : sessions)
+        {
+            item.second.id = item.first;
+            res.push_back(std::move(item.second));
+        }
+        return res;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string host = "localhost", port = PORT, users_file;
+    double speed = 1;
+    replay_stats stats;
+
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-x" && i + 1 < argc)
+        {
+            std::string val = argv[++i];
+            try
+            {
+                speed = val == "max" ? 0 : std::stod(val);
+                if (speed < 0)
+                    throw std::invalid_argument(val);
+            }
+            catch (std::exception&)
+            {
+                std::cerr << "Invalid value '" << val << "' of -x." << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "-v")
+            stats.verbose = true;
+        else if (arg == "-U" && i + 1 < argc)
+            users_file = argv[++i];
+        else if (arg[0] == '-')
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else
+            positional.push_back(arg);
+    }
+    if (positional.empty())
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (positional.size() > 1)
+        host = positional[1];
+    if (positional.size() > 2)
+        port = positional[2];
+
+    try
+    {
+        std::vector<replay_session> sessions = load(positional[0]);
+        if (std::size_t resumed = remove_resumed(sessions))
+            std::cout << resumed << " resumed sessions are skipped, captured resumes can not be replayed." << std::endl;
+        if (std::size_t unknown = complete_logins(sessions, users_file))
+            std::cout << unknown << " logins have no password in " << (users_file.empty() ? "users file (-U)" : "'" + users_file + "'") << ", they are replayed without it." << std::endl;
+        std::size_t captured_messages = 0, spectator_messages = 0;
+        for (const auto& session : sessions)
+        {
+            captured_messages += session.steps.size();
+            spectator_messages += session.spectator_messages;
+        }
+        std::cout << "Replaying " << sessions.size() << " sessions with " << captured_messages << " messages against " << host << ":" << port
+                  << " at ";
+        if (speed > 0)
+            std::cout << speed << "x";
+        else
+            std::cout << "maximal";
+        std::cout << " speed." << std::endl;
+
+        boost::asio::io_service io_service;
+        tcp::resolver resolver(io_service);
+        tcp::resolver::iterator iterator = resolver.resolve(tcp::resolver::query(host, port));
+
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& session : sessions)
+        {
+            boost::shared_ptr<replay_connection> conn(new replay_connection(io_service, session, stats, start, speed));
+            conn->start(iterator);
+        }
+        io_service.run();
+
+        double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (stats.seed_refused)
+            std::cout << "Server refused seeding (set 'allow_seed = 1'), spawned blocks are not reproducible." << std::endl;
+        std::cout << std::endl << "Sessions: " << stats.sessions << " replayed, " << stats.errors << " failed to connect." << std::endl
+                  << "Messages: " << stats.sent << " sent, " << stats.received << " received in " << std::fixed << std::setprecision(2) << total << "s ("
+                  << std::setprecision(1) << stats.sent / total << " msgs/s)." << std::endl
+                  << "Responses: " << stats.mismatches << " mismatched, " << stats.missing << " missing, " << stats.unexpected << " unexpected." << std::endl
+                  << "Spectator messages (not compared): " << spectator_messages << " captured, " << stats.spectator << " received." << std::endl
+                  << "Latency: p50=" << stats.latency.percentile(50) << "us p99=" << stats.latency.percentile(99)
+                  << "us p999=" << stats.latency.percentile(99.9) << "us max=" << stats.latency.max() << "us" << std::endl;
+
+        if (stats.errors || stats.mismatches || stats.missing || stats.unexpected)
+            return EXIT_FAILURE;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdint>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include "../../Common/main.hpp"
+#include "../../Common/message.hpp"
+#include "../../Common/histogram.hpp"
+#include "../../Common/capture_file.hpp"
+using boost::asio::ip::tcp;
+
+/**!
+    \ingroup replay
+    \brief Captured session, which is replayed by single \ref replay_connection.
+*/
+struct replay_session
+{
+    //! Message sent by the client.
+    struct step
+    {
+        std::uint64_t time; //!< Microseconds since beginning of capture.
+        std::string body; //!< Body of the message.
+        std::size_t responses_before; //!< Responses captured before the message was received.
+    };
+
+    replay_session() : id(0), open_time(0), seed(0), has_seed(false), spectator_messages(0) { }
+
+    //! Checks, whether message was sent to spectator because of moves of watched player, not as a response.
+    //! Their order among responses depends on timing of the watched session, so they are not compared.
+    //! \param body body of the message.
+    //! \return true for \ref message_types::MSG_SPECTATE_EVENT, \ref message_types::MSG_SPECTATE_SNAPSHOT and \ref message_types::MSG_SPECTATE_END.
+    static bool spectator_message(const std::string& body)
+    {
+        return compare_msg(body, message_types::MSG_SPECTATE_EVENT) || compare_msg(body, message_types::MSG_SPECTATE_SNAPSHOT) || body == message_types::MSG_SPECTATE_END;
+    }
+
+    std::uint64_t id; //!< Id of the session in capture.
+    std::uint64_t open_time; //!< Microseconds since beginning of capture, when the session was opened.
+    std::uint32_t seed; //!< Seed of random generator at the start of the session.
+    bool has_seed; //!< Indicates, whether \ref seed was captured.
+    std::vector<step> steps; //!< Messages sent by the client.
+    std::vector<std::string> expected; //!< Captured responses of the server, without spectator messages.
+    std::size_t spectator_messages; //!< Captured spectator messages. \sa spectator_message
+};
+
+/**!
+    \ingroup replay
+    \brief Results shared by all replayed sessions.
+*/
+struct replay_stats
+{
+    replay_stats() : sessions(0), sent(0), received(0), mismatches(0), missing(0), unexpected(0), spectator(0), errors(0), seed_refused(false), verbose(false) { }
+
+    histogram latency; //!< Latency of responses in microseconds.
+    unsigned long long sessions; //!< Sessions replayed.
+    unsigned long long sent; //!< Messages sent.
+    unsigned long long received; //!< Responses received, without spectator messages.
+    unsigned long long mismatches; //!< Responses different from captured ones.
+    unsigned long long missing; //!< Captured responses, which were not received.
+    unsigned long long unexpected; //!< Received responses, which were not captured.
+    unsigned long long spectator; //!< Spectator messages received, they are not compared. \sa replay_session::spectator_message
+    unsigned long long errors; //!< Sessions, which failed to connect.
+    bool seed_refused; //!< Indicates, that server did not allow seeding.
+    bool verbose; //!< Print all mismatches, not only first few.
+};
+
+/**!
+    \ingroup replay
+    \brief Replays single captured session against the server and compares responses.
+
+    Messages are sent at their captured times divided by speed. With speed 0 each message is sent
+    as soon as responses captured before it were received.
+*/
+class replay_connection : public boost::enable_shared_from_this<replay_connection>
+{
+    public:
+        static const unsigned long long PRINTED_MISMATCHES = 10; //!< Mismatches printed unless \ref replay_stats::verbose is set.
+
+        //! Constructs the connection.
+        //! \param io_service reference to boost io_service.
+        //! \param session captured session to replay.
+        //! \param stats shared results.
+        //! \param start beginning of the replay.
+        //! \param speed replay speed, 1 for captured speed, 0 for maximal speed.
+        replay_connection(boost::asio::io_service& io_service, const replay_session& session, replay_stats& stats,
+            std::chrono::steady_clock::time_point start, double speed) :
+            m_socket(io_service), m_timer(io_service), m_session(session), m_stats(stats), m_start(start), m_speed(speed),
+            m_next_step(0), m_received(0), m_skip(0), m_closed(false) { }
+
+        //! Waits for captured open time of the session and connects to the server.
+        //! \param endpoint_iterator tcp resolver iterator.
+        void start(tcp::resolver::iterator endpoint_iterator)
+        {
+            m_timer.expires_at(at(m_session.open_time));
+            m_timer.async_wait(boost::bind(&replay_connection::handle_open, shared_from_this(), endpoint_iterator, boost::asio::placeholders::error));
+        }
+
+    private:
+        //! Converts captured time into time of replay.
+        //! \param time microseconds since beginning of capture.
+        //! \return boost time, when the event is replayed.
+        boost::posix_time::ptime at(std::uint64_t time) const
+        {
+            long long delay = m_speed > 0 ? static_cast<long long>(time / m_speed) : 0;
+            delay -= std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+            return boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds(std::max(0LL, delay));
+        }
+
+        //! Connects to the server.
+        //! \param endpoint_iterator tcp resolver iterator.
+        //! \param error error code that may happen during waiting.
+        void handle_open(tcp::resolver::iterator endpoint_iterator, const boost::system::error_code& error)
+        {
+            if (error)
+                return;
+            boost::asio::async_connect(m_socket, endpoint_iterator,
+                boost::bind(&replay_connection::handle_connect, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Seeds the session and schedules first message.
+        //! \param error error code of error that may happen during connect.
+        void handle_connect(const boost::system::error_code& error)
+        {
+            if (error)
+            {
+                ++m_stats.errors;
+                return;
+            }
+            ++m_stats.sessions;
+            boost::asio::ip::tcp::no_delay option(true);
+            m_socket.set_option(option);
+            read_header();
+            if (m_session.has_seed)
+            {
+                m_skip = 1;
+                send(message_types::MSG_SEED + std::to_string(m_session.seed));
+            }
+            schedule();
+        }
+
+        //! Schedules sending of next captured message, or closes the connection after all responses arrive.
+        void schedule()
+        {
+            if (m_next_step == m_session.steps.size())
+            {
+                if (m_received >= m_session.expected.size() && !m_skip)
+                    close();
+                return;
+            }
+            const replay_session::step& step = m_session.steps[m_next_step];
+            if (m_speed > 0)
+            {
+                m_timer.expires_at(at(step.time));
+                m_timer.async_wait(boost::bind(&replay_connection::handle_step, shared_from_this(), boost::asio::placeholders::error));
+            }
+            else if (m_received >= step.responses_before && !m_skip)
+                handle_step(boost::system::error_code());
+        }
+
+        //! Sends next captured message.
+        //! \param error error code that may happen during waiting.
+        void handle_step(const boost::system::error_code& error)
+        {
+            if (error || m_closed)
+                return;
+            send(m_session.steps[m_next_step++].body);
+            schedule();
+        }
+
+        //! Starts reading of message header.
+        void read_header()
+        {
+            boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.data(), message::HEADER_LENGTH),
+                boost::bind(&replay_connection::handle_read_header, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Handles reading message header.
+        //! \param error error code of error that may happen during read.
+        void handle_read_header(const boost::system::error_code& error)
+        {
+            if (!error && m_read_msg.decode_header())
+            {
+                boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.body(), m_read_msg.body_length()),
+                    boost::bind(&replay_connection::handle_read_body, shared_from_this(), boost::asio::placeholders::error));
+            }
+            else
+                close();
+        }
+
+        //! Handles reading message body by comparing it with captured response.
+        //! \param error error code of error that may happen during read.
+        void handle_read_body(const boost::system::error_code& error)
+        {
+            if (error)
+                return close();
+
+            std::string rsp(m_read_msg.body(), m_read_msg.body_length());
+            if (replay_session::spectator_message(rsp)) // not a response to any request
+            {
+                ++m_stats.spectator;
+                if (!m_closed)
+                    read_header();
+                return;
+            }
+            if (!m_sent.empty())
+            {
+                m_stats.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_sent.front()).count());
+                m_sent.pop_front();
+            }
+            ++m_stats.received;
+            if (m_skip)
+            {
+                --m_skip;
+                if (rsp != message_types::MSG_SEED_OK)
+                    m_stats.seed_refused = true;
+            }
+            else if (m_received < m_session.expected.size())
+            {
+                const std::string& expected = m_session.expected[m_received++];
+                // tokens are random and not captured, responses are compared without them
+                if (capture_file::redact(rsp) != expected && (++m_stats.mismatches <= PRINTED_MISMATCHES || m_stats.verbose))
+                    std::cout << "session " << m_session.id << " response " << m_received << ": expected '" << expected << "', got '" << rsp << "'" << std::endl;
+            }
+            else
+                ++m_stats.unexpected;
+
+            if (!m_closed)
+            {
+                read_header();
+                if (m_speed > 0 && m_next_step < m_session.steps.size())
+                    return; // next message is already scheduled
+                schedule();
+            }
+        }
+
+        //! Sends message to the server.
+        //! \param msg body of the message.
+        void send(const std::string& msg)
+        {
+            ++m_stats.sent;
+            m_sent.push_back(std::chrono::steady_clock::now());
+            bool write_in_progress = !m_write_msgs.empty();
+            m_write_msgs.push_back(message(msg));
+            if (!write_in_progress)
+                write();
+        }
+
+        //! Writes first queued message.
+        void write()
+        {
+            boost::asio::async_write(m_socket, boost::asio::buffer(m_write_msgs.front().data(), m_write_msgs.front().length()),
+                boost::bind(&replay_connection::handle_write, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Handles writing of the message to the server.
+        //! \param error error code of error that may happen during the writing.
+        void handle_write(const boost::system::error_code& error)
+        {
+            if (error)
+                return close();
+            m_write_msgs.pop_front();
+            if (!m_write_msgs.empty())
+                write();
+        }
+
+        //! Closes the connection and counts responses, which were not received.
+        void close()
+        {
+            if (m_closed)
+                return;
+            m_closed = true;
+            if (m_received < m_session.expected.size())
+                m_stats.missing += m_session.expected.size() - m_received;
+            m_timer.cancel();
+            boost::system::error_code ignored;
+            m_socket.close(ignored);
+        }
+
+        tcp::socket m_socket; //!< Socket connected to the server.
+        boost::asio::deadline_timer m_timer; //!< Timer for captured times.
+        const replay_session& m_session; //!< Replayed session.
+        replay_stats& m_stats; //!< Shared results.
+        std::chrono::steady_clock::time_point m_start; //!< Beginning of the replay.
+        double m_speed; //!< Replay speed, 0 for maximal.
+        message m_read_msg; //!< Message being read.
+        std::deque<message> m_write_msgs; //!< Messages to write.
+        std::deque<std::chrono::steady_clock::time_point> m_sent; //!< Send times of messages waiting for response.
+        std::size_t m_next_step; //!< Index of next message in \ref replay_session::steps.
+        std::size_t m_received; //!< Captured responses received so far.
+        int m_skip; //!< Responses to injected messages, which are not compared.
+        bool m_closed; //!< Indicates, that connection was closed.
+};
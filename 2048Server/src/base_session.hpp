@@ -1,7 +1,6 @@
 #pragma once
 #include <boost/shared_ptr.hpp>
-
-class message;
+#include "message_pool.hpp"
 
 /**!
     \ingroup server
@@ -15,11 +14,19 @@ class base_session
         virtual ~base_session() = default;
 
         //! Pure virtual method for delivering messages.
-        //! \param msg \ref message to deliver.
+        //! \param msg pooled \ref message to deliver, it may be shared with other sessions.
         //! \sa session::deliver
-        virtual void deliver(const message& msg) = 0;
+        virtual void deliver(const message_ptr& msg) = 0;
 
         //! Pure virtual method for saving data to database.
         //! \sa session::save_data
         virtual void save_data() = 0;
+
+        //! Pure virtual method called, when session leaves \ref session_container, after its data were saved.
+        //! \sa session::left
+        virtual void left() = 0;
+
+        //! Pure virtual method for closing connection of the session, e.g. when its player resumed the game from another one.
+        //! \sa session::close
+        virtual void close() = 0;
 };
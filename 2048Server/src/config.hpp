@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <map>
+#include <fstream>
+#include <regex>
+
+/**!
+    \ingroup server
+    \brief Key = value configuration loaded from conf file (usually 2048.conf).
+
+    Lines are in form <em>key = value</em>, anything after the value is ignored, so
+    it can be used for comments.
+*/
+class config
+{
+    public:
+        //! Loads configuration from given file.
+        //! \param file path to configuration file.
+        //! \return true if file could be read, false otherwise.
+        bool load(const std::string& file)
+        {
+            std::ifstream conf_file(file);
+            if (conf_file.fail())
+                return false;
+
+            std::smatch match;
+            std::string line;
+            std::regex line_regex(R"(^ *(\w+) *= *([^\s#]+).*$)");
+            while (std::getline(conf_file, line))
+                if (std::regex_match(line, match, line_regex))
+                    m_values[match[1]] = match[2];
+            return true;
+        }
+
+        //! Gets string value of given key.
+        //! \param key key to look for.
+        //! \param def value returned when key is not configured.
+        //! \return configured value or \a def.
+        std::string get(const std::string& key, const std::string& def = "") const
+        {
+            auto it = m_values.find(key);
+            return it != m_values.end() ? it->second : def;
+        }
+
+        //! Gets numeric value of given key.
+        //! \param key key to look for.
+        //! \param def value returned when key is not configured or is not a number.
+        //! \return configured value or \a def.
+        long long get_int(const std::string& key, long long def) const
+        {
+            auto it = m_values.find(key);
+            if (it == m_values.end())
+                return def;
+            try { return std::stoll(it->second); }
+            catch (std::exception&) { return def; }
+        }
+
+        //! Gets decimal value of given key.
+        //! \param key key to look for.
+        //! \param def value returned when key is not configured or is not a number.
+        //! \return configured value or \a def.
+        double get_double(const std::string& key, double def) const
+        {
+            auto it = m_values.find(key);
+            if (it == m_values.end())
+                return def;
+            try { return std::stod(it->second); }
+            catch (std::exception&) { return def; }
+        }
+
+    private:
+        std::map<std::string, std::string> m_values; //!< Configured values.
+};
@@ -0,0 +1,86 @@
+#include "gameplay_stats.hpp"
+
+namespace
+{
+    const char* COUNTER_NAMES[gameplay_stats::MAX_COUNTERS] = { "moves", "games_started", "games_won", "games_lost" };
+
+    const char* HISTOGRAM_NAMES[gameplay_stats::MAX_HISTOGRAMS] = { "final_score", "game_duration_s", "game_moves" };
+}
+
+gameplay_stats& gameplay_stats::instance()
+{
+    static gameplay_stats inst;
+    return inst;
+}
+
+gameplay_stats::point gameplay_stats::merge()
+{
+    point res;
+    res.time = std::chrono::steady_clock::now();
+    res.counters = shards::counters();
+    return res;
+}
+
+void gameplay_stats::sample()
+{
+    gameplay_stats& inst = instance();
+    std::lock_guard<std::mutex> lock(inst.m_mutex);
+    point now = merge();
+    inst.m_minute.push_back(now);
+    if (inst.m_minute.size() > SAMPLES_PER_MINUTE + 1)
+        inst.m_minute.pop_front();
+    if (inst.m_samples++ % SAMPLES_PER_MINUTE == 0)
+    {
+        inst.m_hour.push_back(now);
+        if (inst.m_hour.size() > MINUTES_PER_HOUR + 1)
+            inst.m_hour.pop_front();
+    }
+}
+
+gameplay_stats::summary gameplay_stats::get()
+{
+    gameplay_stats& inst = instance();
+    summary res;
+    res.histograms = shards::histograms();
+    std::lock_guard<std::mutex> lock(inst.m_mutex);
+    point now = merge();
+    for (int i = 0; i < MAX_COUNTERS; ++i)
+        res.totals[i] = now.counters[i];
+
+    res.moves_per_second = res.games_per_minute = 0;
+    if (inst.m_minute.size() > 1)
+    {
+        const point& first = inst.m_minute.front();
+        const point& last = inst.m_minute.back();
+        double seconds = std::chrono::duration<double>(last.time - first.time).count();
+        std::uint64_t games = last.counters[GAMES_WON] + last.counters[GAMES_LOST] - first.counters[GAMES_WON] - first.counters[GAMES_LOST];
+        res.moves_per_second = (last.counters[MOVES] - first.counters[MOVES]) / seconds;
+        res.games_per_minute = games * 60 / seconds;
+    }
+    for (int i = 0; i < MAX_BLOCKS; ++i) // includes events since last sample, hour of samples is at most an hour ago
+        res.tiles_last_hour[i] = now.counters[MAX_COUNTERS + i] - (inst.m_hour.empty() ? 0 : inst.m_hour.front().counters[MAX_COUNTERS + i]);
+    return res;
+}
+
+void gameplay_stats::dump(std::ostream& os)
+{
+    summary sum = get();
+    for (int i = 0; i < MAX_COUNTERS; ++i)
+        os << "gameplay " << COUNTER_NAMES[i] << " " << sum.totals[i] << "\n";
+    os << "gameplay moves_per_second " << sum.moves_per_second << "\n";
+    os << "gameplay games_per_minute " << sum.games_per_minute << "\n";
+    for (int i = BLOCK_2; i < MAX_BLOCKS; ++i)
+        if (sum.tiles_last_hour[i])
+            os << "gameplay tile_" << pow2(i) << "_last_hour " << sum.tiles_last_hour[i] << "\n";
+    for (int i = 0; i < MAX_HISTOGRAMS; ++i)
+    {
+        const histogram& hist = (*sum.histograms)[i];
+        os << "gameplay " << HISTOGRAM_NAMES[i]
+           << " count=" << hist.count()
+           << " mean=" << static_cast<std::uint64_t>(hist.mean())
+           << " p50=" << hist.percentile(50)
+           << " p90=" << hist.percentile(90)
+           << " p99=" << hist.percentile(99)
+           << " max=" << hist.max() << "\n";
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include "../../Common/main.hpp"
+#include "sharded_counters.hpp"
+
+/**!
+    \ingroup server
+    \brief Server-wide aggregates of gameplay of all players.
+
+    Games feed the aggregates from \ref player_data::play and \ref player_data::restart. Recording
+    a move costs a single relaxed increment of per-thread shard (\ref sharded_counters), other events are recorded once per game.
+    Shards are merged once per second by \ref sample, which remembers cumulative totals of last minute and
+    last hour, so rates over these windows are differences of two samples and readers never scan players
+    or the database. Score and duration histograms are mergeable and merged only when read.
+*/
+class gameplay_stats
+{
+    public:
+        //! Monotonic counters of gameplay events.
+        enum Counters
+        {
+            MOVES = 0, //!< Moves, which changed the board.
+            GAMES_STARTED, //!< Restarted games.
+            GAMES_WON, //!< Games, which reached \ref WINNING_BLOCK.
+            GAMES_LOST, //!< Games, which ended with no possible move before winning.
+
+            MAX_COUNTERS,
+        };
+
+        //! Histograms of finished (won or lost) games.
+        enum Histograms
+        {
+            FINAL_SCORE = 0, //!< Score, when the game finished.
+            GAME_DURATION, //!< Seconds from restart, until the game finished.
+            GAME_MOVES, //!< Moves of the game, until it finished.
+
+            MAX_HISTOGRAMS,
+        };
+
+        static const int SAMPLES_PER_MINUTE = 60; //!< Samples per minute, i.e. \ref sample is expected every second.
+        static const int MINUTES_PER_HOUR = 60; //!< Samples per hour window, one per minute.
+
+        //! Merged aggregates.
+        struct summary
+        {
+            std::array<std::uint64_t, MAX_COUNTERS> totals; //!< Counters since start of the server.
+            double moves_per_second; //!< Moves per second over last minute.
+            double games_per_minute; //!< Finished games over last minute.
+            std::array<std::uint64_t, MAX_BLOCKS> tiles_last_hour; //!< Games, which reached each block over last hour.
+            std::unique_ptr<std::array<histogram, MAX_HISTOGRAMS>> histograms; //!< Histograms since start of the server.
+        };
+
+        //! Increments counter of calling thread.
+        //! \param counter counter to increment.
+        static void increment(Counters counter) { shards::increment(counter); }
+
+        //! Records, that a game reached block for the first time.
+        //! \param block the block.
+        static void reached(Blocks block) { shards::increment(MAX_COUNTERS + block); }
+
+        //! Records finished game into histograms of calling thread.
+        //! \param won true if the game was won, false if it was lost.
+        //! \param score score of the game.
+        //! \param seconds duration of the game.
+        //! \param moves moves of the game.
+        static void finished(bool won, std::uint64_t score, std::uint64_t seconds, std::uint64_t moves)
+        {
+            increment(won ? GAMES_WON : GAMES_LOST);
+            shards::record(FINAL_SCORE, score);
+            shards::record(GAME_DURATION, seconds);
+            shards::record(GAME_MOVES, moves);
+        }
+
+        //! Merges shards and remembers their totals for windowed rates. Called every second by the server.
+        static void sample();
+
+        //! Gets merged aggregates.
+        //! \return the aggregates, rates are as of last \ref sample.
+        static summary get();
+
+        //! Writes aggregates in text form of \ref metrics::dump.
+        //! \param os stream to write to.
+        static void dump(std::ostream& os);
+
+    private:
+        static const int SLOTS = MAX_COUNTERS + MAX_BLOCKS; //!< Counters followed by counters of reached blocks.
+
+        using shards = sharded_counters<gameplay_stats, SLOTS, MAX_HISTOGRAMS>; //!< Counters and histograms of all threads.
+
+        //! Merged counters at some time.
+        struct point
+        {
+            std::chrono::steady_clock::time_point time; //!< Time of the sample.
+            shards::counters_t counters; //!< Totals of all threads.
+        };
+
+        gameplay_stats() : m_samples(0) { }
+
+        //! Gets the only instance.
+        //! \return reference to the instance.
+        static gameplay_stats& instance();
+
+        //! Sums counters of all threads.
+        //! \return current totals.
+        static point merge();
+
+        std::mutex m_mutex; //!< Guards samples.
+        std::deque<point> m_minute; //!< Samples of last minute, one per \ref sample.
+        std::deque<point> m_hour; //!< Samples of last hour, one per minute.
+        std::uint64_t m_samples; //!< Number of calls of \ref sample.
+};
@@ -0,0 +1,293 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include "../../Common/main.hpp"
+#include "order_statistics.hpp"
+#include "sql_connection.hpp"
+#include "config.hpp"
+#include "metrics.hpp"
+
+/**!
+    \ingroup server
+    \brief In-memory global leaderboard of best results of players.
+
+    Each board keeps best value of every player in \ref ranked_skip_list, so updating a record, rank
+    of a player and top-K are O(log n) (plus K). Sessions submit their records after every move, which costs
+    single hash lookup unless the player beat own record. When <em>leaderboard_file</em> is configured, the
+    boards are loaded from it at startup and written into it every <em>leaderboard_interval</em> seconds, if changed.
+    Without the snapshot, the boards are filled from global stats in database by single query at startup.
+    \sa session::update_leaderboard
+*/
+class leaderboard
+{
+    public:
+        //! Ranked results.
+        enum Boards
+        {
+            SCORE = 0, //!< Highest score, higher is better.
+            MAX_BLOCK, //!< Value of maximal block, higher is better.
+            FASTEST_WIN, //!< Seconds of fastest win, lower is better.
+
+            MAX_BOARDS,
+        };
+
+        //! Result of single player on a board.
+        struct entry
+        {
+            long long value; //!< Best value of the player.
+            int id; //!< Player's id.
+        };
+
+        //! Loads snapshot, or results from database if there is none, and starts periodic snapshots, if configured.
+        //! \param io_service reference to boost io_service.
+        //! \param sql \ref sql_connection, from which results are loaded.
+        //! \param conf server configuration.
+        leaderboard(boost::asio::io_service& io_service, sql_connection& sql, const config& conf) :
+            m_timer(io_service), m_file(conf.get("leaderboard_file")), m_interval(std::max(1LL, conf.get_int("leaderboard_interval", 60))), m_dirty(false), m_version(0)
+        {
+            for (int i = 0; i < MAX_BOARDS; ++i)
+                m_ranks[i].reset(new ranked_skip_list<entry, order>(order(static_cast<Boards>(i))));
+            if (!m_file.empty() && std::ifstream(m_file))
+            {
+                if (!load(m_file))
+                    std::cerr << "Failed to load leaderboard from '" << m_file << "'." << std::endl;
+            }
+            else
+                load(sql);
+            if (m_file.empty())
+                return;
+            m_dirty = false;
+            start_snapshot();
+        }
+
+        //! Destructor, which removes players from metrics.
+        ~leaderboard() { metrics::add(metrics::LEADERBOARD_PLAYERS, -static_cast<long long>(m_names.size())); }
+
+        //! Gets board by its name used in messages.
+        //! \param name name of the board, see \ref leaderboards.
+        //! \param board resulting board.
+        //! \return true if the name is valid, false otherwise.
+        static bool parse_board(const std::string& name, Boards& board)
+        {
+            for (int i = 0; i < MAX_BOARDS; ++i)
+                if (name == board_name(static_cast<Boards>(i)))
+                {
+                    board = static_cast<Boards>(i);
+                    return true;
+                }
+            return false;
+        }
+
+        //! Gets name of board used in messages and snapshots.
+        //! \param board the board.
+        //! \return name of the board.
+        static const std::string& board_name(Boards board)
+        {
+            static const std::string NAMES[MAX_BOARDS] = { leaderboards::SCORE, leaderboards::MAX_BLOCK, leaderboards::FASTEST_WIN };
+            return NAMES[board];
+        }
+
+        //! Records result of a player, if it is better than his previous one.
+        //! \param board board of the result.
+        //! \param id player's id, results of not logged players (0) are ignored.
+        //! \param name player's name.
+        //! \param value the result, values <= 0 are ignored.
+        //! \return true if the board changed, false otherwise.
+        bool submit(Boards board, int id, const std::string& name, long long value)
+        {
+            if (!id || value <= 0)
+                return false;
+            auto it = m_best[board].find(id);
+            if (it != m_best[board].end())
+            {
+                if (!order(board)(entry{ value, id }, entry{ it->second, id }))
+                    return false;
+                m_ranks[board]->erase(entry{ it->second, id });
+                it->second = value;
+            }
+            else
+                m_best[board].emplace(id, value);
+            m_ranks[board]->insert(entry{ value, id });
+
+            auto name_it = m_names.find(id);
+            if (name_it == m_names.end())
+            {
+                m_names.emplace(id, name);
+                metrics::add(metrics::LEADERBOARD_PLAYERS, 1);
+            }
+            else if (name_it->second != name)
+                name_it->second = name;
+            metrics::increment(metrics::LEADERBOARD_UPDATES);
+            m_dirty = true;
+            ++m_version;
+            return true;
+        }
+
+        //! Gets result and rank of a player.
+        //! \param board the board.
+        //! \param id player's id.
+        //! \param res result of the player.
+        //! \return 1-based rank of the player, 0 if he has no result on the board.
+        std::size_t rank(Boards board, int id, entry& res) const
+        {
+            auto it = m_best[board].find(id);
+            if (it == m_best[board].end())
+                return 0;
+            res = entry{ it->second, id };
+            return m_ranks[board]->rank(res);
+        }
+
+        //! Gets best results.
+        //! \param board the board.
+        //! \param count number of results.
+        //! \return at most \a count best results ordered from the best.
+        std::vector<entry> top(Boards board, std::size_t count) const { return m_ranks[board]->range(0, count); }
+
+        //! Gets version of the boards, which changes with every improved result.
+        //! \return number of improved results.
+        std::uint64_t version() const { return m_version; }
+
+        //! Gets number of players on a board.
+        //! \param board the board.
+        //! \return number of players with result on the board.
+        std::size_t size(Boards board) const { return m_ranks[board]->size(); }
+
+        //! Gets name of a player.
+        //! \param id player's id.
+        //! \return name of the player, empty if he has no result.
+        const std::string& name(int id) const
+        {
+            static const std::string none;
+            auto it = m_names.find(id);
+            return it != m_names.end() ? it->second : none;
+        }
+
+        //! Writes all boards into file. The file is replaced atomically, so snapshot is never partial.
+        //! Lines are in form <em>board id value name</em>.
+        //! \param file path to the file.
+        //! \return true on success, false otherwise.
+        bool save(const std::string& file) const
+        {
+            std::string tmp = file + ".tmp";
+            {
+                std::ofstream out(tmp, std::ios::trunc);
+                if (out.fail())
+                    return false;
+                for (int i = 0; i < MAX_BOARDS; ++i)
+                    for (const auto& item : m_ranks[i]->range(0, m_ranks[i]->size()))
+                        out << board_name(static_cast<Boards>(i)) << " " << item.id << " " << item.value << " " << name(item.id) << "\n";
+                if (out.fail())
+                    return false;
+            }
+#ifdef _WIN32
+            std::remove(file.c_str()); // rename does not overwrite on windows
+#endif
+            return std::rename(tmp.c_str(), file.c_str()) == 0;
+        }
+
+        //! Adds results from file written by \ref save.
+        //! \param file path to the file.
+        //! \return true if the file was read and all lines were valid, false otherwise.
+        bool load(const std::string& file)
+        {
+            std::ifstream in(file);
+            if (in.fail())
+                return false;
+            bool valid = true;
+            std::string line, board_str, name;
+            while (std::getline(in, line))
+            {
+                std::istringstream ss(line);
+                int id;
+                long long value;
+                Boards board;
+                if (ss >> board_str >> id >> value && ss.get() == ' ' && std::getline(ss, name) && parse_board(board_str, board))
+                    submit(board, id, name, value);
+                else
+                    valid = false;
+            }
+            return valid;
+        }
+
+        //! Adds best results of players from global stats in database.
+        //! \param sql \ref sql_connection representing database.
+        void load(sql_connection& sql)
+        {
+            for (const auto& res : sql.get_best_results())
+            {
+                switch (std::get<2>(res))
+                {
+                    case stats::HIGHEST_SCORE: submit(SCORE, std::get<0>(res), std::get<1>(res), std::get<3>(res)); break;
+                    case stats::MAXIMAL_BLOCK: submit(MAX_BLOCK, std::get<0>(res), std::get<1>(res), pow2(static_cast<int>(std::get<3>(res)))); break;
+                    case stats::FASTEST_WIN: submit(FASTEST_WIN, std::get<0>(res), std::get<1>(res), std::get<3>(res)); break;
+                    default: break;
+                }
+            }
+        }
+
+    private:
+        //! Ordering of results on a board, from the best. Ties are ordered by player's id.
+        class order
+        {
+            public:
+                //! Constructs ordering of given board.
+                //! \param board the board.
+                explicit order(Boards board = SCORE) : m_lower_better(board == FASTEST_WIN) { }
+
+                //! Compares results.
+                //! \param a first result.
+                //! \param b second result.
+                //! \return true if \a a is ranked before \a b.
+                bool operator()(const entry& a, const entry& b) const
+                {
+                    if (a.value != b.value)
+                        return m_lower_better ? a.value < b.value : a.value > b.value;
+                    return a.id < b.id;
+                }
+
+            private:
+                bool m_lower_better; //!< Indicates, that lower values are better.
+        };
+
+        //! Schedules next snapshot.
+        void start_snapshot()
+        {
+            m_timer.expires_from_now(boost::posix_time::seconds(m_interval));
+            m_timer.async_wait(boost::bind(&leaderboard::handle_snapshot, this, boost::asio::placeholders::error));
+        }
+
+        //! Writes snapshot, if the boards changed, and schedules next one.
+        //! \param error error code that may happen during waiting.
+        void handle_snapshot(const boost::system::error_code& error)
+        {
+            if (error)
+                return;
+            if (m_dirty)
+            {
+                if (save(m_file))
+                    m_dirty = false;
+                else
+                    std::cerr << "Failed to write leaderboard to '" << m_file << "'." << std::endl;
+            }
+            start_snapshot();
+        }
+
+        std::unique_ptr<ranked_skip_list<entry, order>> m_ranks[MAX_BOARDS]; //!< Results of each board ordered from the best.
+        std::unordered_map<int, long long> m_best[MAX_BOARDS]; //!< Best value of each player on each board.
+        std::unordered_map<int, std::string> m_names; //!< Names of players with any result.
+        boost::asio::deadline_timer m_timer; //!< Timer for periodic snapshots.
+        std::string m_file; //!< Snapshot file, empty disables snapshots.
+        long long m_interval; //!< Seconds between snapshots.
+        bool m_dirty; //!< Indicates, that the boards changed since last snapshot.
+        std::uint64_t m_version; //!< Number of improved results. \sa version
+};
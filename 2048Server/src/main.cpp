@@ -3,6 +3,7 @@
 #include <iostream>
 #include <boost/asio.hpp>
 #include "../../Common/main.hpp"
+#include "config.hpp"
 #include "server.hpp"
 using boost::asio::ip::tcp;
 
@@ -12,28 +13,13 @@ int main(int argc, char* argv[])
     if (argc > 1)
         file = argv[1];
         
-    std::ifstream conf_file(file);
-    if (conf_file.fail())
+    config conf;
+    if (!conf.load(file))
     {
         std::cerr << "Failed to open '" << file << "'." << std::endl;
         return EXIT_FAILURE;
     }
-    std::smatch match;
-    std::string line, host, user, pass, db;
-    while (std::getline(conf_file, line))
-    {
-        if (std::regex_match(line, match, std::regex(R"(^ *(\w+) *= *([^\s#]+).*$)")))
-        {
-            if (match[1] == "host")
-                host = match[2];
-            else if (match[1] == "user")
-                user = match[2];
-            else if (match[1] == "pass")
-                pass = match[2];
-            else if (match[1] == "db")
-                db = match[2];
-        }
-    }
+    std::string host = conf.get("host"), user = conf.get("user"), pass = conf.get("pass"), db = conf.get("db");
     if (host.empty() || user.empty() || pass.empty() || db.empty())
     {
         std::cerr << "Configuration of 'host', 'user', 'pass' or 'db' is missing from '" << file << "'." << std::endl;
@@ -44,7 +30,7 @@ int main(int argc, char* argv[])
         boost::asio::io_service io_service;
         tcp::endpoint endpoint(tcp::v4(), std::stoi(PORT));
 
-        boost::shared_ptr<server> ser(new server(io_service, endpoint, sql_connection(host, user, pass, db)));
+        boost::shared_ptr<server> ser(new server(io_service, endpoint, sql_connection(host, user, pass, db), conf));
         
         io_service.run();
     }
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <boost/intrusive_ptr.hpp>
+#include "../../Common/message.hpp"
+#include "metrics.hpp"
+
+/**!
+    \ingroup server
+    \brief Reference counted \ref message allocated from per-thread pool.
+
+    Queued and broadcast messages are shared by \ref message_ptr instead of being copied. When the last
+    reference is released, the buffer returns into pool of releasing thread, so steady traffic does not allocate.
+    \sa make_message
+*/
+class message_buffer
+{
+    public:
+        static const std::size_t MAX_POOLED = 4096; //!< Buffers kept in pool of single thread, others are freed.
+
+        //! Gets buffer from pool of calling thread, or allocates new one if the pool is empty.
+        //! \return buffer with no references.
+        static message_buffer* acquire()
+        {
+            std::vector<message_buffer*>& pool = free_list().buffers;
+            if (pool.empty())
+            {
+                metrics::increment(metrics::MESSAGE_ALLOCATIONS);
+                return new message_buffer();
+            }
+            message_buffer* buf = pool.back();
+            pool.pop_back();
+            return buf;
+        }
+
+        message msg; //!< The message.
+
+    private:
+        //! Buffers are created only by \ref acquire.
+        message_buffer() : m_refs(0) { }
+
+        //! Pool of free buffers of single thread, frees them at thread exit.
+        struct pool
+        {
+            ~pool()
+            {
+                for (message_buffer* buf : buffers)
+                    delete buf;
+            }
+
+            std::vector<message_buffer*> buffers; //!< Free buffers.
+        };
+
+        //! Gets pool of calling thread.
+        //! \return reference to thread-local pool.
+        static pool& free_list()
+        {
+            static thread_local pool instance;
+            return instance;
+        }
+
+        //! Returns buffer into pool of calling thread.
+        //! \param buf buffer with no references.
+        static void recycle(message_buffer* buf)
+        {
+            std::vector<message_buffer*>& pool = free_list().buffers;
+            if (pool.size() < MAX_POOLED)
+                pool.push_back(buf);
+            else
+                delete buf;
+        }
+
+        //! Adds reference, used by \a boost::intrusive_ptr.
+        friend void intrusive_ptr_add_ref(message_buffer* buf) { buf->m_refs.fetch_add(1, std::memory_order_relaxed); }
+        //! Releases reference, used by \a boost::intrusive_ptr.
+        friend void intrusive_ptr_release(message_buffer* buf)
+        {
+            if (buf->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                recycle(buf);
+        }
+
+        std::atomic<std::size_t> m_refs; //!< Number of references.
+};
+
+//! Shared pointer to pooled \ref message.
+using message_ptr = boost::intrusive_ptr<message_buffer>;
+
+//! Creates pooled message with given body.
+//! \param body body of the message, truncated to \ref message::MAX_BODY_LENGTH.
+//! \return pointer to the message.
+inline message_ptr make_message(const std::string& body)
+{
+    message_ptr res(message_buffer::acquire());
+    std::size_t length = std::min(body.length(), static_cast<std::size_t>(message::MAX_BODY_LENGTH));
+    std::memcpy(res->msg.body(), body.data(), length);
+    res->msg.body_length(length);
+    res->msg.encode_header();
+    return res;
+}
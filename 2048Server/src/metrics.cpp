@@ -0,0 +1,78 @@
+#include "metrics.hpp"
+#include "gameplay_stats.hpp"
+#include <fstream>
+#include <cstdio>
+#include <ctime>
+
+namespace
+{
+    const char* COUNTER_NAMES[metrics::MAX_COUNTERS] = {
+        "msg_login", "msg_data", "msg_play", "msg_restart", "msg_seed", "msg_heartbeat", "msg_leaderboard", "msg_spectate", "msg_resume", "msg_invalid",
+        "msgs_in", "msgs_out", "bytes_in", "bytes_out",
+        "sql_queries", "sql_errors", "sessions_accepted", "sessions_closed",
+        "timeouts_idle", "timeouts_read", "write_queue_overflows", "write_queue_disconnects", "reads_paused", "coalesced_writes", "message_allocations",
+        "throttled_login", "throttled_game", "throttled_other", "throttle_disconnects",
+        "logins_shed", "stats_deferred", "overload_level_changes", "leaderboard_updates",
+        "spectator_broadcasts", "spectator_deliveries", "spectator_lags", "spectator_catchups",
+        "http_requests", "http_cache_misses", "resumes_failed", "resumes_resynced",
+    };
+
+    const char* HISTOGRAM_NAMES[metrics::MAX_HISTOGRAMS] = {
+        "lat_login_us", "lat_data_us", "lat_play_us", "lat_restart_us", "lat_leaderboard_us",
+        "lat_sql_login_us", "lat_sql_get_data_us", "lat_sql_save_data_us", "lat_sql_query_us",
+        "lat_write_us", "write_queue_depth", "client_rtt_us", "loop_lag_us",
+    };
+
+    const char* GAUGE_NAMES[metrics::MAX_GAUGES] = {
+        "active_sessions", "write_queue_messages", "write_queue_bytes", "rate_limiter_addresses", "overload_level", "deferred_stats", "leaderboard_players", "spectators",
+    };
+}
+
+metrics& metrics::instance()
+{
+    static metrics inst;
+    return inst;
+}
+
+void metrics::dump(std::ostream& os)
+{
+    metrics& inst = instance();
+    shards::counters_t counters = shards::counters();
+    std::unique_ptr<shards::histograms_t> histograms = shards::histograms();
+
+    os << "# 2048 server metrics, unix time " << std::time(nullptr) << "\n";
+    for (int i = 0; i < MAX_COUNTERS; ++i)
+        os << "counter " << COUNTER_NAMES[i] << " " << counters[i] << "\n";
+    for (int i = 0; i < MAX_GAUGES; ++i)
+        os << "gauge " << GAUGE_NAMES[i] << " " << inst.m_gauges[i].load(std::memory_order_relaxed) << "\n";
+    for (int i = 0; i < MAX_HISTOGRAMS; ++i)
+    {
+        const histogram& hist = (*histograms)[i];
+        os << "histogram " << HISTOGRAM_NAMES[i]
+           << " count=" << hist.count()
+           << " mean=" << static_cast<std::uint64_t>(hist.mean())
+           << " p50=" << hist.percentile(50)
+           << " p90=" << hist.percentile(90)
+           << " p99=" << hist.percentile(99)
+           << " p999=" << hist.percentile(99.9)
+           << " max=" << hist.max() << "\n";
+    }
+    gameplay_stats::dump(os);
+}
+
+bool metrics::dump(const std::string& file)
+{
+    std::string tmp = file + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (out.fail())
+            return false;
+        dump(out);
+        if (out.fail())
+            return false;
+    }
+#ifdef _WIN32
+    std::remove(file.c_str()); // rename does not overwrite on windows
+#endif
+    return std::rename(tmp.c_str(), file.c_str()) == 0;
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include "sharded_counters.hpp"
+
+/**!
+    \ingroup server
+    \brief Process wide metrics of the server.
+
+    Counters and histograms are recorded into per-thread shards without any locking (\ref sharded_counters),
+    shards are merged only when the metrics are read (\ref metrics::dump).
+    Gauges are shared atomics, since they represent current state rather than events.
+*/
+class metrics
+{
+    public:
+        //! Monotonic counters.
+        enum Counters
+        {
+            MSG_LOGIN = 0,
+            MSG_DATA,
+            MSG_PLAY,
+            MSG_RESTART,
+            MSG_SEED,
+            MSG_HEARTBEAT,
+            MSG_LEADERBOARD,
+            MSG_SPECTATE,
+            MSG_RESUME, //!< Token and resume requests.
+            MSG_INVALID,
+            MSGS_IN,
+            MSGS_OUT,
+            BYTES_IN,
+            BYTES_OUT,
+            SQL_QUERIES,
+            SQL_ERRORS,
+            SESSIONS_ACCEPTED,
+            SESSIONS_CLOSED,
+            TIMEOUTS_IDLE, //!< Sessions closed, because no message arrived for idle timeout.
+            TIMEOUTS_READ, //!< Sessions closed, because message body did not arrive in read timeout.
+            WRITE_QUEUE_OVERFLOWS, //!< Times, when write queue of a session exceeded its cap.
+            WRITE_QUEUE_DISCONNECTS, //!< Sessions closed, because their write queue stayed over the cap.
+            READS_PAUSED, //!< Times, when reading from a session was paused, because its write queue was over the cap.
+            COALESCED_WRITES, //!< Writes, which sent more than one message.
+            MESSAGE_ALLOCATIONS, //!< Message buffers allocated, because pool was empty.
+            THROTTLED_LOGIN, //!< Login messages rejected by rate limiter.
+            THROTTLED_GAME, //!< Play and restart messages rejected by rate limiter.
+            THROTTLED_OTHER, //!< Other messages rejected by rate limiter.
+            THROTTLE_DISCONNECTS, //!< Sessions closed, because too many consecutive messages were throttled.
+            LOGINS_SHED, //!< Logins rejected, because the server was overloaded.
+            STATS_DEFERRED, //!< Saves of player stats deferred, because the server was overloaded.
+            OVERLOAD_LEVEL_CHANGES, //!< Changes of load shedding level.
+            LEADERBOARD_UPDATES, //!< Records improved on leaderboard.
+            SPECTATOR_BROADCASTS, //!< Events and snapshots serialized for spectators.
+            SPECTATOR_DELIVERIES, //!< Events and snapshots queued to spectators.
+            SPECTATOR_LAGS, //!< Times, when spectator fell behind and events were dropped for it.
+            SPECTATOR_CATCHUPS, //!< Snapshots sent to spectators, which fell behind.
+            HTTP_REQUESTS, //!< Requests of stats HTTP endpoint.
+            HTTP_CACHE_MISSES, //!< Players loaded from database by stats HTTP endpoint, because they were not cached.
+            RESUMES_FAILED, //!< Resume requests with unknown or expired token.
+            RESUMES_RESYNCED, //!< Resumed sessions, whose client had other board than the server, so it got the whole board.
+
+            MAX_COUNTERS,
+        };
+
+        //! Latency (in microseconds) and size histograms.
+        enum Histograms
+        {
+            LAT_LOGIN = 0,
+            LAT_DATA,
+            LAT_PLAY,
+            LAT_RESTART,
+            LAT_LEADERBOARD,
+            LAT_SQL_LOGIN,
+            LAT_SQL_GET_DATA,
+            LAT_SQL_SAVE_DATA,
+            LAT_SQL_QUERY,
+            LAT_WRITE, //!< Time from queueing a message until it is written to the socket.
+            WRITE_QUEUE_DEPTH, //!< Messages in session's write queue when new one is queued.
+            CLIENT_RTT, //!< Round trip time reported by clients in heartbeats.
+            LOOP_LAG, //!< Delay of overload monitor's timer, i.e. time events wait in the event loop.
+
+            MAX_HISTOGRAMS,
+        };
+
+        //! Current state values.
+        enum Gauges
+        {
+            ACTIVE_SESSIONS = 0,
+            WRITE_QUEUE_MESSAGES,
+            WRITE_QUEUE_BYTES,
+            RATE_LIMITER_ADDRESSES, //!< Source addresses tracked by rate limiter.
+            OVERLOAD_LEVEL, //!< Current level of load shedding. \sa overload_monitor::Levels
+            DEFERRED_STATS, //!< Player stats waiting for saving.
+            LEADERBOARD_PLAYERS, //!< Players with a result on leaderboard.
+            SPECTATORS, //!< Sessions watching another player.
+
+            MAX_GAUGES,
+        };
+
+        //! Increments a counter of calling thread.
+        //! \param counter counter to increment.
+        //! \param value amount to increment by.
+        static void increment(Counters counter, std::uint64_t value = 1) { shards::increment(counter, value); }
+
+        //! Records value into histogram of calling thread.
+        //! \param hist histogram to record to.
+        //! \param value value to record.
+        static void record(Histograms hist, std::uint64_t value) { shards::record(hist, value); }
+
+        //! Adds (or subtracts) value to gauge.
+        //! \param gauge gauge to change.
+        //! \param value difference.
+        static void add(Gauges gauge, long long value) { instance().m_gauges[gauge].fetch_add(value, std::memory_order_relaxed); }
+
+        //! Gets current value of gauge.
+        //! \param gauge gauge to read.
+        //! \return the value.
+        static long long get(Gauges gauge) { return instance().m_gauges[gauge].load(std::memory_order_relaxed); }
+
+        //! Writes merged metrics of all threads in text form.
+        //! \param os stream to write to.
+        static void dump(std::ostream& os);
+
+        //! Writes metrics into file. The file is replaced atomically, so readers never see partial dump.
+        //! \param file path to the file.
+        //! \return true on success, false otherwise.
+        static bool dump(const std::string& file);
+
+        //! Converts duration to microseconds used by latency histograms.
+        //! \param dur duration to convert.
+        //! \return duration in microseconds.
+        template<typename Duration>
+        static std::uint64_t micros(const Duration& dur) { return std::chrono::duration_cast<std::chrono::microseconds>(dur).count(); }
+
+        /**!
+            \brief Records time of its lifetime into latency histogram.
+        */
+        class scoped_timer
+        {
+            public:
+                //! Starts measuring.
+                //! \param hist histogram to record into.
+                explicit scoped_timer(Histograms hist) : m_hist(hist), m_start(std::chrono::steady_clock::now()) { }
+
+                //! Records measured time.
+                ~scoped_timer() { record(m_hist, micros(std::chrono::steady_clock::now() - m_start)); }
+
+            private:
+                Histograms m_hist; //!< Histogram to record into.
+                std::chrono::steady_clock::time_point m_start; //!< Time of construction.
+        };
+
+    private:
+        using shards = sharded_counters<metrics, MAX_COUNTERS, MAX_HISTOGRAMS>; //!< Counters and histograms of all threads.
+
+        metrics() { for (auto& gauge : m_gauges) gauge.store(0, std::memory_order_relaxed); }
+
+        //! Gets the only instance.
+        //! \return reference to the instance.
+        static metrics& instance();
+
+        std::array<std::atomic<long long>, MAX_GAUGES> m_gauges; //!< Gauge values.
+};
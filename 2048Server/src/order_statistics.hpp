@@ -0,0 +1,215 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**!
+    \ingroup server
+    \brief Sorted container with O(log n) insertion, erasure, rank of a value and access by rank.
+
+    Indexable skip list: every link remembers, how many elements of the bottom level it skips over,
+    so rank of an element is the sum of widths of links followed while searching for it.
+    Values have to be unique with respect to \a Compare.
+    \tparam T type of stored values.
+    \tparam Compare strict weak ordering of values.
+    \sa leaderboard
+*/
+template<typename T, typename Compare = std::less<T>>
+class ranked_skip_list
+{
+    public:
+        static const int MAX_LEVEL = 32; //!< Maximal number of levels, enough for 2^32 elements.
+
+        //! Constructs empty list.
+        //! \param compare ordering of values.
+        explicit ranked_skip_list(const Compare& compare = Compare()) :
+            m_head(new node(T(), MAX_LEVEL)), m_level(1), m_size(0), m_compare(compare), m_random(0x2048) { }
+
+        ranked_skip_list(const ranked_skip_list&) = delete;
+        ranked_skip_list& operator=(const ranked_skip_list&) = delete;
+
+        //! Destructor, which frees all nodes.
+        ~ranked_skip_list()
+        {
+            clear();
+            delete m_head;
+        }
+
+        //! Inserts value.
+        //! \param value value, which is not in the list yet.
+        void insert(const T& value)
+        {
+            node* update[MAX_LEVEL];
+            std::size_t rank[MAX_LEVEL]; // rank of update[i], 0 for head
+            node* x = m_head;
+            std::size_t pos = 0;
+            for (int i = m_level - 1; i >= 0; --i)
+            {
+                while (x->links[i].next && m_compare(x->links[i].next->value, value))
+                {
+                    pos += x->links[i].width;
+                    x = x->links[i].next;
+                }
+                update[i] = x;
+                rank[i] = pos;
+            }
+
+            int level = random_level();
+            for (; m_level < level; ++m_level)
+            {
+                update[m_level] = m_head;
+                rank[m_level] = 0;
+                m_head->links[m_level].width = m_size;
+            }
+
+            node* n = new node(value, level);
+            for (int i = 0; i < level; ++i)
+            {
+                n->links[i].next = update[i]->links[i].next;
+                n->links[i].width = update[i]->links[i].width - (pos - rank[i]);
+                update[i]->links[i].next = n;
+                update[i]->links[i].width = pos + 1 - rank[i];
+            }
+            for (int i = level; i < m_level; ++i)
+                ++update[i]->links[i].width;
+            ++m_size;
+        }
+
+        //! Erases value.
+        //! \param value value to erase.
+        //! \return true if the value was found and erased, false otherwise.
+        bool erase(const T& value)
+        {
+            node* update[MAX_LEVEL];
+            node* x = m_head;
+            for (int i = m_level - 1; i >= 0; --i)
+            {
+                while (x->links[i].next && m_compare(x->links[i].next->value, value))
+                    x = x->links[i].next;
+                update[i] = x;
+            }
+
+            node* n = x->links[0].next;
+            if (!n || m_compare(value, n->value))
+                return false;
+            for (int i = 0; i < m_level; ++i)
+            {
+                if (update[i]->links[i].next == n)
+                {
+                    update[i]->links[i].width += n->links[i].width - 1;
+                    update[i]->links[i].next = n->links[i].next;
+                }
+                else
+                    --update[i]->links[i].width;
+            }
+            delete n;
+            while (m_level > 1 && !m_head->links[m_level - 1].next)
+                --m_level;
+            --m_size;
+            return true;
+        }
+
+        //! Gets rank of value.
+        //! \param value value to look for.
+        //! \return 1-based position of the value, 0 if it is not in the list.
+        std::size_t rank(const T& value) const
+        {
+            const node* x = m_head;
+            std::size_t pos = 0;
+            for (int i = m_level - 1; i >= 0; --i)
+            {
+                while (x->links[i].next && m_compare(x->links[i].next->value, value))
+                {
+                    pos += x->links[i].width;
+                    x = x->links[i].next;
+                }
+            }
+            x = x->links[0].next;
+            return x && !m_compare(value, x->value) ? pos + 1 : 0;
+        }
+
+        //! Gets values at consecutive positions.
+        //! \param first 0-based position of first value.
+        //! \param count maximal number of values.
+        //! \return values at positions <\a first, \a first + \a count), fewer if the list is shorter.
+        std::vector<T> range(std::size_t first, std::size_t count) const
+        {
+            std::vector<T> res;
+            if (first >= m_size)
+                return res;
+            const node* x = m_head;
+            std::size_t pos = 0;
+            for (int i = m_level - 1; i >= 0; --i)
+            {
+                while (x->links[i].next && pos + x->links[i].width <= first + 1)
+                {
+                    pos += x->links[i].width;
+                    x = x->links[i].next;
+                }
+            }
+            for (; x && res.size() < count; x = x->links[0].next)
+                res.push_back(x->value);
+            return res;
+        }
+
+        //! Erases all values.
+        void clear()
+        {
+            for (node* x = m_head->links[0].next; x;)
+            {
+                node* next = x->links[0].next;
+                delete x;
+                x = next;
+            }
+            for (auto& link : m_head->links)
+                link = link_t();
+            m_level = 1;
+            m_size = 0;
+        }
+
+        //! Gets number of values.
+        //! \return number of values in the list.
+        std::size_t size() const { return m_size; }
+
+    private:
+        struct node;
+
+        //! Link to following node of single level.
+        struct link_t
+        {
+            link_t() : next(nullptr), width(0) { }
+
+            node* next; //!< Following node, nullptr at the end.
+            std::size_t width; //!< Number of bottom level links between the nodes.
+        };
+
+        //! Node holding single value.
+        struct node
+        {
+            //! Constructs node without successors.
+            //! \param val stored value.
+            //! \param level number of levels of the node.
+            node(const T& val, int level) : value(val), links(level) { }
+
+            T value; //!< Stored value.
+            std::vector<link_t> links; //!< Links of each level of the node.
+        };
+
+        //! Draws level of new node, each level with half probability of the previous one.
+        //! \return level in range <1, \ref MAX_LEVEL>.
+        int random_level()
+        {
+            int level = 1;
+            for (std::uint32_t bits = m_random(); (bits & 1) && level < MAX_LEVEL; bits >>= 1)
+                ++level;
+            return level;
+        }
+
+        node* m_head; //!< Sentinel node before first value, has all levels.
+        int m_level; //!< Number of levels in use.
+        std::size_t m_size; //!< Number of values.
+        Compare m_compare; //!< Ordering of values.
+        std::mt19937 m_random; //!< Random generator of node levels.
+};
@@ -0,0 +1,189 @@
+#pragma once
+#include <iostream>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include "sql_connection.hpp"
+#include "config.hpp"
+#include "metrics.hpp"
+#include "stats.hpp"
+
+/**!
+    \ingroup server
+    \brief Watches load of the server and decides, which work is shed.
+
+    Every \ref SAMPLE_MS the monitor measures lag of the event loop (how late its timer fires), average latency
+    of SQL queries and bytes queued for writing to all sessions. Each of them is divided by its configured threshold
+    and the highest ratio is the pressure. Work is shed in order of \ref Levels: pressure over 1 rejects new logins,
+    pressure over 2 additionally defers saving of player stats, which are saved once the load drops or when the monitor is destroyed.
+    Deferred stats are held only in memory, so they are lost if the server process is killed or crashes.
+    Messages of sessions already playing are never shed. A level is left, when pressure drops below
+    \ref HYSTERESIS of its threshold.
+    \sa session::handle_message, session::save_data
+*/
+class overload_monitor
+{
+    public:
+        //! Levels of load shedding, each level sheds also work of lower levels.
+        enum Levels
+        {
+            NORMAL = 0, //!< Nothing is shed.
+            SHED_LOGINS, //!< New logins are rejected with retry-after.
+            DEFER_STATS, //!< Saving of player stats is deferred.
+
+            MAX_LEVELS,
+        };
+
+        static const int SAMPLE_MS = 100; //!< Milliseconds between samples.
+        static const std::size_t DRAIN_PER_SAMPLE = 16; //!< Deferred stats saved per sample, when they are not deferred anymore.
+        static constexpr double HYSTERESIS = 0.8; //!< Part of level threshold, below which the pressure has to drop to leave the level.
+        static constexpr double WEIGHT = 0.2; //!< Weight of new sample in moving averages.
+
+        //! Loads thresholds from configuration and starts sampling.
+        //! \param io_service reference to boost io_service.
+        //! \param sql SQL database, which latency is watched.
+        //! \param conf server configuration.
+        overload_monitor(boost::asio::io_service& io_service, sql_connection& sql, const config& conf) :
+            m_timer(io_service), m_sql(sql), m_random(std::random_device()()),
+            m_lag_threshold(conf.get_int("overload_loop_lag_ms", 100) * 1000.0),
+            m_db_threshold(conf.get_int("overload_db_latency_ms", 50) * 1000.0),
+            m_queue_threshold(static_cast<double>(conf.get_int("overload_write_queue_bytes", 16 * 1024 * 1024))),
+            m_retry_after(std::max(1LL, conf.get_int("overload_retry_after_ms", 2000))),
+            m_max_deferred(static_cast<std::size_t>(std::max(0LL, conf.get_int("overload_max_deferred", 10000)))),
+            m_level(NORMAL), m_lag(0), m_db_latency(0), m_queries(sql.queries()), m_query_time(sql.query_time())
+        {
+            start_sample();
+        }
+
+        //! Destructor, which saves deferred stats and removes state of the monitor from metrics.
+        ~overload_monitor()
+        {
+            metrics::add(metrics::OVERLOAD_LEVEL, -static_cast<long long>(m_level));
+            metrics::add(metrics::DEFERRED_STATS, -static_cast<long long>(m_deferred.size()));
+            for (const auto& deferred : m_deferred)
+            {
+                try { m_sql.save_stats(deferred.first, deferred.second); }
+                catch (std::exception& e) { std::cerr << "Failed to save deferred stats of player " << deferred.first << ": " << e.what() << std::endl; }
+            }
+        }
+
+        //! Checks, whether new logins are rejected.
+        //! \return true if the login shall be rejected, false otherwise.
+        bool shed_login()
+        {
+            if (m_level < SHED_LOGINS)
+                return false;
+            metrics::increment(metrics::LOGINS_SHED);
+            return true;
+        }
+
+        //! Gets time, after which rejected login may be repeated. Jittered, so rejected clients do not return at once.
+        //! \return milliseconds to wait.
+        long long retry_after() { return m_retry_after + std::uniform_int_distribution<long long>(0, m_retry_after / 2)(m_random); }
+
+        //! Defers saving of player stats if the server is overloaded.
+        //! \param id player's id.
+        //! \param stats stats to save.
+        //! \return true if the stats were queued and will be saved later, false if they have to be saved now.
+        bool defer_stats(int id, const stats::container_t& stats)
+        {
+            if (m_level < DEFER_STATS || m_deferred.size() >= m_max_deferred)
+                return false;
+            m_deferred.emplace_back(id, stats);
+            metrics::increment(metrics::STATS_DEFERRED);
+            metrics::add(metrics::DEFERRED_STATS, 1);
+            return true;
+        }
+
+        //! Gets current level of load shedding.
+        //! \return the level.
+        Levels level() const { return m_level; }
+
+    private:
+        //! Schedules next sample.
+        void start_sample()
+        {
+            m_expected = std::chrono::steady_clock::now() + std::chrono::milliseconds(SAMPLE_MS);
+            m_timer.expires_from_now(boost::posix_time::milliseconds(SAMPLE_MS));
+            m_timer.async_wait(boost::bind(&overload_monitor::handle_sample, this, boost::asio::placeholders::error));
+        }
+
+        //! Measures load, updates the level and saves deferred stats while they are not deferred.
+        //! Stats, which failed to save, stay queued until next sample.
+        //! \param error error code that may happen during waiting.
+        void handle_sample(const boost::system::error_code& error)
+        {
+            if (error)
+                return;
+
+            std::uint64_t lag = metrics::micros(std::max(std::chrono::steady_clock::duration::zero(), std::chrono::steady_clock::now() - m_expected));
+            metrics::record(metrics::LOOP_LAG, lag);
+            m_lag += (lag - m_lag) * WEIGHT;
+
+            std::uint64_t queries = m_sql.queries(), query_time = m_sql.query_time();
+            if (queries > m_queries) // idle database decays towards zero
+                m_db_latency += (static_cast<double>(query_time - m_query_time) / (queries - m_queries) - m_db_latency) * WEIGHT;
+            else
+                m_db_latency -= m_db_latency * WEIGHT;
+            m_queries = queries;
+            m_query_time = query_time;
+
+            double pressure = 0;
+            if (m_lag_threshold > 0)
+                pressure = std::max(pressure, m_lag / m_lag_threshold);
+            if (m_db_threshold > 0)
+                pressure = std::max(pressure, m_db_latency / m_db_threshold);
+            if (m_queue_threshold > 0)
+                pressure = std::max(pressure, metrics::get(metrics::WRITE_QUEUE_BYTES) / m_queue_threshold);
+            set_level(pressure);
+
+            for (std::size_t i = 0; i < DRAIN_PER_SAMPLE && m_level < DEFER_STATS && !m_deferred.empty(); ++i)
+            {
+                try { m_sql.save_stats(m_deferred.front().first, m_deferred.front().second); }
+                catch (std::exception& e) // stats are kept and saving is retried by next sample
+                {
+                    std::cerr << "Failed to save deferred stats of player " << m_deferred.front().first << ": " << e.what() << std::endl;
+                    break;
+                }
+                m_deferred.pop_front();
+                metrics::add(metrics::DEFERRED_STATS, -1);
+            }
+            start_sample();
+        }
+
+        //! Moves to level corresponding to pressure. Level is raised immediately, but lowered only under hysteresis.
+        //! \param pressure highest ratio of measured load to its threshold.
+        void set_level(double pressure)
+        {
+            Levels level = static_cast<Levels>(std::min(static_cast<int>(pressure), MAX_LEVELS - 1));
+            if (level < m_level && pressure >= m_level * HYSTERESIS)
+                return;
+            if (level == m_level)
+                return;
+            std::cerr << "Overload level " << m_level << " -> " << level << " (loop lag " << static_cast<long long>(m_lag) << "us, db latency "
+                      << static_cast<long long>(m_db_latency) << "us, write queues " << metrics::get(metrics::WRITE_QUEUE_BYTES) << "B)." << std::endl;
+            metrics::increment(metrics::OVERLOAD_LEVEL_CHANGES);
+            metrics::add(metrics::OVERLOAD_LEVEL, static_cast<long long>(level) - m_level);
+            m_level = level;
+        }
+
+        boost::asio::deadline_timer m_timer; //!< Timer for sampling.
+        sql_connection& m_sql; //!< SQL database.
+        std::mt19937 m_random; //!< Random generator for retry-after jitter.
+        double m_lag_threshold; //!< Loop lag in microseconds, at which logins are shed, 0 ignores the lag.
+        double m_db_threshold; //!< Query latency in microseconds, at which logins are shed, 0 ignores the latency.
+        double m_queue_threshold; //!< Queued bytes, at which logins are shed, 0 ignores the queues.
+        long long m_retry_after; //!< Minimal milliseconds, after which rejected login may be repeated.
+        std::size_t m_max_deferred; //!< Cap of deferred stats, stats over the cap are saved immediately.
+        Levels m_level; //!< Current level.
+        double m_lag; //!< Moving average of loop lag in microseconds.
+        double m_db_latency; //!< Moving average of query latency in microseconds.
+        std::uint64_t m_queries; //!< \ref sql_connection::queries at last sample.
+        std::uint64_t m_query_time; //!< \ref sql_connection::query_time at last sample.
+        std::chrono::steady_clock::time_point m_expected; //!< Time, when the sample is expected.
+        std::deque<std::pair<int, stats::container_t>> m_deferred; //!< Stats waiting for saving.
+};
@@ -1,203 +1,111 @@
 #include <iostream>
+#include <algorithm>
 #include "player_data.hpp"
+#include "tracing.hpp"
 
 play_event player_data::play(Directions direction)
 {
+    TRACE_SPAN("engine_move");
     play_event pl_event;
+    bool won_before = m_board.won();
 
-    switch (direction)
+    if (m_board.play(direction, &pl_event))
     {
-    case LEFT:
-        for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
-        {
-            for (std::size_t x = 1; x < BLOCK_COUNT_X; ++x)
-            {
-                if (m_rects[x][y] == 0)
-                    continue;
-                std::size_t i = x;
-                while (i > 0 && m_rects[--i][y] == 0); // find closest block
-                if (can_merge(m_rects[x][y], m_rects[i][y]))
-                {
-                    merge_to(x, y, i, y);
-                    pl_event.merge_to(x, y, i, y);
-                    pl_event.score(pow2(m_rects[i][y]));
-                }
-                else if (m_rects[i][y] == 0 || m_rects[++i][y] == 0)
-                {
-                    move_to(x, y, i, y);
-                    pl_event.move_to(x, y, i, y);
-                }
-            }
-        }
-        break;
-    case RIGHT:
-        for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
-        {
-            for (int x = BLOCK_COUNT_X - 2; x >= 0; --x)
-            {
-                if (m_rects[x][y] == 0)
-                    continue;
-                std::size_t i = x;
-                while (i < BLOCK_COUNT_X - 1 && m_rects[++i][y] == 0);
-                if (can_merge(m_rects[x][y], m_rects[i][y]))
-                {
-                    merge_to(x, y, i, y);
-                    pl_event.merge_to(x, y, i, y);
-                    pl_event.score(pow2(m_rects[i][y]));
-                }
-                else if (m_rects[i][y] == 0 || m_rects[--i][y] == 0)
-                {
-                    move_to(x, y, i, y);
-                    pl_event.move_to(x, y, i, y);
-                }
-            }
-        }
-        break;
-    case UP:
-        for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
+        Blocks game_max = m_game_max;
+        for (const auto& oper : pl_event)
         {
-            for (std::size_t y = 1; y < BLOCK_COUNT_Y; ++y)
+            if (oper.first == play_event::MOVE)
             {
-                if (m_rects[x][y] == 0)
-                    continue;
-                std::size_t i = y;
-                while (i > 0 && m_rects[x][--i] == 0); // find closest block
-                if (can_merge(m_rects[x][y], m_rects[x][i]))
-                {
-                    merge_to(x, y, x, i);
-                    pl_event.merge_to(x, y, x, i);
-                    pl_event.score(pow2(m_rects[x][i]));
-                }
-                else if (m_rects[x][i] == 0 || m_rects[x][++i] == 0)
-                {
-                    move_to(x, y, x, i);
-                    pl_event.move_to(x, y, x, i);
-                }
+                m_stats.move();
+                continue;
             }
+            Blocks merged = m_board.rects()[oper.second.second.first][oper.second.second.second];
+            m_stats.merge();
+            m_stats.maximal_block(merged);
+            game_max = std::max(game_max, merged);
         }
-        break;
-    case DOWN:
-        for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
-        {
-            for (int y = BLOCK_COUNT_Y - 2; y >= 0; --y)
-            {
-                if (m_rects[x][y] == 0)
-                    continue;
-                std::size_t i = y;
-                while (i < BLOCK_COUNT_Y - 1 && m_rects[x][++i] == 0);
-                if (can_merge(m_rects[x][y], m_rects[x][i]))
-                {
-                    merge_to(x, y, x, i);
-                    pl_event.merge_to(x, y, x, i);
-                    pl_event.score(pow2(m_rects[x][i]));
-                }
-                else if (m_rects[x][i] == 0 || m_rects[x][--i] == 0)
-                {
-                    move_to(x, y, x, i);
-                    pl_event.move_to(x, y, x, i);
-                }
-            }
-        }
-        break;
-    }
+        while (m_game_max < game_max)
+            gameplay_stats::reached(++m_game_max);
 
-    if (pl_event.played())
-    {
-        pl_event.random_block(random_block());
-        
         int score_gained = pl_event.score();
-        m_score += score_gained;
 
         m_stats.play(direction);
         m_stats.score(score_gained);
-        m_stats.highest_score(m_score);
+        m_stats.highest_score(m_board.score());
+        gameplay_stats::increment(gameplay_stats::MOVES);
+        ++m_game_moves;
+        if (m_archive && m_recording)
+        {
+            m_record.add_move(direction);
+            m_record.duration = static_cast<std::uint32_t>(get_played().count());
+            if (get_won()) // fastest win is replayed from the first time stats::won counted
+            {
+                m_record.flags |= game_archive::WON;
+                if (!m_record.won_at)
+                    m_record.won_at = m_record.duration;
+            }
+        }
 
         if (get_won())
         {
             pl_event.won();
             m_stats.won(get_played());
+            if (!won_before)
+                gameplay_stats::finished(true, m_board.score(), get_played().count(), m_game_moves);
         }
-        else if (is_game_over())
+        else if (m_board.is_game_over())
         {
             pl_event.game_over();
             m_stats.game_over(get_played());
+            gameplay_stats::finished(false, m_board.score(), get_played().count(), m_game_moves);
         }
+        if (m_board.is_game_over()) // also won game, so idle time until restart is not archived
+            archive_game();
     }
 
     return std::move(pl_event);
 }
 
-random_block_record player_data::random_block()
-{
-    std::vector<coords> coord;
-    for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
-        for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
-            if (m_rects[x][y] == 0)
-                coord.emplace_back(x, y);    
-    std::random_shuffle(coord.begin(), coord.end());
-    Blocks block = chance(BLOCK_4_SPAWN_CHANCE) ? BLOCK_4 : BLOCK_2;
-
-    m_rects[coord[0].first][coord[0].second] = block;
-    return { block, coord[0] };
-}
-
 std::vector<random_block_record> player_data::restart()
 {
-    m_score = 0;
-    m_won = false;
-    m_rects = std::vector<std::vector<Blocks>>(BLOCK_COUNT_X, std::vector<Blocks>(BLOCK_COUNT_Y, BLOCK_0));
+    archive_game();
     m_stats.restart();
-    
-    m_game_start = std::chrono::system_clock::now();
-
-    std::vector<random_block_record> res;
-    for (std::size_t i = 0; i < DEFAULT_START_BLOCKS; ++i)
-        res.push_back(random_block());
-    return std::move(res);
-}
-
+    gameplay_stats::increment(gameplay_stats::GAMES_STARTED);
+    m_game_max = BLOCK_0;
+    m_game_moves = 0;
 
-bool player_data::is_game_over() const
-{
-    for (auto i = m_rects.begin(); i != m_rects.end(); ++i)
-        for (auto j = i->begin(); j != i->end(); ++j)
-            if ((*j) == 0)
-                return false;
-
-    // Board is full, looking for merge.
-    for (std::size_t x = 0; x < BLOCK_COUNT_X - 1; ++x)
-        for (std::size_t y = 0; y < BLOCK_COUNT_Y - 1; ++y)
-        {
-            if (can_merge(m_rects[x][y], m_rects[x][y + 1]))
-                return false;
-            if (can_merge(m_rects[x][y], m_rects[x + 1][y]))
-                return false;
-        }
-    for (std::size_t x = 0; x < BLOCK_COUNT_X - 1; ++x)
-        if (can_merge(m_rects[x][BLOCK_COUNT_Y - 1], m_rects[x + 1][BLOCK_COUNT_Y - 1]))
-            return false;
-    for (std::size_t y = 0; y < BLOCK_COUNT_Y - 1; ++y)
-        if (can_merge(m_rects[BLOCK_COUNT_X - 1][y], m_rects[BLOCK_COUNT_X - 1][y + 1]))
-            return false;
-
-    return true;
+    m_game_start = std::chrono::system_clock::now();
+    start_record(false);
+    return m_board.restart();
 }
 
-
-void player_data::move_to(int from_x, int from_y, int to_x, int to_y)
+void player_data::archive_game()
 {
-    m_rects[to_x][to_y] = m_rects[from_x][from_y];
-    m_rects[from_x][from_y] = BLOCK_0;
-    
-    m_stats.move();
+    // game started by restart is archived even without moves, so restarts are counted by the analyzer as in stats
+    if (!m_archive || !m_id || !m_recording || (!m_record.moves && (m_record.flags & game_archive::RESUMED)))
+        return;
+    std::uint64_t now = static_cast<std::uint64_t>(std::time(nullptr));
+    m_record.player = m_id;
+    m_record.final_score = m_board.score();
+    m_record.max_block = m_board.max_block();
+    if (m_board.is_game_over())
+        m_record.flags |= game_archive::LOST;
+    m_archive->write(m_record, now);
+    m_recording = false;
 }
 
-void player_data::merge_to(int from_x, int from_y, int to_x, int to_y)
+void player_data::start_record(bool resumed)
 {
-    m_rects[from_x][from_y] = BLOCK_0;
-    if (++m_rects[to_x][to_y] == WINNING_BLOCK)
-        m_won = true;
-
-    m_stats.merge();
-    m_stats.maximal_block(m_rects[to_x][to_y]);
+    m_record = game_archive::record();
+    m_recording = true;
+    m_record.seed = m_random();
+    m_record.start = static_cast<std::uint64_t>(std::chrono::system_clock::to_time_t(m_game_start));
+    m_board.seed(m_record.seed);
+    if (!resumed)
+        return;
+    m_record.flags = game_archive::RESUMED | (m_board.won() ? game_archive::START_WON : 0);
+    for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
+        for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
+            m_record.start_blocks[x * BLOCK_COUNT_Y + y] = static_cast<std::uint8_t>(m_board.rects()[x][y]);
+    m_record.start_score = m_board.score();
 }
@@ -3,43 +3,63 @@
 #include <vector>
 #include <chrono>
 #include <tuple>
+#include <random>
+#include <cstdint>
+#include <ctime>
+#include <memory>
 #include "../../Common/main.hpp"
 #include "../../Common/play_event.hpp"
+#include "../../Common/board.hpp"
+#include "../../Common/game_archive.hpp"
 #include "stats.hpp"
+#include "gameplay_stats.hpp"
 
 /**!
     \ingroup server
     \brief Class used to store player's data used in the game.
-    \sa session
+
+    Each game gets its own seed drawn from generator of the session, so it can be archived as the seed
+    and its moves. Games are written into the archive, when they are lost, restarted, replaced
+    by data from database or by reseeding, or when the player leaves.
+    \sa session, game_archive
 */
 class player_data
 {
     public:
         //! Default constructor for constructing not logged session.
-        player_data() : m_id(0), m_rects(std::vector<std::vector<Blocks>>(BLOCK_COUNT_X, std::vector<Blocks>(BLOCK_COUNT_Y, BLOCK_0))) { }
+        //! Random generator is seeded randomly, see \ref set_seed.
+        player_data() : m_id(0), m_loaded(false), m_recording(false), m_game_max(BLOCK_0), m_game_moves(0)
+        {
+            set_seed(std::random_device()());
+        }
 
         //! Loads data by \ref data_tuple
         //! \param data data to be loaded into this class.
         //! \sa data_tuple
         void load_data(const data_tuple& data)
         {
+            archive_game();
             auto vec = split(std::get<0>(data), '|');
             for (std::size_t i = 0; i < vec.size(); ++i)
-                m_rects[i / BLOCK_COUNT_X][i % BLOCK_COUNT_Y] = static_cast<Blocks>(std::stoi(vec[i]));
+                m_board.set(i / BLOCK_COUNT_X, i % BLOCK_COUNT_Y, static_cast<Blocks>(std::stoi(vec[i])));
+            m_game_max = m_board.max_block();
+            m_game_moves = 0;
 
-            m_won = std::get<1>(data);
-            m_score = std::get<2>(data);
+            m_board.set_won(std::get<1>(data));
+            m_board.set_score(std::get<2>(data));
             m_global_stats = std::move(*std::get<3>(data));
+            m_loaded = true;
             m_game_start = std::chrono::system_clock::now();
             m_session_start = m_game_start;
+            start_record(true);
         }
         
-        //! Serializes \ref m_rects into string.
-        //! \return serialized \ref m_rects
+        //! Serializes blocks of \ref m_board into string.
+        //! \return serialized blocks
         std::string serialize_rects() const
         {
             std::string res = "";
-            for (const auto& row : m_rects)
+            for (const auto& row : m_board.rects())
                 for (const auto& val : row)
                     res += std::to_string(val) + "|";
 
@@ -54,6 +74,10 @@ class player_data
         //! \param id new player id
         void set_id(int id) { m_id = id; }
 
+        //! Getter for \ref m_loaded.
+        //! \return true if data and global stats were loaded from database.
+        bool is_loaded() const { return m_loaded; }
+
         //! Getter for \ref m_name.
         //! \return name of the player
         const std::string& get_name() const { return m_name; }
@@ -61,19 +85,40 @@ class player_data
         //! \param name new player name
         void set_name(const std::string& name) { m_name = name; }
 
-        //! Getter for \ref m_won.
+        //! Getter for won status of \ref m_board.
         //! \return won status of the player
-        bool get_won() const { return m_won; }
-        //! Setter for \ref m_won.
+        bool get_won() const { return m_board.won(); }
+        //! Setter for won status of \ref m_board.
         //! \param won new player won status
-        void set_won(bool won) { m_won = won; }
+        void set_won(bool won) { m_board.set_won(won); }
 
-        //! Getter for \ref m_score.
+        //! Getter for score of \ref m_board.
         //! \return score of the player
-        int get_score() const { return m_score; }
-        //! Setter for \ref m_score.
+        int get_score() const { return m_board.score(); }
+        //! Setter for score of \ref m_board.
         //! \param score new player score
-        void set_score(int score) { m_score = score; }
+        void set_score(int score) { m_board.set_score(score); }
+
+        //! Getter for \ref m_seed.
+        //! \return last seed of random generator of the player.
+        std::uint32_t get_seed() const { return m_seed; }
+        //! Reseeds random generator of the session, so the following games are reproducible.
+        //! Current game continues with the blocks spawned from the new seed.
+        //! \param seed new seed.
+        void set_seed(std::uint32_t seed)
+        {
+            m_seed = seed;
+            m_random.seed(seed);
+            archive_game();
+            start_record(true);
+        }
+
+        //! Sets archive, into which games are written.
+        //! \param archive the archive, nullptr disables archiving.
+        void set_archive(std::shared_ptr<archive_writer> archive) { m_archive = std::move(archive); }
+
+        //! Writes current game into the archive, if it has any move or was started by restart. Following moves are not recorded until next game starts.
+        void archive_game();
 
         //! Gets duration of current game.
         //! \return chrono seconds duration since last restart.
@@ -109,44 +154,28 @@ class player_data
         //! \sa stats::get_impl
         const stats::container_t& get_stats_impl() const { return m_stats.get_impl(); }
 
+        //! Gets inner implementation of global stats container loaded from database.
+        //! \return inner implementation of global stats container.
+        const stats::container_t& get_global_stats_impl() const { return m_global_stats.get_impl(); }
+
     private:
-        //! Checks whether player's turned caused Game Over.
-        //! \return True if no other move can be performed, false otherwise.
-        bool is_game_over() const;
-
-        //! Checks whether two \ref Blocks can be merged together.
-        //! Two \ref Blocks can be merged together if they are of the same value.
-        //! \param r1 First Block to check
-        //! \param r2 Block to check against.
-        //! \return True if possible, false otherwise.
-        bool can_merge(Blocks r1, Blocks r2) const { return r1 == r2; }
-
-        //! Handles moving of block by coords.
-        //! \param from_x x coord of Block on field.
-        //! \param from_y y coord of Block on field.
-        //! \param to_x x coord where to move.
-        //! \param to_y y coord where to move.
-        void move_to(int from_x, int from_y, int to_x, int to_y);
-
-        //! Handles merging of blocks by coords.
-        //! \param from_x x coord of Block on field.
-        //! \param from_y y coord of Block on field.
-        //! \param to_x x coord of Block to merge with.
-        //! \param to_y y coord of Block to merge with.
-        void merge_to(int from_x, int from_y, int to_x, int to_y);
-
-        //! Inserts random block on board.
-        //! \return Pair of \ref Blocks (to be spawned) and coords (where to be spawned).
-        //! \sa Blocks, Game::spawn_block()
-        random_block_record random_block();
+        //! Starts recording of new game, draws its seed from \ref m_random and reseeds \ref m_board with it.
+        //! \param resumed true if the game starts from current position of \ref m_board, false if the board is going to be restarted.
+        void start_record(bool resumed);
 
         int m_id; //!< Player's id.
         std::string m_name; //!< Player's username.
-        std::vector<std::vector<Blocks>> m_rects; //!< Player's board state.
-        bool m_won; //!< Indicates whehter player did won the game.
-        int m_score; //!< Score of the player.
+        bool m_loaded; //!< Indicates, that \ref load_data was called.
+        board m_board; //!< Player's board, score and won status.
         stats m_stats; //!< Stats of current session.
         stats m_global_stats; //!< Global stats for the player.
+        std::uint32_t m_seed; //!< Last seed of \ref m_random.
+        std::mt19937 m_random; //!< Random generator of seeds of games.
+        std::shared_ptr<archive_writer> m_archive; //!< Archive of games, nullptr if disabled.
+        game_archive::record m_record; //!< Recording of current game.
+        bool m_recording; //!< Indicates, that current game was not archived yet.
         std::chrono::system_clock::time_point m_game_start; //!< Time point of game start.
         std::chrono::system_clock::time_point m_session_start; //!< Time point of session start.
+        Blocks m_game_max; //!< Maximal block reached in current game.
+        std::uint64_t m_game_moves; //!< Moves of current game, since last restart or load.
 };
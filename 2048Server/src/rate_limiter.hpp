@@ -0,0 +1,250 @@
+#pragma once
+#include <map>
+#include <array>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <boost/asio.hpp>
+#include "../../Common/main.hpp"
+#include "config.hpp"
+#include "metrics.hpp"
+
+/**!
+    \ingroup server
+    \brief Token bucket allowing \a rate events per second with bursts up to \a burst events.
+*/
+class token_bucket
+{
+    public:
+        using clock = std::chrono::steady_clock; //!< Clock used for refilling.
+
+        //! Constructs full bucket.
+        //! \param rate tokens added per second, 0 makes the bucket unlimited.
+        //! \param burst capacity of the bucket, at least 1 if the bucket is limited.
+        explicit token_bucket(double rate = 0, double burst = 0) :
+            m_rate(rate), m_burst(std::max(burst, 1.0)), m_tokens(m_burst), m_last(clock::now()) { }
+
+        //! Checks, whether a token is available, without taking it.
+        //! \param now current time.
+        //! \return 0 if the token is available, otherwise microseconds until next token is available.
+        std::uint64_t wait(clock::time_point now)
+        {
+            if (m_rate <= 0)
+                return 0;
+            refill(now);
+            if (m_tokens >= 1)
+                return 0;
+            return static_cast<std::uint64_t>((1 - m_tokens) / m_rate * 1e6) + 1;
+        }
+
+        //! Takes one token if available.
+        //! \param now current time.
+        //! \return 0 if the token was taken, otherwise microseconds until next token is available.
+        std::uint64_t consume(clock::time_point now)
+        {
+            if (std::uint64_t res = wait(now))
+                return res;
+            if (m_rate > 0)
+                m_tokens -= 1;
+            return 0;
+        }
+
+        //! Checks, whether the bucket refilled completely, so it can be replaced by new one without changing behavior.
+        //! \param now current time.
+        //! \return true if the bucket is full or unlimited, false otherwise.
+        bool full(clock::time_point now)
+        {
+            if (m_rate <= 0)
+                return true;
+            refill(now);
+            return m_tokens >= m_burst;
+        }
+
+    private:
+        //! Adds tokens for time elapsed since last refill.
+        //! \param now current time.
+        void refill(clock::time_point now)
+        {
+            if (now <= m_last)
+                return;
+            m_tokens = std::min(m_burst, m_tokens + std::chrono::duration<double>(now - m_last).count() * m_rate);
+            m_last = now;
+        }
+
+        double m_rate; //!< Tokens added per second.
+        double m_burst; //!< Capacity of the bucket.
+        double m_tokens; //!< Tokens currently available.
+        clock::time_point m_last; //!< Time of last refill.
+};
+
+/**!
+    \ingroup server
+    \brief Rate limits of messages per session and per source address.
+
+    Each session has its own bucket for every \ref MessageClasses, all sessions from the same address
+    additionally share buckets for logins and for all messages, so reconnecting does not bypass the limits.
+    Limits are read from the configuration as <em>rate_&lt;class&gt;</em> (messages per second) and
+    <em>burst_&lt;class&gt;</em>, rate 0 disables the limit.
+    \sa session
+*/
+class rate_limiter
+{
+    public:
+        //! Classes of messages limited separately.
+        enum MessageClasses
+        {
+            LOGIN = 0, //!< \ref message_types::MSG_LOGIN and \ref message_types::MSG_RESUME, which query the database.
+            GAME, //!< \ref message_types::MSG_PLAY and \ref message_types::MSG_RESTART.
+            OTHER, //!< All other messages.
+
+            MAX_MESSAGE_CLASSES,
+        };
+
+        //! Buckets of single session.
+        using session_buckets = std::array<token_bucket, MAX_MESSAGE_CLASSES>;
+
+        //! Buckets shared by sessions from single address.
+        struct address_buckets
+        {
+            token_bucket login; //!< Logins from the address.
+            token_bucket messages; //!< All messages from the address.
+        };
+
+        //! Shared buckets of an address, kept alive by its sessions and by the limiter until they refill.
+        using address_ptr = std::shared_ptr<address_buckets>;
+
+        //! Loads limits from configuration.
+        //! \param conf server configuration.
+        explicit rate_limiter(const config& conf) :
+            m_ip_login(conf, "ip_login", 5, 20), m_ip_messages(conf, "ip_messages", 0, 0),
+            m_throttle_disconnect(static_cast<std::size_t>(std::max(0LL, conf.get_int("throttle_disconnect", 50)))), m_swept_size(0)
+        {
+            m_limits[LOGIN] = limit(conf, "login", 1, 5);
+            m_limits[GAME] = limit(conf, "game", 50, 100);
+            m_limits[OTHER] = limit(conf, "other", 10, 20);
+        }
+
+        //! Destructor, which removes tracked addresses from metrics.
+        ~rate_limiter() { metrics::add(metrics::RATE_LIMITER_ADDRESSES, -static_cast<long long>(m_addresses.size())); }
+
+        //! Classifies message by its type.
+        //! \param data body of the message.
+        //! \return class of the message.
+        static MessageClasses classify(const std::string& data)
+        {
+            if (compare_msg(data, message_types::MSG_PLAY) || compare_msg(data, message_types::MSG_RESTART))
+                return GAME;
+            if (compare_msg(data, message_types::MSG_LOGIN) || compare_msg(data, message_types::MSG_RESUME))
+                return LOGIN;
+            return OTHER;
+        }
+
+        //! Creates full buckets for new session.
+        //! \return buckets of the session.
+        session_buckets make_session_buckets() const
+        {
+            session_buckets res;
+            for (int i = 0; i < MAX_MESSAGE_CLASSES; ++i)
+                res[i] = token_bucket(m_limits[i].rate, m_limits[i].burst);
+            return res;
+        }
+
+        //! Gets buckets shared by sessions from given address.
+        //! \param addr remote address of the session.
+        //! \return buckets of the address.
+        address_ptr get_address(const boost::asio::ip::address& addr)
+        {
+            address_ptr& res = m_addresses[addr];
+            if (!res)
+            {
+                metrics::add(metrics::RATE_LIMITER_ADDRESSES, 1);
+                res = std::make_shared<address_buckets>();
+                res->login = token_bucket(m_ip_login.rate, m_ip_login.burst);
+                res->messages = token_bucket(m_ip_messages.rate, m_ip_messages.burst);
+            }
+            address_ptr keep = res;
+            if (m_addresses.size() >= 2 * m_swept_size + 64)
+                sweep();
+            return keep;
+        }
+
+        //! Takes tokens for single message from buckets of its session and address. Tokens are taken only
+        //! if all the buckets have one, so throttled message does not drain the others.
+        //! \param buckets buckets of the session.
+        //! \param address buckets of the session's address, may be nullptr.
+        //! \param cls class of the message.
+        //! \param now current time.
+        //! \return 0 if the message is allowed, otherwise microseconds after which it may be retried.
+        static std::uint64_t consume(session_buckets& buckets, address_buckets* address, MessageClasses cls, token_bucket::clock::time_point now)
+        {
+            std::uint64_t wait = buckets[cls].wait(now);
+            if (address)
+            {
+                if (cls == LOGIN)
+                    wait = std::max(wait, address->login.wait(now));
+                wait = std::max(wait, address->messages.wait(now));
+            }
+            if (wait)
+                return wait;
+            buckets[cls].consume(now);
+            if (address)
+            {
+                if (cls == LOGIN)
+                    address->login.consume(now);
+                address->messages.consume(now);
+            }
+            return 0;
+        }
+
+        //! Gets number of consecutive throttled messages, after which session is closed.
+        //! \return the number, 0 if throttled sessions are never closed.
+        std::size_t throttle_disconnect() const { return m_throttle_disconnect; }
+
+        //! Gets number of tracked addresses.
+        //! \return number of addresses.
+        std::size_t size() const { return m_addresses.size(); }
+
+    private:
+        //! Configured limit.
+        struct limit
+        {
+            limit() : rate(0), burst(0) { }
+
+            //! Reads limit from configuration.
+            //! \param conf server configuration.
+            //! \param name suffix of <em>rate_</em> and <em>burst_</em> keys.
+            //! \param def_rate default rate.
+            //! \param def_burst default burst.
+            limit(const config& conf, const std::string& name, double def_rate, double def_burst) :
+                rate(std::max(0.0, conf.get_double("rate_" + name, def_rate))), burst(conf.get_double("burst_" + name, def_burst)) { }
+
+            double rate; //!< Messages per second, 0 for unlimited.
+            double burst; //!< Capacity of the bucket.
+        };
+
+        //! Forgets addresses without sessions, whose buckets refilled, since they would be recreated the same.
+        void sweep()
+        {
+            auto now = token_bucket::clock::now();
+            for (auto it = m_addresses.begin(); it != m_addresses.end();)
+            {
+                if (it->second.use_count() == 1 && it->second->login.full(now) && it->second->messages.full(now))
+                {
+                    metrics::add(metrics::RATE_LIMITER_ADDRESSES, -1);
+                    it = m_addresses.erase(it);
+                }
+                else
+                    ++it;
+            }
+            m_swept_size = m_addresses.size();
+        }
+
+        std::array<limit, MAX_MESSAGE_CLASSES> m_limits; //!< Limits of single session.
+        limit m_ip_login; //!< Limit of logins from single address.
+        limit m_ip_messages; //!< Limit of all messages from single address.
+        std::size_t m_throttle_disconnect; //!< Consecutive throttled messages, after which session is closed, 0 never.
+        std::map<boost::asio::ip::address, address_ptr> m_addresses; //!< Buckets of addresses.
+        std::size_t m_swept_size; //!< Number of addresses after last sweep.
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <string>
+#include <random>
+#include <cstdio>
+#include <cstdint>
+#include <unordered_map>
+#include "timer_wheel.hpp"
+
+/**!
+    \ingroup server
+    \brief Tokens, by which client resumes session of a logged player after its connection dropped.
+
+    Token is issued after login by \ref message_types::MSG_TOKEN and is valid while its session is online
+    and for <em>resume_timeout</em> seconds after the session left. Each token can be used once, resumed session gets a new one.
+    Expired tokens are forgotten, when new ones are issued and the number of tokens doubled since last cleanup,
+    so cleanup is amortized over issued tokens.
+    \sa session::handle_message
+*/
+class resume_tokens
+{
+    public:
+        static const std::uint64_t ONLINE = UINT64_MAX; //!< Expiration of tokens, whose session is online.
+
+        //! Player, whose session can be resumed.
+        struct entry
+        {
+            int id; //!< Id of the player.
+            std::string name; //!< Name of the player.
+            std::uint64_t expires; //!< Tick of \ref timer_wheel, after which the token is not valid, \ref ONLINE while its session is online.
+        };
+
+        //! Constructs empty store.
+        //! \param timers timer wheel, whose ticks measure validity.
+        //! \param timeout ticks, for which token is valid after its session left.
+        resume_tokens(const timer_wheel& timers, std::uint64_t timeout) : m_timers(timers), m_timeout(timeout), m_cleaned(0) { }
+
+        //! Issues token for a player, whose session is online.
+        //! \param id id of the player.
+        //! \param name name of the player.
+        //! \return token, 32 hexadecimal digits.
+        std::string issue(int id, const std::string& name)
+        {
+            std::uint64_t now = m_timers.now();
+            if (m_tokens.size() >= 2 * m_cleaned + 16)
+            {
+                for (auto it = m_tokens.begin(); it != m_tokens.end();)
+                    it = it->second.expires < now ? m_tokens.erase(it) : std::next(it);
+                m_cleaned = m_tokens.size();
+            }
+
+            char token[33];
+            std::snprintf(token, sizeof(token), "%016llx%016llx", random64(), random64());
+            m_tokens[token] = entry{ id, name, ONLINE };
+            return token;
+        }
+
+        //! Starts expiration of token, because its session left.
+        //! \param token the token, nothing happens if it is not known.
+        void release(const std::string& token)
+        {
+            auto it = m_tokens.find(token);
+            if (it != m_tokens.end())
+                it->second.expires = m_timers.now() + m_timeout;
+        }
+
+        //! Forgets token, e.g. when its session got a new one.
+        //! \param token the token.
+        void revoke(const std::string& token) { m_tokens.erase(token); }
+
+        //! Takes valid token, so it cannot be used again.
+        //! \param token the token.
+        //! \param res player, whose session can be resumed.
+        //! \return true if the token was valid, false otherwise.
+        bool take(const std::string& token, entry& res)
+        {
+            auto it = m_tokens.find(token);
+            if (it == m_tokens.end())
+                return false;
+            bool valid = it->second.expires >= m_timers.now();
+            res = std::move(it->second);
+            m_tokens.erase(it);
+            return valid;
+        }
+
+    private:
+        //! Draws 64 bits from \ref m_random. Tokens work as passwords, so they are not generated by a seeded generator,
+        //! whose following outputs could be predicted from an observed token.
+        //! \return the bits.
+        unsigned long long random64()
+        {
+            unsigned long long res = 0;
+            for (int i = 0; i < 64; i += 32)
+                res = (res << 32) | static_cast<std::uint32_t>(m_random());
+            return res;
+        }
+
+        const timer_wheel& m_timers; //!< Timer wheel, whose ticks measure validity.
+        std::uint64_t m_timeout; //!< Ticks, for which token is valid after its session left.
+        std::size_t m_cleaned; //!< Number of tokens after last cleanup.
+        std::random_device m_random; //!< Source of tokens, nondeterministic on supported platforms.
+        std::unordered_map<std::string, entry> m_tokens; //!< Valid tokens, and expired ones until next cleanup.
+};
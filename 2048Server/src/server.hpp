@@ -1,11 +1,25 @@
 #pragma once
 #include <fstream>
 #include <regex>
+#include <memory>
 #include <boost/asio.hpp>
 #include <boost/shared_ptr.hpp>
 #include "session_container.hpp"
 #include "session.hpp"
 #include "sql_connection.hpp"
+#include "config.hpp"
+#include "session_context.hpp"
+#include "timer_wheel.hpp"
+#include "rate_limiter.hpp"
+#include "overload_monitor.hpp"
+#include "leaderboard.hpp"
+#include "stats_cache.hpp"
+#include "stats_http.hpp"
+#include "resume_tokens.hpp"
+#include "metrics.hpp"
+#include "gameplay_stats.hpp"
+#include "tracing.hpp"
+#include "../../Common/capture_file.hpp"
 using boost::asio::ip::tcp;
 
 /**!
@@ -19,16 +33,46 @@ class server
         //! \param io_service reference to boost io_service
         //! \param endpoint endpoint clients connect to.
         //! \param sql \ref sql_connection representing database.
-        server(boost::asio::io_service& io_service, const tcp::endpoint& endpoint, sql_connection&& sql) :
-            m_io_service(io_service), m_acceptor(io_service, endpoint), m_sql(std::move(sql))
+        //! \param conf server configuration.
+        server(boost::asio::io_service& io_service, const tcp::endpoint& endpoint, sql_connection&& sql, const config& conf) :
+            m_io_service(io_service), m_acceptor(io_service, endpoint), m_sql(std::move(sql)), m_timers(io_service, std::chrono::milliseconds(100)), m_limiter(conf), m_overload(io_service, m_sql, conf), m_leaderboard(io_service, m_sql, conf),
+            m_tokens(m_timers, m_timers.to_ticks(std::chrono::seconds(std::max(1LL, conf.get_int("resume_timeout", 300))))),
+            m_context{ m_sessions, m_sql, m_timers, m_limiter, m_overload, m_leaderboard, m_tokens, nullptr, nullptr, nullptr, conf.get_int("allow_seed", 0) != 0,
+                m_timers.to_ticks(std::chrono::seconds(conf.get_int("idle_timeout", 4 * SECONDS_BETWEEN_HEARTBEATS))),
+                m_timers.to_ticks(std::chrono::seconds(conf.get_int("read_timeout", SECONDS_UNTIL_TIMEOUT))),
+                static_cast<std::size_t>(conf.get_int("write_queue_bytes", 64 * 1024)), static_cast<std::size_t>(conf.get_int("write_queue_messages", 256)),
+                m_timers.to_ticks(std::chrono::seconds(conf.get_int("write_queue_timeout", 30))),
+                static_cast<std::size_t>(std::max(2LL, conf.get_int("spectator_lag_messages", 32))) },
+            m_dump_timer(io_service), m_metrics_file(conf.get("metrics_file")), m_trace_file(conf.get("trace_file")),
+            m_dump_interval(conf.get_int("metrics_interval", 10)), m_last_session_id(0)
         {
+            if (!conf.get("capture_file").empty())
+                m_context.capture.reset(new capture_writer(conf.get("capture_file")));
+            if (!conf.get("archive_dir").empty())
+                m_context.archive.reset(new archive_writer(conf.get("archive_dir"), std::max(1LL, conf.get_int("archive_segment_mb", 64)) * 1024 * 1024));
+            if (long long port = conf.get_int("stats_port", 0))
+            {
+                m_context.stats.reset(new stats_cache(m_sql, m_leaderboard));
+                tcp::endpoint stats_endpoint(boost::asio::ip::address::from_string(conf.get("stats_address", "127.0.0.1")), static_cast<unsigned short>(port));
+                m_stats_http.reset(new stats_http(io_service, stats_endpoint, *m_context.stats, m_overload, m_timers));
+            }
+            long long idle_timeout = conf.get_int("idle_timeout", 4 * SECONDS_BETWEEN_HEARTBEATS);
+            if (idle_timeout > 0 && idle_timeout <= static_cast<long long>(SECONDS_BETWEEN_HEARTBEATS))
+                std::cerr << "Warning: 'idle_timeout' is not longer than heartbeat interval of clients (" << SECONDS_BETWEEN_HEARTBEATS << "s)." << std::endl;
+            tracing::configure(conf.get_int("slow_request_ms", 0) * 1000, conf.get("slow_request_log", "slow_requests.log"));
+            if (!tracing::enabled() && (!m_trace_file.empty() || conf.get_int("slow_request_ms", 0)))
+                std::cerr << "Tracing is not compiled in, 'trace_file' and 'slow_request_ms' are ignored." << std::endl;
+
             start_accept();
+            sample_gameplay();
+            if (!m_metrics_file.empty() || (tracing::enabled() && !m_trace_file.empty()) || m_context.capture || m_context.archive)
+                start_dump();
         }
 
         //! Starts accepting one incomming request
         void start_accept()
         {
-            boost::shared_ptr<session> new_session(new session(m_io_service, m_sessions, m_sql));
+            boost::shared_ptr<session> new_session(new session(m_io_service, m_context, ++m_last_session_id));
             m_acceptor.async_accept(new_session->socket(), boost::bind(&server::handle_accept, this, new_session, boost::asio::placeholders::error));
         }
 
@@ -38,14 +82,61 @@ class server
         void handle_accept(boost::shared_ptr<session> session, const boost::system::error_code& error)
         {
             if (!error)
+            {
+                TRACE_SPAN("accept");
                 session->start();
+            }
 
             start_accept();
         }
 
+        //! Samples \ref gameplay_stats for their windowed rates and schedules next sample after a second.
+        void sample_gameplay()
+        {
+            gameplay_stats::sample();
+            m_timers.schedule(m_timers.to_ticks(std::chrono::seconds(1)), boost::bind(&server::sample_gameplay, this));
+        }
+
+        //! Schedules next dump of \ref metrics into \ref m_metrics_file and tracing spans into \ref m_trace_file
+        //! and flush of traffic capture and game archive.
+        void start_dump()
+        {
+            m_dump_timer.expires_from_now(boost::posix_time::seconds(m_dump_interval));
+            m_dump_timer.async_wait(boost::bind(&server::handle_dump, this, boost::asio::placeholders::error));
+        }
+
+        //! Dumps \ref metrics and tracing spans, flushes captured traffic and archived games and schedules next dump.
+        //! \param error error code that may happen during waiting.
+        void handle_dump(const boost::system::error_code& error)
+        {
+            if (error)
+                return;
+            if (!m_metrics_file.empty() && !metrics::dump(m_metrics_file))
+                std::cerr << "Failed to write metrics to '" << m_metrics_file << "'." << std::endl;
+            if (tracing::enabled() && !m_trace_file.empty() && !tracing::export_chrome(m_trace_file))
+                std::cerr << "Failed to write trace to '" << m_trace_file << "'." << std::endl;
+            if (m_context.capture)
+                m_context.capture->flush();
+            if (m_context.archive)
+                m_context.archive->flush();
+            start_dump();
+        }
+
     private:
         boost::asio::io_service& m_io_service; //!< Reference to boost io_service.
         tcp::acceptor m_acceptor; //!< TCP acceptor accepting incomming connections.
         session_container m_sessions; //!< Session container for managing sessions.
         sql_connection m_sql; //!< SQL database. \sa sql_connection
+        timer_wheel m_timers; //!< Timers of session timeouts.
+        rate_limiter m_limiter; //!< Rate limits of messages.
+        overload_monitor m_overload; //!< Load shedding.
+        leaderboard m_leaderboard; //!< Global leaderboard.
+        resume_tokens m_tokens; //!< Tokens for resuming sessions.
+        session_context m_context; //!< Services and settings shared by sessions.
+        std::unique_ptr<stats_http> m_stats_http; //!< Stats HTTP endpoint, nullptr if disabled.
+        boost::asio::deadline_timer m_dump_timer; //!< Timer for periodic metrics and trace dump.
+        std::string m_metrics_file; //!< File, where metrics are dumped. Empty disables dumping.
+        std::string m_trace_file; //!< File, where tracing spans are exported. Empty disables exporting.
+        long long m_dump_interval; //!< Seconds between dumps.
+        std::uint64_t m_last_session_id; //!< Id of last created session.
 };
\ No newline at end of file
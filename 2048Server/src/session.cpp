@@ -5,6 +5,7 @@
 #include <iomanip>
 #include "../../Common/main.hpp"
 #include "../../Common/play_event.hpp"
+#include "../../Common/hasher.hpp"
 
 void session::handle_message(const message& mes)
 {
@@ -18,8 +19,18 @@ void session::handle_message(const message& mes)
 #endif
 
     std::string data(mes.body(), mes.body_length());
+    if (throttle(data))
+        return;
     if (compare_msg(data, message_types::MSG_LOGIN))
     {
+        metrics::scoped_timer timer(metrics::LAT_LOGIN);
+        metrics::increment(metrics::MSG_LOGIN);
+        if (m_context.overload.shed_login())
+        {
+            deliver(make_message(message_types::MSG_THROTTLE + std::to_string(m_context.overload.retry_after())));
+            std::cout << "Login rejected, server is overloaded" << std::endl;
+            return;
+        }
         std::size_t br = data.find("+");
         std::string user = data.substr(message_types::MSG_LOGIN.length(), br - message_types::MSG_LOGIN.length());
         std::string pass = data.substr(br + 1);
@@ -27,26 +38,32 @@ void session::handle_message(const message& mes)
         {
             m_data.set_id(id);
             m_data.set_name(user);
-            deliver(message(message_types::MSG_LOGIN_OK));
+            m_sessions.identify(user, shared_from_this());
+            deliver(make_message(message_types::MSG_LOGIN_OK));
             std::cout << user << ": LoginOK" << std::endl;
         }
         else
         {
-            deliver(message(message_types::MSG_LOGIN_FAIL));
+            deliver(make_message(message_types::MSG_LOGIN_FAIL));
             std::cout << user << ": LoginFail" << std::endl;
         }
     }
     else if (compare_msg(data, message_types::MSG_DATA_REQ))
     {
+        metrics::scoped_timer timer(metrics::LAT_DATA);
+        metrics::increment(metrics::MSG_DATA);
         try
         {
             data_tuple data = m_sql.get_data(m_data.get_id());
             m_data.load_data(data);
-            deliver(message(message_types::MSG_DATA_SEND + "+" +
+            update_leaderboard(m_data.get_global_stats_impl());
+            deliver(make_message(message_types::MSG_DATA_SEND + "+" +
                 std::get<0>(data) + "+" +
                 (std::get<1>(data) ? "1" : "0") + "+" +
                 std::to_string(std::get<2>(data))
             ));
+            if (!m_spectators.empty())
+                notify_spectators(spectator_snapshot());
         }
         catch (invalid_message&)
         {
@@ -55,6 +72,8 @@ void session::handle_message(const message& mes)
     }
     else if (compare_msg(data, message_types::MSG_PLAY))
     {
+        metrics::scoped_timer timer(metrics::LAT_PLAY);
+        metrics::increment(metrics::MSG_PLAY);
         std::string direction = data.substr(message_types::MSG_PLAY.length());
         std::cout << m_data.get_name() << ": Play " << direction << std::endl;
 
@@ -68,10 +87,17 @@ void session::handle_message(const message& mes)
         else if (direction == directions::DOWN)
             pl_event = m_data.play(Directions::DOWN);
 
-        deliver(message(message_types::MSG_PLAY_OK + "+" + pl_event.serialize()));
+        if (pl_event.played())
+            update_leaderboard(m_data.get_stats_impl());
+        std::string event = pl_event.serialize();
+        deliver(make_message(message_types::MSG_PLAY_OK + "+" + event));
+        if (pl_event.played() && !m_spectators.empty())
+            notify_spectators(make_message(message_types::MSG_SPECTATE_EVENT + event));
     }
     else if (compare_msg(data, message_types::MSG_RESTART))
     {
+        metrics::scoped_timer timer(metrics::LAT_RESTART);
+        metrics::increment(metrics::MSG_RESTART);
         std::cout << m_data.get_name() << ": Restart" << std::endl;
 
         auto vec = m_data.restart();
@@ -79,8 +105,193 @@ void session::handle_message(const message& mes)
         for (const auto& item : vec)
             res += std::to_string(item.first) + " " + std::to_string(item.second.first) + " " + std::to_string(item.second.second) + " ";
         res.pop_back();
-        deliver(message(std::move(res)));
+        deliver(make_message(std::move(res)));
+        if (!m_spectators.empty())
+            notify_spectators(spectator_snapshot());
+    }
+    else if (compare_msg(data, message_types::MSG_SEED))
+    {
+        metrics::increment(metrics::MSG_SEED);
+        if (!m_context.allow_seed)
+        {
+            deliver(make_message(message_types::MSG_SEED_FAIL));
+            return;
+        }
+        try
+        {
+            m_data.set_seed(static_cast<std::uint32_t>(std::stoul(data.substr(message_types::MSG_SEED.length()))));
+        }
+        catch (std::logic_error&)
+        {
+            metrics::increment(metrics::MSG_INVALID);
+            throw invalid_message("Client sent invalid seed.");
+        }
+        capture(capture_file::SEED);
+        std::cout << m_data.get_name() << ": Seed " << m_data.get_seed() << std::endl;
+        deliver(make_message(message_types::MSG_SEED_OK));
+    }
+    else if (compare_msg(data, message_types::MSG_HEARTBEAT))
+    {
+        metrics::increment(metrics::MSG_HEARTBEAT);
+        long long rtt = 0;
+        try
+        {
+            rtt = std::stoll(data.substr(message_types::MSG_HEARTBEAT.length()));
+        }
+        catch (std::logic_error&)
+        {
+            metrics::increment(metrics::MSG_INVALID);
+            throw invalid_message("Client sent invalid heartbeat.");
+        }
+        if (rtt > 0)
+            metrics::record(metrics::CLIENT_RTT, rtt);
+        std::cout << m_data.get_name() << ": Heartbeat, rtt " << rtt << "us" << std::endl;
+        deliver(make_message(message_types::MSG_HEARTBEAT_OK));
+    }
+    else if (compare_msg(data, message_types::MSG_LEADERBOARD))
+    {
+        metrics::scoped_timer timer(metrics::LAT_LEADERBOARD);
+        metrics::increment(metrics::MSG_LEADERBOARD);
+        bool top = compare_msg(data, message_types::MSG_LEADERBOARD_TOP);
+        if (!top && !compare_msg(data, message_types::MSG_LEADERBOARD_RANK))
+        {
+            metrics::increment(metrics::MSG_INVALID);
+            throw invalid_message("Client sent invalid leaderboard request.");
+        }
+
+        auto args = split(data.substr(top ? message_types::MSG_LEADERBOARD_TOP.length() : message_types::MSG_LEADERBOARD_RANK.length()), '+');
+        leaderboard::Boards board;
+        std::size_t count = 0;
+        try
+        {
+            if (args.empty() || !leaderboard::parse_board(args[0], board) || (top && (args.size() < 2 || (count = std::stoul(args[1])) == 0)))
+                throw std::invalid_argument("board");
+        }
+        catch (std::logic_error&)
+        {
+            deliver(make_message(message_types::MSG_LEADERBOARD_FAIL));
+            return;
+        }
+
+        std::string res = message_types::MSG_LEADERBOARD_OK + "+" + std::to_string(m_context.leaders.size(board));
+        auto append = [&](std::size_t rank, const leaderboard::entry& item)
+        {
+            std::string record = "+" + std::to_string(rank) + " " + std::to_string(item.value) + " " + m_context.leaders.name(item.id);
+            if (res.length() + record.length() > message::MAX_BODY_LENGTH)
+                return false;
+            res += record;
+            return true;
+        };
+        if (top)
+        {
+            std::size_t rank = 0;
+            for (const auto& item : m_context.leaders.top(board, std::min<std::size_t>(count, message::MAX_BODY_LENGTH / 4)))
+                if (!append(++rank, item))
+                    break;
+        }
+        else
+        {
+            leaderboard::entry item;
+            if (std::size_t rank = m_context.leaders.rank(board, m_data.get_id(), item))
+                append(rank, item);
+        }
+        std::cout << m_data.get_name() << ": Leaderboard " << args[0] << std::endl;
+        deliver(make_message(res));
+    }
+    else if (compare_msg(data, message_types::MSG_SPECTATE))
+    {
+        metrics::increment(metrics::MSG_SPECTATE);
+        if (compare_msg(data, message_types::MSG_SPECTATE_STOP))
+        {
+            stop_watching();
+            std::cout << m_data.get_name() << ": Stopped watching" << std::endl;
+            deliver(make_message(message_types::MSG_SPECTATE_OK));
+            return;
+        }
+        if (!compare_msg(data, message_types::MSG_SPECTATE_WATCH))
+        {
+            metrics::increment(metrics::MSG_INVALID);
+            throw invalid_message("Client sent invalid spectate request.");
+        }
+
+        std::string name = data.substr(message_types::MSG_SPECTATE_WATCH.length());
+        if (!m_data.get_id() || !watch(name))
+        {
+            deliver(make_message(message_types::MSG_SPECTATE_FAIL));
+            std::cout << m_data.get_name() << ": Watch " << name << " failed" << std::endl;
+            return;
+        }
+        std::cout << m_data.get_name() << ": Watching " << name << std::endl;
+        deliver(make_message(message_types::MSG_SPECTATE_OK));
+        deliver(boost::shared_ptr<session>(m_watching)->spectator_snapshot());
+    }
+    else if (compare_msg(data, message_types::MSG_TOKEN))
+    {
+        metrics::increment(metrics::MSG_RESUME);
+        if (!m_data.get_id())
+        {
+            metrics::increment(metrics::MSG_INVALID);
+            throw invalid_message("Client requested token without being logged in.");
+        }
+        if (!m_token.empty())
+            m_context.tokens.revoke(m_token);
+        m_token = m_context.tokens.issue(m_data.get_id(), m_data.get_name());
+        deliver(make_message(message_types::MSG_TOKEN_OK + "+" + m_token));
+    }
+    else if (compare_msg(data, message_types::MSG_RESUME))
+    {
+        metrics::scoped_timer timer(metrics::LAT_LOGIN);
+        metrics::increment(metrics::MSG_RESUME);
+        if (m_context.overload.shed_login())
+        {
+            deliver(make_message(message_types::MSG_THROTTLE + std::to_string(m_context.overload.retry_after())));
+            std::cout << "Resume rejected, server is overloaded" << std::endl;
+            return;
+        }
+        auto args = split(data.substr(message_types::MSG_RESUME.length()), '+');
+        resume_tokens::entry player;
+        if (m_data.get_id() || args.size() != 3 || !m_context.tokens.take(args[0], player))
+        {
+            metrics::increment(metrics::RESUMES_FAILED);
+            deliver(make_message(message_types::MSG_RESUME_FAIL));
+            std::cout << "Resume failed" << std::endl;
+            return;
+        }
+
+        // Old connection may not have noticed it dropped yet, its game is saved before it is loaded here.
+        if (boost::shared_ptr<base_session> old = m_sessions.find_player(player.name))
+        {
+            m_sessions.leave(old);
+            old->close();
+        }
+        m_data.set_id(player.id);
+        m_data.set_name(player.name);
+        m_sessions.identify(player.name, shared_from_this());
+        try
+        {
+            m_data.load_data(m_sql.get_data(player.id));
+        }
+        catch (invalid_message&)
+        {
+            m_sessions.leave(shared_from_this());
+            return;
+        }
+        update_leaderboard(m_data.get_global_stats_impl());
+
+        std::string rects = m_data.serialize_rects(), hash = hasher::board(rects), score = std::to_string(m_data.get_score());
+        m_token = m_context.tokens.issue(player.id, player.name);
+        std::string res = message_types::MSG_RESUME_OK + "+" + m_token + "+" + hash + "+" + score;
+        if (args[1] != hash || args[2] != score)
+        {
+            metrics::increment(metrics::RESUMES_RESYNCED);
+            res += "+" + rects + "+" + (m_data.get_won() ? "1" : "0");
+        }
+        deliver(make_message(std::move(res)));
+        std::cout << player.name << ": Resumed" << std::endl;
     }
     else
+    {
+        metrics::increment(metrics::MSG_INVALID);
         throw invalid_message("Client sent invalid message format.");
+    }
 }
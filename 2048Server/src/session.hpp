@@ -1,17 +1,36 @@
 #pragma once
 #include <iostream>
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <limits>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/weak_ptr.hpp>
 #include <boost/asio.hpp>
 #include "../../Common/message.hpp"
+#include "../../Common/capture_file.hpp"
 #include "player_data.hpp"
 #include "base_session.hpp"
 #include "session_container.hpp"
 #include "sql_connection.hpp"
+#include "session_context.hpp"
+#include "timer_wheel.hpp"
+#include "rate_limiter.hpp"
+#include "message_pool.hpp"
+#include "resume_tokens.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
 using boost::asio::ip::tcp;
 
 /**!
     \ingroup server
     \brief Class representing user session.
+
+    A session may watch game of another logged player as a spectator. Each move of the watched player
+    is serialized into single pooled message, which is shared by write queues of all its spectators, so fan-out
+    costs one reference per spectator. A spectator, which falls behind, is skipped until its queue drains
+    and then gets snapshot of the board instead of the missed moves.
     \sa base_session
 */
 class session : public base_session, public boost::enable_shared_from_this<session>
@@ -19,9 +38,26 @@ class session : public base_session, public boost::enable_shared_from_this<sessi
     public:
         //! Basic constructor initializing required data.
         //! \param io_service reference to boost io_service.
-        //! \param sessions reference to session container.
-        //! \param sql reference to sql conenction.
-        session(boost::asio::io_service& io_service, session_container& sessions, sql_connection& sql) : m_socket(io_service), m_sessions(sessions), m_sql(sql) { }
+        //! \param context services and settings shared by sessions.
+        //! \param id id of the session in traffic capture.
+        session(boost::asio::io_service& io_service, const session_context& context, std::uint64_t id) :
+            m_socket(io_service), m_sessions(context.sessions), m_sql(context.sql), m_context(context), m_capture(context.capture), m_id(id),
+            m_started(false), m_reading(false), m_last_activity(0), m_read_start(0), m_armed(0),
+            m_queued_bytes(0), m_writing(0), m_over_cap(false), m_over_cap_since(0), m_read_paused(false),
+            m_buckets(context.limiter.make_session_buckets()), m_throttled(0), m_watched(nullptr), m_watch_id(0), m_spectator_stale(false)
+        {
+            m_data.set_archive(context.archive);
+        }
+
+        //! Destructor, which removes unsent messages from write queue metrics.
+        ~session()
+        {
+            if (m_started)
+                capture(capture_file::CLOSE);
+            stop_watching();
+            metrics::add(metrics::WRITE_QUEUE_MESSAGES, -static_cast<long long>(m_write_msgs.size()));
+            metrics::add(metrics::WRITE_QUEUE_BYTES, -static_cast<long long>(m_queued_bytes));
+        }
 
         //! Getter for socket. Used in \ref server::start_accept.
         //! \return reference to socket of this session.
@@ -30,29 +66,64 @@ class session : public base_session, public boost::enable_shared_from_this<sessi
         //! Starts current session.
         void start()
         {
+            metrics::increment(metrics::SESSIONS_ACCEPTED);
             m_sessions.join(shared_from_this());
-            boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.data(), message::HEADER_LENGTH),
-                boost::bind(&session::handle_read_header, shared_from_this(), boost::asio::placeholders::error));
+            m_started = true;
+            boost::system::error_code ec;
+            tcp::endpoint remote = m_socket.remote_endpoint(ec);
+            if (!ec)
+                m_address = m_context.limiter.get_address(remote.address());
+            capture(capture_file::OPEN);
+            capture(capture_file::SEED);
+            m_last_activity = m_context.timers.now();
+            arm_timeout();
+            read_header();
         }
 
-        //! Delivers a \ref message to the client.
-        //! \param msg \ref message to deliver.
-        void deliver(const message& msg)
+        //! Delivers a \ref message to the client. Messages queued while previous write is in progress are sent
+        //! together by single gather write. When write queue exceeds its cap, reading from the client is paused
+        //! after current message, until the queue drains below half of the cap.
+        //! \param msg pooled \ref message to deliver.
+        void deliver(const message_ptr& msg)
         {
-            bool write_in_progress = !m_write_msgs.empty();
-            m_write_msgs.push_back(msg);
-            if (!write_in_progress)
-            {
-                boost::asio::async_write(m_socket, boost::asio::buffer(m_write_msgs.front().data(), m_write_msgs.front().length()),
-                    boost::bind(&session::handle_write, shared_from_this(), boost::asio::placeholders::error));
-            }
+            m_trace.responded();
+            queue(msg);
         }
 
-        //! Initiates saving data to sql database.
+        //! Initiates saving data to sql database. Saving of stats is deferred, when the server is overloaded,
+        //! but \ref session_context::stats gets them immediately.
         void save_data()
         {
             m_data.update_stats();
-            m_sql.save_data(m_data);
+            m_sql.save_data(m_data, !m_context.overload.defer_stats(m_data.get_id(), m_data.get_stats_impl()));
+            if (m_context.stats && m_data.is_loaded())
+                m_context.stats->saved(m_data.get_id(), m_data.get_name(), m_data.get_global_stats_impl(), m_data.get_stats_impl());
+        }
+
+        //! Archives current game, starts expiration of resume token, stops watching and ends watching of this session by its spectators, which get \ref message_types::MSG_SPECTATE_END.
+        void left()
+        {
+            m_data.archive_game();
+            if (!m_token.empty())
+                m_context.tokens.release(m_token);
+            stop_watching();
+            for (const auto& item : m_spectators)
+            {
+                boost::shared_ptr<session> spec = item.first.lock();
+                if (!spec || spec->m_watched != this || spec->m_watch_id != item.second)
+                    continue;
+                spec->stop_watching();
+                if (spec->m_socket.is_open())
+                    spec->queue(make_message(message_types::MSG_SPECTATE_END));
+            }
+            m_spectators.clear();
+        }
+
+        //! Closes the connection. Pending handlers fail and release the session.
+        void close()
+        {
+            boost::system::error_code ignored;
+            m_socket.close(ignored);
         }
 
         //! Handles readin the header of the message.
@@ -61,6 +132,9 @@ class session : public base_session, public boost::enable_shared_from_this<sessi
         {
             if (!error && m_read_msg.decode_header())
             {
+                m_reading = true;
+                m_read_start = m_last_activity = m_context.timers.now();
+                m_trace.begin("read_header");
                 boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.body(), m_read_msg.body_length()),
                     boost::bind(&session::handle_read_body, shared_from_this(), boost::asio::placeholders::error));
             }
@@ -74,8 +148,17 @@ class session : public base_session, public boost::enable_shared_from_this<sessi
         {
             if (!error)
             {
+                m_reading = false;
+                m_last_activity = m_context.timers.now();
+                metrics::increment(metrics::MSGS_IN);
+                metrics::increment(metrics::BYTES_IN, m_read_msg.length());
+                m_trace.span_since_stamp("read_body");
+                m_trace.label(m_read_msg.body(), m_read_msg.body_length());
+                capture(capture_file::MSG_IN, m_read_msg.body(), m_read_msg.body_length());
                 try
                 {
+                    TRACE_REQUEST(m_trace);
+                    TRACE_SPAN("dispatch");
                     handle_message(m_read_msg);
                 }
                 catch (invalid_message&)
@@ -86,8 +169,18 @@ class session : public base_session, public boost::enable_shared_from_this<sessi
                 {
                     throw;
                 }
-                boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.data(), message::HEADER_LENGTH),
-                    boost::bind(&session::handle_read_header, shared_from_this(), boost::asio::placeholders::error));
+                if (m_trace.has_response())
+                    m_write_info.back().trace = m_trace; // request finishes, when the response is written
+                else
+                    m_trace.finish();
+
+                if (m_over_cap)
+                {
+                    m_read_paused = true; // resumed by handle_write
+                    metrics::increment(metrics::READS_PAUSED);
+                }
+                else
+                    read_header();
             }
             else
                 m_sessions.leave(shared_from_this());
@@ -99,12 +192,34 @@ class session : public base_session, public boost::enable_shared_from_this<sessi
         {
             if (!error)
             {
-                m_write_msgs.pop_front();
-                if (!m_write_msgs.empty())
+                auto now = std::chrono::steady_clock::now();
+                for (; m_writing; --m_writing)
+                {
+                    std::size_t length = m_write_msgs.front()->msg.length();
+                    metrics::increment(metrics::MSGS_OUT);
+                    metrics::increment(metrics::BYTES_OUT, length);
+                    metrics::record(metrics::LAT_WRITE, metrics::micros(now - m_write_info.front().queued));
+                    m_write_info.front().trace.span_since_stamp("write");
+                    m_write_info.front().trace.finish();
+                    metrics::add(metrics::WRITE_QUEUE_MESSAGES, -1);
+                    metrics::add(metrics::WRITE_QUEUE_BYTES, -static_cast<long long>(length));
+                    m_queued_bytes -= length;
+                    m_write_msgs.pop_front();
+                    m_write_info.pop_front();
+                }
+                if (m_spectator_stale && m_write_msgs.size() <= m_context.spectator_lag / 2)
+                    catch_up();
+                if (m_over_cap && m_queued_bytes <= m_context.write_queue_bytes / 2 && m_write_msgs.size() <= m_context.write_queue_messages / 2)
                 {
-                    boost::asio::async_write(m_socket, boost::asio::buffer(m_write_msgs.front().data(), m_write_msgs.front().length()),
-                        boost::bind(&session::handle_write, shared_from_this(), boost::asio::placeholders::error));
+                    m_over_cap = false;
+                    if (m_read_paused && m_socket.is_open())
+                    {
+                        m_read_paused = false;
+                        read_header();
+                    }
                 }
+                if (!m_writing && !m_write_msgs.empty())
+                    write();
             }
             else
                 m_sessions.leave(shared_from_this());
@@ -115,10 +230,269 @@ class session : public base_session, public boost::enable_shared_from_this<sessi
         void handle_message(const message& mes);
 
     private:
+        //! Takes tokens for message from rate limiter, answers \ref message_types::MSG_THROTTLE if it is over the limit.
+        //! \param data body of the message.
+        //! Closes the session, if too many consecutive messages were throttled.
+        //! \return true if the message is throttled and shall not be processed, false otherwise.
+        bool throttle(const std::string& data)
+        {
+            static const metrics::Counters THROTTLED[rate_limiter::MAX_MESSAGE_CLASSES] = { metrics::THROTTLED_LOGIN, metrics::THROTTLED_GAME, metrics::THROTTLED_OTHER };
+            rate_limiter::MessageClasses cls = rate_limiter::classify(data);
+            std::uint64_t wait = rate_limiter::consume(m_buckets, m_address.get(), cls, token_bucket::clock::now());
+            if (!wait)
+            {
+                m_throttled = 0;
+                return false;
+            }
+
+            metrics::increment(THROTTLED[cls]);
+            if (m_context.limiter.throttle_disconnect() && ++m_throttled >= m_context.limiter.throttle_disconnect())
+            {
+                metrics::increment(metrics::THROTTLE_DISCONNECTS);
+                std::cout << m_data.get_name() << ": Exceeded rate limit" << std::endl;
+                m_sessions.leave(shared_from_this());
+                boost::system::error_code ignored;
+                m_socket.close(ignored); // pending handlers fail and release the session
+                return true;
+            }
+            std::cout << m_data.get_name() << ": Throttled" << std::endl;
+            deliver(make_message(message_types::MSG_THROTTLE + std::to_string((wait + 999) / 1000)));
+            return true;
+        }
+
+        //! Submits records of the player into \ref session_context::leaders.
+        //! \param st stats of current session or global stats of the player.
+        void update_leaderboard(const stats::container_t& st)
+        {
+            m_context.leaders.submit(leaderboard::SCORE, m_data.get_id(), m_data.get_name(), st[stats::HIGHEST_SCORE]);
+            if (st[stats::MAXIMAL_BLOCK])
+                m_context.leaders.submit(leaderboard::MAX_BLOCK, m_data.get_id(), m_data.get_name(), pow2(static_cast<int>(st[stats::MAXIMAL_BLOCK])));
+            m_context.leaders.submit(leaderboard::FASTEST_WIN, m_data.get_id(), m_data.get_name(), st[stats::FASTEST_WIN]);
+        }
+
+        //! Queues message for writing without regard to the request being processed.
+        //! \param msg pooled \ref message to deliver.
+        //! \sa deliver
+        void queue(const message_ptr& msg)
+        {
+            capture(capture_file::MSG_OUT, msg->msg.body(), msg->msg.body_length());
+            metrics::record(metrics::WRITE_QUEUE_DEPTH, m_write_msgs.size());
+            metrics::add(metrics::WRITE_QUEUE_MESSAGES, 1);
+            metrics::add(metrics::WRITE_QUEUE_BYTES, msg->msg.length());
+            m_write_msgs.push_back(msg);
+            m_queued_bytes += msg->msg.length();
+            m_write_info.emplace_back();
+            m_write_info.back().queued = std::chrono::steady_clock::now();
+            if (!m_over_cap && (m_queued_bytes > m_context.write_queue_bytes || m_write_msgs.size() > m_context.write_queue_messages))
+            {
+                m_over_cap = true;
+                m_over_cap_since = m_context.timers.now();
+                metrics::increment(metrics::WRITE_QUEUE_OVERFLOWS);
+                arm_timeout();
+            }
+            if (!m_writing)
+                write();
+        }
+
+        //! Starts watching game of another player.
+        //! \param name name of the watched player.
+        //! \return true if the player is online and is not this session, false otherwise.
+        bool watch(const std::string& name)
+        {
+            boost::shared_ptr<session> target = boost::static_pointer_cast<session>(m_sessions.find_player(name));
+            if (!target || target.get() == this)
+                return false;
+            stop_watching();
+            m_watching = target;
+            m_watched = target.get();
+            ++m_watch_id;
+            if (target->m_spectators.size() == target->m_spectators.capacity())
+                target->compact_spectators(); // keeps growth of the vector amortized, spectators leaving between moves would pile up
+            target->m_spectators.emplace_back(shared_from_this(), m_watch_id);
+            metrics::add(metrics::SPECTATORS, 1);
+            return true;
+        }
+
+        //! Stops watching, if this session is a spectator.
+        void stop_watching()
+        {
+            if (!m_watched)
+                return;
+            m_watching.reset();
+            m_watched = nullptr;
+            m_spectator_stale = false;
+            metrics::add(metrics::SPECTATORS, -1);
+        }
+
+        //! Creates snapshot of the board for spectators.
+        //! \return \ref message_types::MSG_SPECTATE_SNAPSHOT with current board, won status and score.
+        message_ptr spectator_snapshot() const
+        {
+            return make_message(message_types::MSG_SPECTATE_SNAPSHOT + m_data.serialize_rects() + "+" + (m_data.get_won() ? "1" : "0") + "+" + std::to_string(m_data.get_score()));
+        }
+
+        //! Delivers the same message to all spectators of this session.
+        //! \param msg pooled message, which is shared by write queues of the spectators.
+        void notify_spectators(const message_ptr& msg)
+        {
+            metrics::increment(metrics::SPECTATOR_BROADCASTS);
+            compact_spectators();
+            for (const auto& item : m_spectators)
+                boost::shared_ptr<session>(item.first)->deliver_spectated(msg); // alive, since compacted just now
+        }
+
+        //! Forgets spectators, which were destroyed or watch another player now.
+        void compact_spectators()
+        {
+            std::size_t live = 0;
+            for (std::size_t i = 0; i < m_spectators.size(); ++i)
+            {
+                boost::shared_ptr<session> spec = m_spectators[i].first.lock();
+                if (spec && spec->m_watched == this && spec->m_watch_id == m_spectators[i].second && spec->m_socket.is_open())
+                    m_spectators[live++] = m_spectators[i];
+            }
+            m_spectators.resize(live);
+        }
+
+        //! Delivers message of the watched player, unless this spectator fell behind.
+        //! \param msg pooled message shared with other spectators.
+        void deliver_spectated(const message_ptr& msg)
+        {
+            if (m_spectator_stale)
+                return;
+            if (m_write_msgs.size() >= m_context.spectator_lag)
+            {
+                m_spectator_stale = true; // missed moves are replaced by snapshot in handle_write
+                metrics::increment(metrics::SPECTATOR_LAGS);
+                return;
+            }
+            metrics::increment(metrics::SPECTATOR_DELIVERIES);
+            queue(msg);
+        }
+
+        //! Sends snapshot of the watched board to spectator, which fell behind and its queue drained.
+        void catch_up()
+        {
+            m_spectator_stale = false;
+            boost::shared_ptr<session> watched = m_watching.lock();
+            if (!watched || !m_socket.is_open())
+                return;
+            metrics::increment(metrics::SPECTATOR_CATCHUPS);
+            queue(watched->spectator_snapshot());
+        }
+
+        //! Starts reading header of next message.
+        void read_header()
+        {
+            m_trace.stamp();
+            boost::asio::async_read(m_socket, boost::asio::buffer(m_read_msg.data(), message::HEADER_LENGTH),
+                boost::bind(&session::handle_read_header, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Starts writing of all queued messages by single gather write.
+        void write()
+        {
+            m_writing = m_write_msgs.size();
+            if (m_writing > 1)
+                metrics::increment(metrics::COALESCED_WRITES);
+            std::vector<boost::asio::const_buffer> buffers;
+            buffers.reserve(m_writing);
+            for (const auto& msg : m_write_msgs)
+                buffers.push_back(boost::asio::buffer(msg->msg.data(), msg->msg.length()));
+            boost::asio::async_write(m_socket, buffers, boost::bind(&session::handle_write, shared_from_this(), boost::asio::placeholders::error));
+        }
+
+        //! Schedules check of timeouts on \ref session_context::timers, unless earlier check is already scheduled.
+        //! When not reading a message, the check is scheduled no later than read timeout, so it catches header read in meantime.
+        void arm_timeout()
+        {
+            const std::uint64_t never = std::numeric_limits<std::uint64_t>::max();
+            std::uint64_t now = m_context.timers.now(), deadline = never;
+            if (m_context.idle_timeout)
+                deadline = m_last_activity + m_context.idle_timeout;
+            if (m_context.read_timeout)
+                deadline = std::min(deadline, (m_reading ? m_read_start : now) + m_context.read_timeout);
+            if (m_over_cap && m_context.write_queue_timeout)
+                deadline = std::min(deadline, m_over_cap_since + m_context.write_queue_timeout);
+            if (deadline == never || (m_armed > now && m_armed <= deadline))
+                return;
+            m_armed = std::max(deadline, now + 1);
+            m_context.timers.schedule(m_armed - now, boost::bind(&session::handle_timeout, boost::weak_ptr<session>(shared_from_this()), m_armed));
+        }
+
+        //! Closes the session if it timed out, otherwise schedules next check.
+        //! \param weak session to check, does nothing if it was already destroyed.
+        //! \param tick tick, for which the check was scheduled. Checks superseded by earlier ones are ignored.
+        static void handle_timeout(boost::weak_ptr<session> weak, std::uint64_t tick)
+        {
+            boost::shared_ptr<session> self = weak.lock();
+            if (!self || !self->m_socket.is_open() || tick != self->m_armed)
+                return;
+
+            std::uint64_t now = self->m_context.timers.now();
+            if (self->m_reading && self->m_context.read_timeout && now >= self->m_read_start + self->m_context.read_timeout)
+                metrics::increment(metrics::TIMEOUTS_READ);
+            else if (self->m_context.idle_timeout && now >= self->m_last_activity + self->m_context.idle_timeout)
+                metrics::increment(metrics::TIMEOUTS_IDLE);
+            else if (self->m_over_cap && self->m_context.write_queue_timeout && now >= self->m_over_cap_since + self->m_context.write_queue_timeout)
+                metrics::increment(metrics::WRITE_QUEUE_DISCONNECTS);
+            else
+            {
+                self->m_armed = 0;
+                return self->arm_timeout();
+            }
+
+            std::cout << self->m_data.get_name() << ": Timed out" << std::endl;
+            self->m_sessions.leave(self);
+            boost::system::error_code ignored;
+            self->m_socket.close(ignored); // pending handlers fail and release the session
+        }
+
+        //! Writes record of this session into \ref m_capture if capturing is enabled.
+        //! \param type type of the record, \ref capture_file::SEED records current seed of \ref m_data.
+        //! \param data message body.
+        //! \param length length of \a data.
+        void capture(capture_file::RecordTypes type, const char* data = nullptr, std::size_t length = 0)
+        {
+            if (m_capture)
+                m_capture->write(type, m_id, data, length, m_data.get_seed());
+        }
+
+        //! Bookkeeping of message in write queue.
+        struct write_info
+        {
+            std::chrono::steady_clock::time_point queued; //!< Time, when the message was queued.
+            tracing::request_trace trace; //!< Request, which the message responds to.
+        };
+
         tcp::socket m_socket; //!< Socket as endpoint of the communication.
         session_container& m_sessions; //!< Reference to \ref session_container.
         message m_read_msg; //!< Message sent by client.
-        std::deque<message> m_write_msgs; //!< Messages to send to client.
+        std::deque<message_ptr> m_write_msgs; //!< Messages to send to client.
+        std::deque<write_info> m_write_info; //!< Bookkeeping of \ref m_write_msgs.
+        tracing::request_trace m_trace; //!< Request being read or processed.
         sql_connection& m_sql; //!< Reference to sql database wrapper. \sa sql_connection
         player_data m_data; //!< Data of the player used in the game.
+        const session_context& m_context; //!< Services and settings shared by sessions.
+        std::shared_ptr<capture_writer> m_capture; //!< Traffic capture, nullptr if disabled. Owned also here, so it outlives the server.
+        std::uint64_t m_id; //!< Id of the session in \ref m_capture.
+        bool m_started; //!< Indicates, that the session was started.
+        bool m_reading; //!< Indicates, that message header was read and its body is being read.
+        std::uint64_t m_last_activity; //!< Tick of \ref session_context::timers, when last message header or body was read.
+        std::uint64_t m_read_start; //!< Tick of \ref session_context::timers, when header of message being read was read.
+        std::uint64_t m_armed; //!< Tick of earliest scheduled timeout check, 0 if none.
+        std::size_t m_queued_bytes; //!< Bytes in \ref m_write_msgs.
+        std::size_t m_writing; //!< Number of messages from front of \ref m_write_msgs being written.
+        bool m_over_cap; //!< Indicates, that write queue exceeded its cap and did not drain below half of it yet.
+        std::uint64_t m_over_cap_since; //!< Tick of \ref session_context::timers, when write queue exceeded its cap.
+        bool m_read_paused; //!< Indicates, that reading from client is paused until write queue drains.
+        rate_limiter::session_buckets m_buckets; //!< Rate limits of this session.
+        rate_limiter::address_ptr m_address; //!< Rate limits shared with other sessions from the same address, nullptr if unknown.
+        std::size_t m_throttled; //!< Number of consecutive throttled messages.
+        std::vector<std::pair<boost::weak_ptr<session>, std::uint64_t>> m_spectators; //!< Spectators of this session with \ref m_watch_id of their watching, compacted lazily.
+        boost::weak_ptr<session> m_watching; //!< Session watched by this spectator.
+        const session* m_watched; //!< Session watched by this spectator, only for identity, nullptr if not watching.
+        std::uint64_t m_watch_id; //!< Counter of watch requests, so stale entries in \ref m_spectators are recognized.
+        bool m_spectator_stale; //!< Indicates, that this spectator fell behind and waits for snapshot.
+        std::string m_token; //!< Last token issued to this session for resuming it, empty if none. \sa resume_tokens
 };
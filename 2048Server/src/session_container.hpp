@@ -1,10 +1,14 @@
 #pragma once
 #include <deque>
 #include <set>
+#include <string>
+#include <unordered_map>
 #include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
 #include "base_session.hpp"
 #include "../../Common/message.hpp"
+#include "metrics.hpp"
 
 /**!
     \ingroup server
@@ -16,13 +20,53 @@ class session_container
     public:
         //! Appends session into the container.
         //! \param ses shared_ptr to session.
-        void join(boost::shared_ptr<base_session> ses) { m_sessions.insert(ses); }
+        void join(boost::shared_ptr<base_session> ses)
+        {
+            if (m_sessions.insert(ses).second)
+                metrics::add(metrics::ACTIVE_SESSIONS, 1);
+        }
 
-        //! Saves session data and removes session from the container.
+        //! Saves session data and removes session from the container. Does nothing if session already left.
         //! \param ses shared_ptr to session.
-        //! \sa session::save_data
-        void leave(boost::shared_ptr<base_session> ses) { ses->save_data(); m_sessions.erase(ses); }
+        //! \sa session::save_data, session::left
+        void leave(boost::shared_ptr<base_session> ses)
+        {
+            if (m_sessions.find(ses) == m_sessions.end())
+                return;
+            ses->save_data();
+            ses->left();
+            m_sessions.erase(ses);
+            metrics::add(metrics::ACTIVE_SESSIONS, -1);
+            metrics::increment(metrics::SESSIONS_CLOSED);
+        }
+
+        //! Registers session of logged player, so it can be found by his name.
+        //! \param name player's name.
+        //! \param ses shared_ptr to session.
+        void identify(const std::string& name, boost::shared_ptr<base_session> ses) { m_players[name] = ses; }
+
+        //! Finds session of logged player.
+        //! \param name player's name.
+        //! \return shared_ptr to latest session of the player, nullptr if he is not online.
+        boost::shared_ptr<base_session> find_player(const std::string& name)
+        {
+            auto it = m_players.find(name);
+            if (it == m_players.end())
+                return nullptr;
+            boost::shared_ptr<base_session> ses = it->second.lock();
+            if (!ses || m_sessions.find(ses) == m_sessions.end()) // sessions are forgotten lazily
+            {
+                m_players.erase(it);
+                return nullptr;
+            }
+            return ses;
+        }
+
+        //! Gets number of active sessions.
+        //! \return number of sessions in the container.
+        std::size_t size() const { return m_sessions.size(); }
         
     private:
         std::set<boost::shared_ptr<base_session>> m_sessions; //!< Implementation of container.
+        std::unordered_map<std::string, boost::weak_ptr<base_session>> m_players; //!< Sessions of logged players by their names.
 };
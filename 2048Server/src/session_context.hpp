@@ -0,0 +1,40 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "session_container.hpp"
+#include "sql_connection.hpp"
+#include "timer_wheel.hpp"
+#include "rate_limiter.hpp"
+#include "overload_monitor.hpp"
+#include "leaderboard.hpp"
+#include "stats_cache.hpp"
+#include "resume_tokens.hpp"
+#include "../../Common/capture_file.hpp"
+#include "../../Common/game_archive.hpp"
+
+/**!
+    \ingroup server
+    \brief Services and settings of the server shared by all sessions.
+    \sa server, session
+*/
+struct session_context
+{
+    session_container& sessions; //!< Container of active sessions.
+    sql_connection& sql; //!< SQL database.
+    timer_wheel& timers; //!< Timers of session timeouts.
+    rate_limiter& limiter; //!< Rate limits of messages.
+    overload_monitor& overload; //!< Load shedding.
+    leaderboard& leaders; //!< Global leaderboard.
+    resume_tokens& tokens; //!< Tokens for resuming sessions.
+    std::shared_ptr<capture_writer> capture; //!< Traffic capture, nullptr if disabled.
+    std::shared_ptr<archive_writer> archive; //!< Archive of finished games, nullptr if disabled.
+    std::shared_ptr<stats_cache> stats; //!< Snapshots served by stats HTTP endpoint, nullptr if disabled.
+    bool allow_seed; //!< Indicates, whether client may seed random generator by \ref message_types::MSG_SEED.
+    std::uint64_t idle_timeout; //!< Ticks of \ref timers without any message, after which session is closed. 0 disables the timeout.
+    std::uint64_t read_timeout; //!< Ticks of \ref timers allowed for reading message body after its header. 0 disables the timeout.
+    std::size_t write_queue_bytes; //!< Cap of bytes in write queue of a session.
+    std::size_t write_queue_messages; //!< Cap of messages in write queue of a session.
+    std::uint64_t write_queue_timeout; //!< Ticks of \ref timers, after which session over write queue cap is closed. 0 disables the timeout.
+    std::size_t spectator_lag; //!< Messages queued to a spectator, over which it gets board snapshot instead of next moves.
+};
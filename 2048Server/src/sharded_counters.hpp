@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "../../Common/histogram.hpp"
+
+/**!
+    \ingroup server
+    \brief Process wide counters and histograms recorded into per-thread shards.
+
+    Each thread records into its own shard without any locking, counters are written only by the owning thread,
+    so relaxed load and store is enough. Shards are registered under mutex on first use of a thread and merged
+    only when read. There is one registry per \a Owner, which only distinguishes registries of different classes.
+    \tparam Owner class owning the registry.
+    \tparam COUNTERS number of counters.
+    \tparam HISTOGRAMS number of histograms.
+    \sa metrics, gameplay_stats
+*/
+template<typename Owner, std::size_t COUNTERS, std::size_t HISTOGRAMS>
+class sharded_counters
+{
+    public:
+        using counters_t = std::array<std::uint64_t, COUNTERS>; //!< Merged counters.
+        using histograms_t = std::array<histogram, HISTOGRAMS>; //!< Merged histograms.
+
+        //! Increments a counter of calling thread.
+        //! \param counter index of the counter.
+        //! \param value amount to increment by.
+        static void increment(std::size_t counter, std::uint64_t value = 1)
+        {
+            std::atomic<std::uint64_t>& cnt = local().counters[counter];
+            cnt.store(cnt.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); // only owning thread writes
+        }
+
+        //! Records value into histogram of calling thread.
+        //! \param hist index of the histogram.
+        //! \param value value to record.
+        static void record(std::size_t hist, std::uint64_t value) { local().histograms[hist].record(value); }
+
+        //! Sums counters of all threads.
+        //! \return merged counters.
+        static counters_t counters()
+        {
+            sharded_counters& inst = instance();
+            counters_t res = { };
+            std::lock_guard<std::mutex> lock(inst.m_mutex);
+            for (const auto& sh : inst.m_shards)
+                for (std::size_t i = 0; i < COUNTERS; ++i)
+                    res[i] += sh->counters[i].load(std::memory_order_relaxed);
+            return res;
+        }
+
+        //! Merges histograms of all threads.
+        //! \return merged histograms, allocated since they are big.
+        static std::unique_ptr<histograms_t> histograms()
+        {
+            sharded_counters& inst = instance();
+            std::unique_ptr<histograms_t> res(new histograms_t());
+            std::lock_guard<std::mutex> lock(inst.m_mutex);
+            for (const auto& sh : inst.m_shards)
+                for (std::size_t i = 0; i < HISTOGRAMS; ++i)
+                    (*res)[i].merge(sh->histograms[i]);
+            return res;
+        }
+
+    private:
+        //! Counters and histograms recorded by single thread.
+        struct shard
+        {
+            shard() { for (auto& cnt : counters) cnt.store(0, std::memory_order_relaxed); }
+
+            std::array<std::atomic<std::uint64_t>, COUNTERS> counters; //!< Counters of the thread.
+            histograms_t histograms; //!< Histograms of the thread.
+        };
+
+        sharded_counters() { }
+
+        //! Gets the only instance.
+        //! \return reference to the instance.
+        static sharded_counters& instance()
+        {
+            static sharded_counters inst;
+            return inst;
+        }
+
+        //! Gets shard of calling thread, creates it on first use.
+        //! \return reference to thread's shard.
+        static shard& local()
+        {
+            static thread_local shard* local_shard = nullptr;
+            if (!local_shard)
+            {
+                sharded_counters& inst = instance();
+                std::lock_guard<std::mutex> lock(inst.m_mutex);
+                inst.m_shards.emplace_back(new shard());
+                local_shard = inst.m_shards.back().get();
+            }
+            return *local_shard;
+        }
+
+        std::mutex m_mutex; //!< Guards \ref m_shards.
+        std::vector<std::unique_ptr<shard>> m_shards; //!< Shards of all threads, which recorded anything.
+};
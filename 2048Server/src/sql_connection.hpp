@@ -1,12 +1,17 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <tuple>
+#include <chrono>
+#include <cstdint>
 #include <mysql_connection.h>
 #include <cppconn/driver.h>
 #include <cppconn/resultset.h>
 #include <cppconn/statement.h>
 #include <cppconn/exception.h>
 #include "../../Common/hasher.hpp"
+#include "metrics.hpp"
+#include "tracing.hpp"
 
 /**!
     \ingroup server
@@ -20,7 +25,8 @@ class sql_connection
         //! \param user MySQL username.
         //! \param pass MySQL password.
         //! \param db MySQL database containing 2048 game tables.
-        sql_connection(const std::string& host, const std::string& user, const std::string& pass, const std::string& db)
+        sql_connection(const std::string& host, const std::string& user, const std::string& pass, const std::string& db) :
+            m_queries(0), m_query_time(0)
         {
             sql::Driver* driver = get_driver_instance();
             m_connection = std::unique_ptr<sql::Connection>(driver->connect("tcp://" + host, user, pass));
@@ -36,6 +42,8 @@ class sql_connection
         //! \return player's id if login is successful, 0 otherwise.
         int check_login(const std::string& name, const std::string& passwd)
         {
+            metrics::scoped_timer timer(metrics::LAT_SQL_LOGIN);
+            TRACE_SPAN("db_check_login");
             auto res = execute_query("SELECT id, passwd FROM users WHERE name = '" + name + "';");
             if (res->next())
             {
@@ -48,20 +56,43 @@ class sql_connection
         //! Gets global stats from database
         //! \param id player's id of which we want get stats
         //! \return unique_ptr of constructed stats.
-        std::unique_ptr<stats> get_stats(int id)
+        std::unique_ptr<stats> get_stats(int id) { return load_stats(id, "stats_global"); }
+
+        //! Gets stats of last session from database
+        //! \param id player's id of which we want get stats
+        //! \return unique_ptr of constructed stats.
+        std::unique_ptr<stats> get_current_stats(int id) { return load_stats(id, "stats_current"); }
+
+        //! Gets id of player by his name.
+        //! \param name player's username, names with quotes or backslashes are never found.
+        //! \return player's id, 0 if there is no such player.
+        int get_player_id(const std::string& name)
         {
-            stats::container_t data(stats::MAX_STATS, 0l);
-            auto res = execute_query("SELECT stats_id, value FROM stats_global WHERE player_id = " + std::to_string(id) + ";");
+            if (name.empty() || name.find_first_of("'\\") != std::string::npos)
+                return 0;
+            auto res = execute_query("SELECT id FROM users WHERE name = '" + name + "';");
+            return res->next() ? res->getInt("id") : 0;
+        }
+
+        //! Gets best results of all players for leaderboard, i.e. their global highest score, maximal block and fastest win.
+        //! \return tuples of player's id, his name, \ref stats::StatTypes of the result and its value.
+        std::vector<std::tuple<int, std::string, stats::StatTypes, long long>> get_best_results()
+        {
+            std::vector<std::tuple<int, std::string, stats::StatTypes, long long>> results;
+            auto res = execute_query("SELECT stats_global.player_id, users.name, stats_global.stats_id, stats_global.value FROM stats_global "
+                "JOIN users ON users.id = stats_global.player_id WHERE stats_global.stats_id IN (" + std::to_string(stats::HIGHEST_SCORE) + ", " +
+                std::to_string(stats::MAXIMAL_BLOCK) + ", " + std::to_string(stats::FASTEST_WIN) + ") AND stats_global.value > 0;");
             while (res->next())
-                data[res->getInt("stats_id")] = res->getInt("value");
-            
-            return std::unique_ptr<stats>(new stats(data));
+                results.emplace_back(res->getInt("player_id"), res->getString("name"), static_cast<stats::StatTypes>(res->getInt("stats_id")), res->getInt64("value"));
+            return results;
         }
 
         //! Gets data of given player.
         //! \param id player's id of which we want get data.
         data_tuple get_data(int id)
         {
+            metrics::scoped_timer timer(metrics::LAT_SQL_GET_DATA);
+            TRACE_SPAN("db_get_data");
             auto res = execute_query("SELECT id, data, won, score FROM player_data WHERE id = " + std::to_string(id) + ";");
             if (res->next())
                 return std::make_tuple(res->getString("data"), res->getBoolean("won"), res->getInt("score"), get_stats(id));
@@ -70,15 +101,19 @@ class sql_connection
 
         //! Saves player's data and stats into database. Will call \ref sql_connection::save_stats.
         //! \param data reference to data to be saved into database
-        void save_data(const player_data& data)
+        //! \param with_stats whether to save also stats, false if they are saved later by \ref overload_monitor.
+        void save_data(const player_data& data, bool with_stats = true)
         {
+            metrics::scoped_timer timer(metrics::LAT_SQL_SAVE_DATA);
+            TRACE_SPAN("db_save_data");
             execute("REPLACE INTO player_data (id, data, won, score) VALUES (" +
                 std::to_string(data.get_id()) + ", '" + 
                 data.serialize_rects() + "', " + 
                 (data.get_won() ? "1" : "0") + ", " + 
                 std::to_string(data.get_score()) + 
             ");");
-            save_stats(data.get_id(), data.get_stats_impl());
+            if (with_stats)
+                save_stats(data.get_id(), data.get_stats_impl());
         }
 
         //! Saves player's stats into database
@@ -121,21 +156,57 @@ class sql_connection
             execute(cur_query);
         }
 
+        //! Gets number of executed queries.
+        //! \return number of queries since the connection was created.
+        std::uint64_t queries() const { return m_queries; }
+
+        //! Gets total time spent in queries.
+        //! \return microseconds spent in queries since the connection was created.
+        std::uint64_t query_time() const { return m_query_time; }
+
     private:
+        //! Gets stats from database
+        //! \param id player's id of which we want get stats
+        //! \param table table of the stats.
+        //! \return unique_ptr of constructed stats.
+        std::unique_ptr<stats> load_stats(int id, const std::string& table)
+        {
+            stats::container_t data(stats::MAX_STATS, 0l);
+            auto res = execute_query("SELECT stats_id, value FROM " + table + " WHERE player_id = " + std::to_string(id) + ";");
+            while (res->next())
+                data[res->getInt("stats_id")] = res->getInt("value");
+
+            return std::unique_ptr<stats>(new stats(data));
+        }
+
+        //! Adds duration of a query into \ref m_query_time.
+        //! \param start time, when the query started.
+        void account(std::chrono::steady_clock::time_point start)
+        {
+            ++m_queries;
+            m_query_time += metrics::micros(std::chrono::steady_clock::now() - start);
+        }
+
         //! Executes query to database. Used for queries which return something.
         //! \param query query to be executed.
         //! \return unique_ptr of sql::ResultSet
         std::unique_ptr<sql::ResultSet> execute_query(const std::string& query)
         {
+            metrics::scoped_timer timer(metrics::LAT_SQL_QUERY);
+            metrics::increment(metrics::SQL_QUERIES);
+            auto start = std::chrono::steady_clock::now();
             try
             {
                 sql::Statement* stmt = m_connection->createStatement();
                 std::unique_ptr<sql::ResultSet> res(stmt->executeQuery(query));
                 delete stmt;
+                account(start);
                 return std::move(res);
             }
             catch (sql::SQLException& e)
             {
+                account(start);
+                metrics::increment(metrics::SQL_ERRORS);
                 throw sql::SQLException(std::string(e.what()) + " (query: " + query + ").", e.getSQLState(), e.getErrorCode());
             }
         }
@@ -144,17 +215,25 @@ class sql_connection
         //! \param query query to be executed.
         void execute(const std::string& query)
         {
+            metrics::scoped_timer timer(metrics::LAT_SQL_QUERY);
+            metrics::increment(metrics::SQL_QUERIES);
+            auto start = std::chrono::steady_clock::now();
             try
             {
                 sql::Statement* stmt = m_connection->createStatement();
                 stmt->execute(query);
                 delete stmt;
+                account(start);
             }
             catch (sql::SQLException& e)
             {
+                account(start);
+                metrics::increment(metrics::SQL_ERRORS);
                 throw sql::SQLException(std::string(e.what()) + " (query: " + query + ").", e.getSQLState(), e.getErrorCode());
             }
         }
 
         std::unique_ptr<sql::Connection> m_connection; //!< unique_ptr of sql::Connection from connector.
+        std::uint64_t m_queries; //!< Number of executed queries.
+        std::uint64_t m_query_time; //!< Microseconds spent in queries.
 };
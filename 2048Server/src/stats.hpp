@@ -41,6 +41,43 @@ class stats
             MAX_STATS,
         };
 
+        //! Gets name of statistic, as in stats_definitions table.
+        //! \param type the statistic.
+        //! \return name of the statistic.
+        static const char* name(StatTypes type)
+        {
+            static const char* NAMES[MAX_STATS] = { "Left moves", "Right moves", "Up moves", "Down moves", "Total moves", "Blocks moved",
+                "Blocks merged", "Game restarts", "Games won", "Games lost", "Total seconds spent playing", "Total score gained",
+                "Highest score obtained", "Maximal block", "Slowest win", "Slowest lose", "Fastest win", "Fastest lose" };
+            return NAMES[type];
+        }
+
+        //! Combines statistics as \ref sql_connection::save_stats combines them in database:
+        //! records are kept by maximum or nonzero minimum, others are summed.
+        //! \param into statistics to combine into.
+        //! \param from statistics to add.
+        static void combine(container_t& into, const container_t& from)
+        {
+            for (std::size_t i = 0; i < into.size(); ++i)
+                switch (static_cast<StatTypes>(i))
+                {
+                    case HIGHEST_SCORE:
+                    case MAXIMAL_BLOCK:
+                    case SLOWEST_WIN:
+                    case SLOWEST_LOSE:
+                        into[i] = std::max(into[i], from[i]);
+                        break;
+                    case FASTEST_WIN:
+                    case FASTEST_LOSE:
+                        if (from[i] && (!into[i] || from[i] < into[i]))
+                            into[i] = from[i];
+                        break;
+                    default:
+                        into[i] += from[i];
+                        break;
+                }
+        }
+
         //! Constructs zero statistics used as base of single game.
         stats() : m_stats(MAX_STATS, 0l) { }
 
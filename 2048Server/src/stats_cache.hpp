@@ -0,0 +1,194 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include "stats.hpp"
+#include "leaderboard.hpp"
+#include "sql_connection.hpp"
+#include "metrics.hpp"
+
+/**!
+    \ingroup server
+    \brief Materialized JSON snapshots of player stats and leaderboard, served by \ref stats_http.
+
+    Snapshot of a player is rebuilt, when his session saves his stats. Global stats are combined in memory
+    by \ref stats::combine, as database combines them, so the snapshot matches database without reading it back.
+    Player, who did not save any stats since the server started, is loaded from database on first request
+    and unknown names are remembered for \ref UNKNOWN_SECONDS. Leaderboard snapshots are rebuilt on request,
+    only if the leaderboard changed since they were built. Repeated requests are answered by a hash lookup
+    and a shared string.
+*/
+class stats_cache
+{
+    public:
+        using snapshot = std::shared_ptr<const std::string>; //!< Serialized JSON, shared with responses being written.
+
+        static const std::size_t MAX_TOP = 100; //!< Most results in leaderboard snapshot.
+        static const std::size_t MAX_UNKNOWN = 4096; //!< Remembered unknown names, over which they are all forgotten.
+        static const int UNKNOWN_SECONDS = 60; //!< Seconds, for which unknown name is not looked up again (e.g. until it registers).
+
+        //! Constructs empty cache.
+        //! \param sql database, from which players are loaded on first request.
+        //! \param leaders leaderboard, whose snapshots are served.
+        stats_cache(sql_connection& sql, const leaderboard& leaders) : m_sql(sql), m_leaders(leaders) { }
+
+        //! Rebuilds snapshot of a player, whose session saved its stats. Called by \ref session::save_data.
+        //! \param id player's id, not logged players (0) are ignored.
+        //! \param name player's name.
+        //! \param global global stats of the player loaded from database, when the session started.
+        //! \param current stats of the session.
+        void saved(int id, const std::string& name, const stats::container_t& global, const stats::container_t& current)
+        {
+            if (!id)
+                return;
+            auto it = m_players.find(name);
+            if (it == m_players.end())
+                it = m_players.emplace(name, entry{ id, global, current, nullptr }).first;
+            else
+                it->second.current = current;
+            stats::combine(it->second.global, current); // existing snapshot includes saves of other sessions of the player
+            m_unknown.erase(name);
+            build(name, it->second);
+        }
+
+        //! Gets snapshot of a player, loads him from database on first request.
+        //! \param name player's name.
+        //! \param allow_load false if database must not be queried, then players not in cache are reported as unavailable.
+        //! \param res the snapshot, nullptr if there is no such player or he is unavailable.
+        //! \return false if the player was not cached and loading was not allowed, true otherwise.
+        //! \throws sql::SQLException if loading fails.
+        bool player(const std::string& name, bool allow_load, snapshot& res)
+        {
+            res = nullptr;
+            auto it = m_players.find(name);
+            if (it != m_players.end())
+            {
+                res = it->second.json;
+                return true;
+            }
+            auto now = std::chrono::steady_clock::now();
+            auto unknown = m_unknown.find(name);
+            if (unknown != m_unknown.end() && now - unknown->second < std::chrono::milliseconds(UNKNOWN_SECONDS * 1000))
+                return true;
+            if (!allow_load)
+                return false;
+
+            metrics::increment(metrics::HTTP_CACHE_MISSES);
+            int id = m_sql.get_player_id(name);
+            if (!id)
+            {
+                if (m_unknown.size() >= MAX_UNKNOWN)
+                    m_unknown.clear();
+                m_unknown[name] = now;
+                return true;
+            }
+            entry& e = m_players.emplace(name, entry{ id, m_sql.get_stats(id)->get_impl(), m_sql.get_current_stats(id)->get_impl(), nullptr }).first->second;
+            build(name, e);
+            res = e.json;
+            return true;
+        }
+
+        //! Gets snapshot of best results of a board.
+        //! \param board the board.
+        //! \param count number of results, at most \ref MAX_TOP.
+        //! \return the snapshot.
+        snapshot top(leaderboard::Boards board, std::size_t count)
+        {
+            if (count > MAX_TOP)
+                count = MAX_TOP;
+            auto& cached = m_tops[std::make_pair(static_cast<int>(board), count)];
+            if (cached.second && cached.first == m_leaders.version())
+                return cached.second;
+
+            std::string res = "{\"board\":";
+            append_string(res, leaderboard::board_name(board));
+            res += ",\"players\":" + std::to_string(m_leaders.size(board)) + ",\"top\":[";
+            std::size_t rank = 0;
+            for (const auto& item : m_leaders.top(board, count))
+            {
+                res += rank ? ",{\"rank\":" : "{\"rank\":";
+                res += std::to_string(++rank) + ",\"name\":";
+                append_string(res, m_leaders.name(item.id));
+                res += ",\"value\":" + std::to_string(item.value) + "}";
+            }
+            res += "]}";
+            cached = std::make_pair(m_leaders.version(), std::make_shared<const std::string>(std::move(res)));
+            return cached.second;
+        }
+
+        //! Appends string as JSON string literal.
+        //! \param out string to append to.
+        //! \param str string to escape.
+        static void append_string(std::string& out, const std::string& str)
+        {
+            out += '"';
+            for (char c : str)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    out += '\\';
+                    out += c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                }
+                else
+                    out += c;
+            }
+            out += '"';
+        }
+
+    private:
+        //! Cached stats of a player.
+        struct entry
+        {
+            int id; //!< Player's id.
+            stats::container_t global; //!< Global stats, as in database.
+            stats::container_t current; //!< Stats of last saved session.
+            snapshot json; //!< Snapshot of the stats.
+        };
+
+        //! Rebuilds snapshot of a player.
+        //! \param name player's name.
+        //! \param e stats of the player.
+        void build(const std::string& name, entry& e)
+        {
+            std::string res = "{\"id\":" + std::to_string(e.id) + ",\"name\":";
+            append_string(res, name);
+            res += ",\"global\":";
+            append_stats(res, e.global);
+            res += ",\"current\":";
+            append_stats(res, e.current);
+            res += "}";
+            e.json = std::make_shared<const std::string>(std::move(res));
+        }
+
+        //! Appends stats as JSON object keyed by their names.
+        //! \param out string to append to.
+        //! \param st the stats.
+        static void append_stats(std::string& out, const stats::container_t& st)
+        {
+            out += '{';
+            for (std::size_t i = 0; i < st.size(); ++i)
+            {
+                if (i)
+                    out += ',';
+                append_string(out, stats::name(static_cast<stats::StatTypes>(i)));
+                out += ':' + std::to_string(st[i]);
+            }
+            out += '}';
+        }
+
+        sql_connection& m_sql; //!< Database, from which uncached players are loaded.
+        const leaderboard& m_leaders; //!< Leaderboard of the server.
+        std::unordered_map<std::string, entry> m_players; //!< Cached players by their names.
+        std::unordered_map<std::string, std::chrono::steady_clock::time_point> m_unknown; //!< Names, which were not found, with time of lookup.
+        std::map<std::pair<int, std::size_t>, std::pair<std::uint64_t, snapshot>> m_tops; //!< Leaderboard snapshots by board and count, with version of leaderboard.
+};
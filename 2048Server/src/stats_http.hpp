@@ -0,0 +1,252 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <istream>
+#include <cctype>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include "../../Common/main.hpp"
+#include "stats_cache.hpp"
+#include "leaderboard.hpp"
+#include "overload_monitor.hpp"
+#include "timer_wheel.hpp"
+#include "metrics.hpp"
+using boost::asio::ip::tcp;
+
+/**!
+    \ingroup server
+    \brief Read-only HTTP endpoint serving snapshots of \ref stats_cache as JSON.
+
+    Handles <em>GET /player?name=NAME</em> (global stats and stats of last session of a player) and
+    <em>GET /leaderboard?board=BOARD&count=N</em> (best results, see \ref leaderboards). Every connection
+    serves single request and is closed after the response, or after \ref REQUEST_SECONDS without complete request.
+    It runs on the event loop of the server, responses are shared snapshots, so a request costs no copy of the body.
+    When the server sheds load, players, who are not cached, are answered by 503 instead of querying database.
+    \sa stats_cache
+*/
+class stats_http
+{
+    public:
+        static const std::size_t MAX_REQUEST = 8192; //!< Most bytes of request line and headers.
+        static const int REQUEST_SECONDS = 5; //!< Seconds to receive complete request.
+        static const std::size_t DEFAULT_TOP = 10; //!< Results of leaderboard, when count is not given.
+
+        //! Starts accepting connections.
+        //! \param io_service reference to boost io_service.
+        //! \param endpoint endpoint to listen on.
+        //! \param cache snapshots to serve.
+        //! \param overload load shedding of the server.
+        //! \param timers timers of request timeouts.
+        stats_http(boost::asio::io_service& io_service, const tcp::endpoint& endpoint, stats_cache& cache, const overload_monitor& overload, timer_wheel& timers) :
+            m_io_service(io_service), m_acceptor(io_service, endpoint), m_cache(cache), m_overload(overload), m_timers(timers)
+        {
+            start_accept();
+        }
+
+    private:
+        //! Single request and its response.
+        class connection : public boost::enable_shared_from_this<connection>
+        {
+            public:
+                //! Constructs connection of the endpoint.
+                //! \param io_service reference to boost io_service.
+                //! \param owner endpoint, which routes the request.
+                connection(boost::asio::io_service& io_service, stats_http& owner) : m_socket(io_service), m_owner(owner), m_request(MAX_REQUEST) { }
+
+                //! Getter for socket. Used in \ref stats_http::start_accept.
+                //! \return reference to socket of this connection.
+                tcp::socket& socket() { return m_socket; }
+
+                //! Starts reading the request and its timeout.
+                void start()
+                {
+                    m_owner.m_timers.schedule(m_owner.m_timers.to_ticks(std::chrono::milliseconds(REQUEST_SECONDS * 1000)),
+                        boost::bind(&connection::handle_timeout, boost::weak_ptr<connection>(shared_from_this())));
+                    boost::asio::async_read_until(m_socket, m_request, "\r\n\r\n",
+                        boost::bind(&connection::handle_read, shared_from_this(), boost::asio::placeholders::error));
+                }
+
+            private:
+                //! Closes connection, which did not finish in time.
+                //! \param weak the connection, if it still exists.
+                static void handle_timeout(boost::weak_ptr<connection> weak)
+                {
+                    if (boost::shared_ptr<connection> conn = weak.lock())
+                    {
+                        boost::system::error_code ignored;
+                        conn->m_socket.close(ignored);
+                    }
+                }
+
+                //! Routes received request and writes the response.
+                //! \param error error code that happened during the read, including too long request.
+                void handle_read(const boost::system::error_code& error)
+                {
+                    if (error)
+                        return;
+                    metrics::increment(metrics::HTTP_REQUESTS);
+                    std::istream in(&m_request);
+                    std::string method, target;
+                    in >> method >> target;
+                    stats_cache::snapshot body;
+                    int status = m_owner.route(method, target, body);
+
+                    m_header = "HTTP/1.0 " + status_line(status) + "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body->size()) +
+                        (status == 503 ? "\r\nRetry-After: 1" : "") + "\r\nConnection: close\r\n\r\n";
+                    m_body = std::move(body);
+                    std::vector<boost::asio::const_buffer> buffers{ boost::asio::buffer(m_header), boost::asio::buffer(*m_body) };
+                    boost::asio::async_write(m_socket, buffers, boost::bind(&connection::handle_write, shared_from_this(), boost::asio::placeholders::error));
+                }
+
+                //! Closes the connection after the response was written.
+                //! \param error error code that happened during the write.
+                void handle_write(const boost::system::error_code& error)
+                {
+                    boost::system::error_code ignored;
+                    if (!error)
+                        m_socket.shutdown(tcp::socket::shutdown_both, ignored);
+                    m_socket.close(ignored);
+                }
+
+                //! Gets status line of response.
+                //! \param status HTTP status code.
+                //! \return code and reason phrase.
+                static std::string status_line(int status)
+                {
+                    switch (status)
+                    {
+                        case 200: return "200 OK";
+                        case 400: return "400 Bad Request";
+                        case 404: return "404 Not Found";
+                        case 405: return "405 Method Not Allowed";
+                        case 503: return "503 Service Unavailable";
+                        default: return "500 Internal Server Error";
+                    }
+                }
+
+                tcp::socket m_socket; //!< Socket of the connection.
+                stats_http& m_owner; //!< Endpoint, which accepted the connection.
+                boost::asio::streambuf m_request; //!< Received request, limited to \ref MAX_REQUEST bytes.
+                std::string m_header; //!< Status line and headers of the response.
+                stats_cache::snapshot m_body; //!< Body of the response, kept until it is written.
+        };
+
+        //! Starts accepting one connection.
+        void start_accept()
+        {
+            boost::shared_ptr<connection> conn(new connection(m_io_service, *this));
+            m_acceptor.async_accept(conn->socket(), boost::bind(&stats_http::handle_accept, this, conn, boost::asio::placeholders::error));
+        }
+
+        //! Starts the accepted connection and accepts next one.
+        //! \param conn the connection.
+        //! \param error error code that may happen during accept.
+        void handle_accept(boost::shared_ptr<connection> conn, const boost::system::error_code& error)
+        {
+            if (!error)
+                conn->start();
+            start_accept();
+        }
+
+        //! Finds response to a request.
+        //! \param method method of the request.
+        //! \param target path and query of the request.
+        //! \param body the response.
+        //! \return HTTP status code.
+        int route(const std::string& method, const std::string& target, stats_cache::snapshot& body)
+        {
+            if (method != "GET")
+                return error(405, "only GET is supported", body);
+            std::size_t query_pos = target.find('?');
+            std::string path = target.substr(0, query_pos);
+            std::string name, board_str, count_str;
+            if (query_pos != std::string::npos)
+                for (const auto& param : split(target.substr(query_pos + 1), '&'))
+                {
+                    std::size_t eq = param.find('=');
+                    std::string key = param.substr(0, eq), value = eq != std::string::npos ? decode(param.substr(eq + 1)) : "";
+                    if (key == "name")
+                        name = value;
+                    else if (key == "board")
+                        board_str = value;
+                    else if (key == "count")
+                        count_str = value;
+                }
+
+            if (path == "/player")
+            {
+                try
+                {
+                    if (!m_cache.player(name, m_overload.level() < overload_monitor::SHED_LOGINS, body))
+                        return error(503, "server is overloaded", body);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Failed to load stats of '" << name << "': " << e.what() << std::endl;
+                    return error(500, "database error", body);
+                }
+                return body ? 200 : error(404, "unknown player", body);
+            }
+            if (path == "/leaderboard")
+            {
+                leaderboard::Boards board;
+                std::size_t count = DEFAULT_TOP;
+                try
+                {
+                    if (!leaderboard::parse_board(board_str, board) || (!count_str.empty() && (count = std::stoul(count_str)) == 0))
+                        throw std::invalid_argument("board");
+                }
+                catch (std::logic_error&)
+                {
+                    return error(400, "invalid board or count", body);
+                }
+                body = m_cache.top(board, count);
+                return 200;
+            }
+            return error(404, "unknown path", body);
+        }
+
+        //! Makes error response.
+        //! \param status HTTP status code.
+        //! \param reason description of the error.
+        //! \param body the response.
+        //! \return \a status.
+        static int error(int status, const std::string& reason, stats_cache::snapshot& body)
+        {
+            std::string res = "{\"error\":";
+            stats_cache::append_string(res, reason);
+            res += "}";
+            body = std::make_shared<const std::string>(std::move(res));
+            return status;
+        }
+
+        //! Decodes percent-encoded query value.
+        //! \param value the value.
+        //! \return decoded value.
+        static std::string decode(const std::string& value)
+        {
+            std::string res;
+            for (std::size_t i = 0; i < value.size(); ++i)
+            {
+                if (value[i] == '+')
+                    res += ' ';
+                else if (value[i] == '%' && i + 2 < value.size() && std::isxdigit(static_cast<unsigned char>(value[i + 1])) && std::isxdigit(static_cast<unsigned char>(value[i + 2])))
+                {
+                    res += static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16));
+                    i += 2;
+                }
+                else
+                    res += value[i];
+            }
+            return res;
+        }
+
+        boost::asio::io_service& m_io_service; //!< Reference to boost io_service.
+        tcp::acceptor m_acceptor; //!< Acceptor of HTTP connections.
+        stats_cache& m_cache; //!< Served snapshots.
+        const overload_monitor& m_overload; //!< Load shedding, which disables loading from database.
+        timer_wheel& m_timers; //!< Timers of request timeouts.
+};
@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+
+/**!
+    \ingroup server
+    \brief Hierarchical timer wheel driven by single asio timer.
+
+    Time is measured in ticks. Timers expiring within \ref SLOTS ticks are stored in the first level,
+    indexed by their expiration tick. Each further level covers \ref SLOTS times longer range with the same
+    number of slots and its slots are cascaded into lower levels when the lower level wraps around.
+    Scheduling and expiring a timer is O(1), there is no cancellation: callbacks are expected to check,
+    whether they are still relevant (e.g. by holding weak pointer to their owner and its own deadline).
+*/
+class timer_wheel
+{
+    public:
+        using callback = std::function<void()>; //!< Function called, when the timer expires.
+
+        static const int LEVEL_BITS = 6; //!< Bits of tick used to index single level.
+        static const std::uint64_t SLOTS = 1 << LEVEL_BITS; //!< Slots of each level.
+        static const int LEVELS = 4; //!< Number of levels.
+        static const std::uint64_t MAX_TICKS = (1ULL << (LEVEL_BITS * LEVELS)) - 1; //!< Longest delay, longer ones are clamped.
+
+        //! Constructs the wheel and starts ticking.
+        //! \param io_service reference to boost io_service.
+        //! \param tick duration of one tick.
+        timer_wheel(boost::asio::io_service& io_service, std::chrono::milliseconds tick) :
+            m_timer(io_service), m_tick(tick), m_start(std::chrono::steady_clock::now()), m_now(0), m_size(0)
+        {
+            start_tick();
+        }
+
+        //! Schedules a timer.
+        //! \param ticks number of ticks until the timer expires, at least 1. Delays longer than \ref MAX_TICKS are clamped.
+        //! \param cb callback called, when the timer expires.
+        void schedule(std::uint64_t ticks, callback cb)
+        {
+            ticks = std::min(std::max<std::uint64_t>(ticks, 1), static_cast<std::uint64_t>(MAX_TICKS));
+            insert(entry{ m_now + ticks, std::move(cb) });
+            ++m_size;
+        }
+
+        //! Converts duration into ticks, rounding up.
+        //! \param duration duration to convert.
+        //! \return number of ticks.
+        std::uint64_t to_ticks(std::chrono::milliseconds duration) const
+        {
+            return (duration.count() + m_tick.count() - 1) / m_tick.count();
+        }
+
+        //! Gets current tick.
+        //! \return number of ticks since the wheel was constructed.
+        std::uint64_t now() const { return m_now; }
+
+        //! Gets number of scheduled timers.
+        //! \return number of timers, which did not expire yet.
+        std::size_t size() const { return m_size; }
+
+    private:
+        //! Scheduled timer.
+        struct entry
+        {
+            std::uint64_t expires; //!< Tick, when the timer expires.
+            callback cb; //!< Function to call.
+        };
+
+        //! Puts timer into slot by its distance from current tick.
+        //! \param e timer to insert.
+        void insert(entry&& e)
+        {
+            std::uint64_t delta = e.expires - m_now;
+            int level = 0;
+            while (level < LEVELS - 1 && delta >= (1ULL << (LEVEL_BITS * (level + 1))))
+                ++level;
+            m_slots[level][(e.expires >> (LEVEL_BITS * level)) & (SLOTS - 1)].push_back(std::move(e));
+        }
+
+        //! Schedules next tick.
+        void start_tick()
+        {
+            m_timer.expires_from_now(boost::posix_time::milliseconds(m_tick.count()));
+            m_timer.async_wait(boost::bind(&timer_wheel::handle_tick, this, boost::asio::placeholders::error));
+        }
+
+        //! Advances the wheel to current time, possibly by several ticks if the server was busy.
+        //! \param error error code that may happen during waiting.
+        void handle_tick(const boost::system::error_code& error)
+        {
+            if (error)
+                return;
+            std::uint64_t target = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count() / m_tick.count();
+            while (m_now < target)
+                advance();
+            start_tick();
+        }
+
+        //! Advances the wheel by one tick, cascades higher levels and fires expired timers.
+        void advance()
+        {
+            ++m_now;
+            int level = 0; // highest level, which has to be cascaded
+            while (level < LEVELS - 1 && ((m_now >> (LEVEL_BITS * level)) & (SLOTS - 1)) == 0)
+                ++level;
+            for (; level > 0; --level)
+            {
+                std::vector<entry> slot;
+                slot.swap(m_slots[level][(m_now >> (LEVEL_BITS * level)) & (SLOTS - 1)]);
+                for (auto& e : slot)
+                    insert(std::move(e));
+            }
+
+            std::vector<entry> expired;
+            expired.swap(m_slots[0][m_now & (SLOTS - 1)]); // callbacks may schedule new timers
+            m_size -= expired.size();
+            for (auto& e : expired)
+                e.cb();
+        }
+
+        boost::asio::deadline_timer m_timer; //!< Timer driving the wheel.
+        std::chrono::milliseconds m_tick; //!< Duration of one tick.
+        std::chrono::steady_clock::time_point m_start; //!< Time of tick 0.
+        std::uint64_t m_now; //!< Current tick.
+        std::size_t m_size; //!< Number of scheduled timers.
+        std::vector<entry> m_slots[LEVELS][SLOTS]; //!< Timers of each level and slot.
+};
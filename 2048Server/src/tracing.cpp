@@ -0,0 +1,183 @@
+#include "tracing.hpp"
+
+#ifdef ENABLE_TRACING
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    //! Span stored in thread buffer.
+    struct event
+    {
+        const char* name;
+        std::uint64_t begin;
+        std::uint64_t end;
+        std::uint64_t request;
+    };
+
+    //! Ring buffer of spans recorded by single thread.
+    struct thread_buffer
+    {
+        static const std::size_t CAPACITY = 1 << 16;
+
+        thread_buffer(std::size_t id) : tid(id), next(0), events(CAPACITY) { }
+
+        std::mutex mutex; // uncontended, except during export
+        std::size_t tid;
+        std::size_t next;
+        std::vector<event> events;
+    };
+
+    std::mutex buffers_mutex;
+    std::vector<std::unique_ptr<thread_buffer>> buffers;
+    std::atomic<std::uint64_t> last_request_id(0);
+
+    std::mutex slow_log_mutex;
+    std::uint64_t slow_threshold_ns = 0;
+    std::string slow_log_file;
+
+    thread_buffer& local_buffer()
+    {
+        static thread_local thread_buffer* buffer = nullptr;
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            buffers.emplace_back(new thread_buffer(buffers.size() + 1));
+            buffer = buffers.back().get();
+        }
+        return *buffer;
+    }
+}
+
+namespace tracing
+{
+    void configure(std::uint64_t slow_threshold_us, const std::string& log_file)
+    {
+        std::lock_guard<std::mutex> lock(slow_log_mutex);
+        slow_threshold_ns = slow_threshold_us * 1000;
+        slow_log_file = log_file;
+    }
+
+    bool enabled() { return true; }
+
+    std::uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void record(const char* name, std::uint64_t begin, std::uint64_t end, std::uint64_t request)
+    {
+        thread_buffer& buffer = local_buffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.events[buffer.next % thread_buffer::CAPACITY] = { name, begin, end, request };
+        ++buffer.next;
+    }
+
+    request_trace*& current()
+    {
+        static thread_local request_trace* trace = nullptr;
+        return trace;
+    }
+
+    void request_trace::begin(const char* wait_name)
+    {
+        std::uint64_t t = now();
+        m_id = ++last_request_id;
+        if (m_stamp)
+            record(wait_name, m_stamp, t, 0);
+        m_begin = m_stamp = t;
+        m_count = 0;
+        m_responded = false;
+        m_label[0] = '\0';
+    }
+
+    void request_trace::label(const char* data, std::size_t length)
+    {
+        // only the type of the message, its arguments may be credentials or tokens
+        const char* type_end = static_cast<const char*>(std::memchr(data, '-', length));
+        length = type_end ? type_end - data + 1 : 0;
+        length = std::min(length, sizeof(m_label) - 1);
+        std::memcpy(m_label, data, length);
+        m_label[length] = '\0';
+    }
+
+    void request_trace::add(const char* name, std::uint64_t begin, std::uint64_t end)
+    {
+        record(name, begin, end, m_id);
+        if (m_id && m_count < MAX_SPANS)
+        {
+            m_spans[m_count].name = name;
+            m_spans[m_count].begin = begin;
+            m_spans[m_count].end = end;
+            ++m_count;
+        }
+    }
+
+    void request_trace::finish()
+    {
+        if (!m_id)
+            return;
+        std::uint64_t total = now() - m_begin;
+        std::lock_guard<std::mutex> lock(slow_log_mutex);
+        if (slow_threshold_ns && total >= slow_threshold_ns && !slow_log_file.empty())
+        {
+            std::ofstream log(slow_log_file, std::ios::app);
+            log << "request " << m_id << " " << m_label << " total=" << total / 1000 << "us";
+            for (int i = 0; i < m_count; ++i)
+                log << " " << m_spans[i].name << "@" << (m_spans[i].begin - m_begin) / 1000 << "us=" << (m_spans[i].end - m_spans[i].begin) / 1000 << "us";
+            log << "\n";
+        }
+        m_id = 0;
+    }
+
+    bool export_chrome(const std::string& file)
+    {
+        std::string tmp = file + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            if (out.fail())
+                return false;
+
+            out << std::fixed;
+            out.precision(3);
+            out << "{\"traceEvents\":[";
+            bool first = true;
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            for (const auto& buffer : buffers)
+            {
+                std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+                std::size_t count = std::min<std::size_t>(buffer->next, static_cast<std::size_t>(thread_buffer::CAPACITY));
+                for (std::size_t i = buffer->next - count; i < buffer->next; ++i)
+                {
+                    const event& ev = buffer->events[i % thread_buffer::CAPACITY];
+                    out << (first ? "" : ",") << "\n{\"name\":\"" << ev.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                        << ",\"ts\":" << ev.begin / 1000.0 << ",\"dur\":" << (ev.end - ev.begin) / 1000.0
+                        << ",\"args\":{\"request\":" << ev.request << "}}";
+                    first = false;
+                }
+            }
+            out << "\n]}\n";
+            if (out.fail())
+                return false;
+        }
+#ifdef _WIN32
+        std::remove(file.c_str()); // rename does not overwrite on windows
+#endif
+        return std::rename(tmp.c_str(), file.c_str()) == 0;
+    }
+}
+#else
+namespace tracing
+{
+    void configure(std::uint64_t, const std::string&) { }
+    bool export_chrome(const std::string&) { return false; }
+    bool enabled() { return false; }
+}
+#endif
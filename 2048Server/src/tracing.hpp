@@ -0,0 +1,165 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+    \ingroup server
+    \brief Lightweight request tracing.
+
+    Tracing is compiled in only when \c ENABLE_TRACING is defined (see \c WITH-TRACING in Makefile).
+    Otherwise \ref TRACE_SPAN expands to nothing and \ref tracing::request_trace is an empty class,
+    whose methods are empty inline functions.
+
+    Spans are recorded with monotonic timestamps into per-thread ring buffers, which can be exported
+    in Chrome trace format (chrome://tracing). Spans of a single request are also collected in its
+    \ref tracing::request_trace and if the request takes longer than configured threshold, its full
+    breakdown is written into slow request log.
+*/
+namespace tracing
+{
+    //! Configures tracing. Does nothing when tracing is not compiled in.
+    //! \param slow_threshold_us requests taking longer (in microseconds) are written into slow request log. 0 disables the log.
+    //! \param slow_log_file path to slow request log.
+    void configure(std::uint64_t slow_threshold_us, const std::string& slow_log_file);
+
+    //! Exports spans of all threads in Chrome trace format. Does nothing when tracing is not compiled in.
+    //! \param file path to the file.
+    //! \return true on success, false otherwise.
+    bool export_chrome(const std::string& file);
+
+    //! Tells whether tracing is compiled in.
+    //! \return true if \c ENABLE_TRACING was defined.
+    bool enabled();
+
+#ifdef ENABLE_TRACING
+    //! Gets monotonic time.
+    //! \return nanoseconds of monotonic clock.
+    std::uint64_t now();
+
+    //! Records span into buffer of calling thread.
+    //! \param name static name of the span.
+    //! \param begin start of the span (\ref now).
+    //! \param end end of the span (\ref now).
+    //! \param request id of request the span belongs to, 0 if none.
+    void record(const char* name, std::uint64_t begin, std::uint64_t end, std::uint64_t request);
+
+    /**!
+        \brief Spans of single request, from reading its header until its response is written.
+    */
+    class request_trace
+    {
+        public:
+            static const int MAX_SPANS = 16; //!< Maximal number of spans kept for slow request log.
+
+            request_trace() : m_id(0), m_begin(0), m_stamp(0), m_count(0), m_responded(false) { m_label[0] = '\0'; }
+
+            //! Remembers current time as beginning of next asynchronous span.
+            void stamp() { m_stamp = now(); }
+
+            //! Starts new request. Time since last \ref stamp is recorded as \a wait_name span outside of the request.
+            //! \param wait_name name of span for waiting for the request.
+            void begin(const char* wait_name);
+
+            //! Sets label of the request used in slow request log.
+            //! \param data message body, only its type up to and including the first '-' is kept, so arguments
+            //! such as password hashes or resume tokens are never logged. Body without type gives empty label.
+            //! \param length length of \a data.
+            void label(const char* data, std::size_t length);
+
+            //! Adds span from last \ref stamp until now and stamps again.
+            //! \param name static name of the span.
+            void span_since_stamp(const char* name) { std::uint64_t t = now(); add(name, m_stamp, t); m_stamp = t; }
+
+            //! Adds finished span to the request.
+            //! \param name static name of the span.
+            //! \param begin start of the span.
+            //! \param end end of the span.
+            void add(const char* name, std::uint64_t begin, std::uint64_t end);
+
+            //! Marks, that response to the request was queued, so the request ends after it is written.
+            //! Stamps the time, so writing of the response can be measured by \ref span_since_stamp.
+            void responded() { if (m_id) { m_responded = true; m_stamp = now(); } }
+
+            //! Tells whether response to the request was queued.
+            //! \return true if \ref responded was called since \ref begin.
+            bool has_response() const { return m_responded; }
+
+            //! Finishes the request and writes it into slow request log if it took too long.
+            void finish();
+
+        private:
+            std::uint64_t m_id; //!< Request id, 0 when no request is traced.
+            std::uint64_t m_begin; //!< Time of beginning of the request.
+            std::uint64_t m_stamp; //!< Beginning of current asynchronous span.
+            struct { const char* name; std::uint64_t begin; std::uint64_t end; } m_spans[MAX_SPANS]; //!< Spans of the request.
+            int m_count; //!< Number of spans in \ref m_spans.
+            bool m_responded; //!< Indicates, that response was queued.
+            char m_label[16]; //!< Label of the request.
+    };
+
+    //! Gets request traced by calling thread.
+    //! \return reference to thread-local pointer to current request, nullptr if none.
+    request_trace*& current();
+
+    /**!
+        \brief Sets current request of the thread for its lifetime.
+    */
+    class scoped_request
+    {
+        public:
+            //! \param trace request being processed.
+            explicit scoped_request(request_trace& trace) : m_previous(current()) { current() = &trace; }
+            ~scoped_request() { current() = m_previous; }
+
+        private:
+            request_trace* m_previous; //!< Previously current request.
+    };
+
+    /**!
+        \brief Records span of its lifetime into current request (or thread buffer if there is none).
+    */
+    class scoped_span
+    {
+        public:
+            //! \param name static name of the span.
+            explicit scoped_span(const char* name) : m_name(name), m_begin(now()) { }
+            ~scoped_span()
+            {
+                if (request_trace* trace = current())
+                    trace->add(m_name, m_begin, now());
+                else
+                    record(m_name, m_begin, now(), 0);
+            }
+
+        private:
+            const char* m_name; //!< Name of the span.
+            std::uint64_t m_begin; //!< Start of the span.
+    };
+
+    #define TRACE_CONCAT_IMPL(a, b) a##b
+    #define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+    //! Records span from this point until the end of enclosing scope.
+    #define TRACE_SPAN(name) ::tracing::scoped_span TRACE_CONCAT(trace_span_, __LINE__)(name)
+    //! Makes \a trace current request until the end of enclosing scope.
+    #define TRACE_REQUEST(trace) ::tracing::scoped_request TRACE_CONCAT(trace_request_, __LINE__)(trace)
+#else
+    /**!
+        \brief Empty request trace used when tracing is not compiled in.
+    */
+    class request_trace
+    {
+        public:
+            void stamp() { }
+            void begin(const char*) { }
+            void label(const char*, std::size_t) { }
+            void span_since_stamp(const char*) { }
+            void responded() { }
+            bool has_response() const { return false; }
+            void finish() { }
+    };
+
+    #define TRACE_SPAN(name) do { } while (0)
+    #define TRACE_REQUEST(trace) do { } while (0)
+#endif
+}
@@ -3,4 +3,5 @@
     define('DB_USER', 'user');
     define('DB_PASS', 'pass');
     define('DB_NAME', '2048');
+    define('STATS_URL', 'http://127.0.0.1:8882'); // stats endpoint of the server (stats_port), empty to query database directly
 ?>
@@ -1,42 +1,89 @@
 <?php
 require_once('config.php');
 
-$con = new mysqli(DB_HOST, DB_USER, DB_PASS, DB_NAME);
-if ($con->connect_errno > 0)
-    die("Failed to connect to MySQL: " . $con->connect_error);
-
+function print_table($rows, $title)
+{
+    echo "<table border=1 style=\"display: inline-block;\">";
+    echo "<tr><td colspan=2 align=\"center\">$title</td></tr>";
+    echo "<tr><td>Statistics</td><td>Value</td></tr>";
+    foreach ($rows as $name => $value)
+    {
+        echo "<tr><td>".$name."</td><td>".$value."</td></tr>";
+    }    
+    echo "</table>";
+}
 
 function print_stats($con, $id, $table, $title)
 {
     if (!$res = $con->query("SELECT sd.name AS name, s.value AS value FROM $table AS s JOIN stats_definitions sd ON sd.id = s.stats_id WHERE player_id = $id;"))
         die('There was an error running the query [' . $con->error . ']');
     
-    echo "<table border=1 style=\"display: inline-block;\">";
-    echo "<tr><td colspan=2 align=\"center\">$title</td></tr>";
-    echo "<tr><td>Statistics</td><td>Value</td></tr>";
+    $rows = array();
     while ($row = $res->fetch_assoc())
     {
-        echo "<tr><td>".$row['name']."</td><td>".$row['value']."</td></tr>";
+        $rows[$row['name']] = $row['value'];
     }    
-    echo "</table>";
+    print_table($rows, $title);
+}
+
+define('STATS_UNAVAILABLE', 'unavailable');
+
+// Gets stats from endpoint of the server (stats_port), so page views do not query the database.
+// Returns decoded stats, false for unknown player, null if STATS_URL is not configured, or STATS_UNAVAILABLE
+// if the endpoint does not answer in time or sheds load (503). The database is not queried then, because
+// the server is overloaded or down and page views should not add to it.
+function fetch_stats($user)
+{
+    if (!defined('STATS_URL') || STATS_URL == '')
+        return null;
+    $ctx = stream_context_create(array('http' => array('timeout' => 1, 'ignore_errors' => true)));
+    $res = @file_get_contents(STATS_URL . '/player?name=' . urlencode($user), false, $ctx);
+    if ($res === false || !isset($http_response_header[0]))
+        return STATS_UNAVAILABLE;
+    if (strpos($http_response_header[0], ' 404 ') !== false)
+        return false;
+    if (strpos($http_response_header[0], ' 200 ') === false)
+        return STATS_UNAVAILABLE;
+    $stats = json_decode($res, true);
+    return $stats === null ? STATS_UNAVAILABLE : $stats;
 }
 
 if(isset($_POST['submit']))
 {
 	$user = $_POST['user'];
-     
-    if (!$res = $con->query("SELECT id FROM users WHERE name = '$user'"))
-        die('There was an error running the query [' . $con->error . ']');
 
-    if ($res->num_rows != 0)
+    $stats = fetch_stats($user);
+    if ($stats === false)
+        echo "No stats for user $user.";
+    else if ($stats === STATS_UNAVAILABLE)
     {
-        $row = $res->fetch_assoc();
-        $id = $row['id'];
-        
-        print_stats($con, $id, "stats_global", "Global statistics");
-        print_stats($con, $id, "stats_current", "Stats for last session");
+        header('Retry-After: 1', true, 503);
+        echo "Stats are not available right now, please try again later.";
+    }
+    else if ($stats !== null)
+    {
+        print_table($stats['global'], "Global statistics");
+        print_table($stats['current'], "Stats for last session");
     }
     else
-        echo "No stats for user $user.";
+    {
+        $con = new mysqli(DB_HOST, DB_USER, DB_PASS, DB_NAME);
+        if ($con->connect_errno > 0)
+            die("Failed to connect to MySQL: " . $con->connect_error);
+
+        if (!$res = $con->query("SELECT id FROM users WHERE name = '$user'"))
+            die('There was an error running the query [' . $con->error . ']');
+
+        if ($res->num_rows != 0)
+        {
+            $row = $res->fetch_assoc();
+            $id = $row['id'];
+            
+            print_stats($con, $id, "stats_global", "Global statistics");
+            print_stats($con, $id, "stats_current", "Stats for last session");
+        }
+        else
+            echo "No stats for user $user.";
+    }
 }
 ?>
@@ -0,0 +1,214 @@
+#pragma once
+#include <vector>
+#include <random>
+#include <cstdint>
+#include "main.hpp"
+#include "play_event.hpp"
+
+/**!
+    \ingroup common
+    \brief Game engine: board of blocks, score and generator of spawned blocks.
+
+    Spawned blocks are drawn only from generator of the board, so a game is fully determined by
+    the seed of the board, its starting position and the sequence of played directions.
+    This is what \ref game_archive relies on, when it stores games without their boards.
+    \sa player_data, game_archive
+*/
+class board
+{
+    public:
+        using grid = std::vector<std::vector<Blocks>>; //!< Blocks indexed by x and y coords.
+
+        //! Constructs empty board. Generator has default seed until \ref seed is called.
+        board() : m_rects(BLOCK_COUNT_X, std::vector<Blocks>(BLOCK_COUNT_Y, BLOCK_0)), m_won(false), m_score(0) { }
+
+        //! Reseeds generator of spawned blocks.
+        //! \param seed new seed.
+        void seed(std::uint32_t seed) { m_random.seed(seed); }
+
+        //! Clears the board and spawns starting blocks.
+        //! \return vector of blocks placed on the board.
+        std::vector<random_block_record> restart()
+        {
+            m_score = 0;
+            m_won = false;
+            m_rects = grid(BLOCK_COUNT_X, std::vector<Blocks>(BLOCK_COUNT_Y, BLOCK_0));
+            std::vector<random_block_record> res;
+            for (std::size_t i = 0; i < DEFAULT_START_BLOCKS; ++i)
+                res.push_back(random_block());
+            return res;
+        }
+
+        //! Plays one turn, i.e. moves and merges blocks in given direction and spawns random block if anything moved.
+        //! \param direction direction of the turn.
+        //! \param event event to append operations of the turn to, nullptr if they are not needed (e.g. in replays).
+        //! \return true if any block moved, false otherwise.
+        bool play(Directions direction, play_event* event = nullptr)
+        {
+            bool played = false;
+            auto move = [&](std::size_t from_x, std::size_t from_y, std::size_t to_x, std::size_t to_y)
+            {
+                m_rects[to_x][to_y] = m_rects[from_x][from_y];
+                m_rects[from_x][from_y] = BLOCK_0;
+                played = true;
+                if (event)
+                    event->move_to(from_x, from_y, to_x, to_y);
+            };
+            auto merge = [&](std::size_t from_x, std::size_t from_y, std::size_t to_x, std::size_t to_y)
+            {
+                m_rects[from_x][from_y] = BLOCK_0;
+                if (++m_rects[to_x][to_y] == WINNING_BLOCK)
+                    m_won = true;
+                m_score += pow2(m_rects[to_x][to_y]);
+                played = true;
+                if (event)
+                {
+                    event->merge_to(from_x, from_y, to_x, to_y);
+                    event->score(pow2(m_rects[to_x][to_y]));
+                }
+            };
+
+            switch (direction)
+            {
+            case LEFT:
+                for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
+                    for (std::size_t x = 1; x < BLOCK_COUNT_X; ++x)
+                    {
+                        if (m_rects[x][y] == 0)
+                            continue;
+                        std::size_t i = x;
+                        while (i > 0 && m_rects[--i][y] == 0); // find closest block
+                        if (m_rects[x][y] == m_rects[i][y])
+                            merge(x, y, i, y);
+                        else if (m_rects[i][y] == 0 || m_rects[++i][y] == 0)
+                            move(x, y, i, y);
+                    }
+                break;
+            case RIGHT:
+                for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
+                    for (int x = BLOCK_COUNT_X - 2; x >= 0; --x)
+                    {
+                        if (m_rects[x][y] == 0)
+                            continue;
+                        std::size_t i = x;
+                        while (i < BLOCK_COUNT_X - 1 && m_rects[++i][y] == 0);
+                        if (m_rects[x][y] == m_rects[i][y])
+                            merge(x, y, i, y);
+                        else if (m_rects[i][y] == 0 || m_rects[--i][y] == 0)
+                            move(x, y, i, y);
+                    }
+                break;
+            case UP:
+                for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
+                    for (std::size_t y = 1; y < BLOCK_COUNT_Y; ++y)
+                    {
+                        if (m_rects[x][y] == 0)
+                            continue;
+                        std::size_t i = y;
+                        while (i > 0 && m_rects[x][--i] == 0); // find closest block
+                        if (m_rects[x][y] == m_rects[x][i])
+                            merge(x, y, x, i);
+                        else if (m_rects[x][i] == 0 || m_rects[x][++i] == 0)
+                            move(x, y, x, i);
+                    }
+                break;
+            case DOWN:
+                for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
+                    for (int y = BLOCK_COUNT_Y - 2; y >= 0; --y)
+                    {
+                        if (m_rects[x][y] == 0)
+                            continue;
+                        std::size_t i = y;
+                        while (i < BLOCK_COUNT_Y - 1 && m_rects[x][++i] == 0);
+                        if (m_rects[x][y] == m_rects[x][i])
+                            merge(x, y, x, i);
+                        else if (m_rects[x][i] == 0 || m_rects[x][--i] == 0)
+                            move(x, y, x, i);
+                    }
+                break;
+            }
+
+            if (played)
+            {
+                random_block_record spawned = random_block();
+                if (event)
+                    event->random_block(std::move(spawned));
+            }
+            return played;
+        }
+
+        //! Checks whether any move is possible.
+        //! \return true if no block can move in any direction, false otherwise.
+        bool is_game_over() const
+        {
+            for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
+                for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
+                {
+                    if (m_rects[x][y] == 0)
+                        return false;
+                    if (x + 1 < BLOCK_COUNT_X && m_rects[x][y] == m_rects[x + 1][y])
+                        return false;
+                    if (y + 1 < BLOCK_COUNT_Y && m_rects[x][y] == m_rects[x][y + 1])
+                        return false;
+                }
+            return true;
+        }
+
+        //! Gets the biggest block on the board.
+        //! \return the block.
+        Blocks max_block() const
+        {
+            Blocks res = BLOCK_0;
+            for (const auto& row : m_rects)
+                for (Blocks val : row)
+                    if (val > res)
+                        res = val;
+            return res;
+        }
+
+        //! Getter for \ref m_rects.
+        //! \return blocks of the board.
+        const grid& rects() const { return m_rects; }
+        //! Places block on the board.
+        //! \param x x coord of the block.
+        //! \param y y coord of the block.
+        //! \param block the block.
+        void set(std::size_t x, std::size_t y, Blocks block) { m_rects[x][y] = block; }
+
+        //! Getter for \ref m_won.
+        //! \return true if \ref WINNING_BLOCK was reached.
+        bool won() const { return m_won; }
+        //! Setter for \ref m_won.
+        //! \param won new won status.
+        void set_won(bool won) { m_won = won; }
+
+        //! Getter for \ref m_score.
+        //! \return score of the game.
+        int score() const { return m_score; }
+        //! Setter for \ref m_score.
+        //! \param score new score.
+        void set_score(int score) { m_score = score; }
+
+    private:
+        //! Spawns random block on an empty spot.
+        //! \return Pair of \ref Blocks and coords where it was spawned.
+        random_block_record random_block()
+        {
+            coords empty[BLOCK_COUNT_X * BLOCK_COUNT_Y];
+            std::size_t count = 0;
+            for (std::size_t x = 0; x < BLOCK_COUNT_X; ++x)
+                for (std::size_t y = 0; y < BLOCK_COUNT_Y; ++y)
+                    if (m_rects[x][y] == 0)
+                        empty[count++] = coords(x, y);
+            coords pos = empty[m_random() % count];
+            Blocks block = chance(BLOCK_4_SPAWN_CHANCE, m_random) ? BLOCK_4 : BLOCK_2;
+
+            m_rects[pos.first][pos.second] = block;
+            return { block, pos };
+        }
+
+        grid m_rects; //!< Blocks of the board.
+        bool m_won; //!< Indicates whether \ref WINNING_BLOCK was reached.
+        int m_score; //!< Score of the game.
+        std::mt19937 m_random; //!< Generator of spawned blocks.
+};
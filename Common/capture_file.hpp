@@ -0,0 +1,215 @@
+#pragma once
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <cstdint>
+#include <chrono>
+#include <stdexcept>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+#endif
+#include "main.hpp"
+
+/**!
+    \ingroup common
+    \brief Binary file with captured traffic of the server.
+
+    File starts with \ref MAGIC followed by records. Each record is
+    <em>type (1 byte), session id (varint), time since previous record in microseconds (varint), payload</em>,
+    where payload of \ref MSG_IN and \ref MSG_OUT is <em>length (varint), body</em> and payload of \ref SEED is <em>seed (varint)</em>.
+    Other records have no payload. Secrets are not captured, see \ref redact.
+    \sa capture_writer, capture_reader
+*/
+namespace capture_file
+{
+    static const char MAGIC[8] = { '2', '0', '4', '8', 'C', 'A', 'P', '1' }; //!< Beginning of capture file.
+
+    //! Types of records.
+    enum RecordTypes
+    {
+        OPEN = 0, //!< Session was opened.
+        MSG_IN = 1, //!< Message received from client.
+        MSG_OUT = 2, //!< Message sent to client.
+        SEED = 3, //!< Seed of random generator of the session was set.
+        CLOSE = 4, //!< Session was closed.
+    };
+
+    //! Single record of capture file.
+    struct record
+    {
+        RecordTypes type; //!< Type of the record.
+        std::uint64_t session; //!< Id of the session.
+        std::uint64_t time; //!< Microseconds since beginning of capture.
+        std::string body; //!< Message body of \ref MSG_IN and \ref MSG_OUT.
+        std::uint64_t seed; //!< Seed of \ref SEED.
+    };
+
+    //! Removes secrets from message body: password hash of \ref message_types::MSG_LOGIN (kept in form <em>LOG-user+</em>)
+    //! and tokens of \ref message_types::MSG_TOKEN_OK, \ref message_types::MSG_RESUME and \ref message_types::MSG_RESUME_OK (left empty).
+    //! \param body message body.
+    //! \return body without the secrets.
+    inline std::string redact(std::string body)
+    {
+        if (compare_msg(body, message_types::MSG_LOGIN))
+        {
+            std::size_t plus = body.find('+');
+            if (plus != std::string::npos)
+                body.erase(plus + 1);
+        }
+        else if (compare_msg(body, message_types::MSG_TOKEN_OK))
+            body.erase(std::min(body.size(), message_types::MSG_TOKEN_OK.length() + 1));
+        else if (compare_msg(body, message_types::MSG_RESUME) && body != message_types::MSG_RESUME_FAIL)
+        {
+            std::size_t start = compare_msg(body, message_types::MSG_RESUME_OK) ? message_types::MSG_RESUME_OK.length() + 1 : message_types::MSG_RESUME.length();
+            if (start <= body.size())
+                body.erase(start, body.find('+', start) - start);
+        }
+        return body;
+    }
+}
+
+/**!
+    \ingroup common
+    \brief Writes records into capture file.
+    \sa capture_file
+*/
+class capture_writer
+{
+    public:
+        //! Opens the file for writing. On POSIX the file is readable by its owner only, since it contains names of players and their moves.
+        //! \param file path to capture file, existing file is overwritten.
+        //! \throws std::runtime_error if file can not be opened.
+        explicit capture_writer(const std::string& file) : m_start(std::chrono::steady_clock::now()), m_last(0)
+        {
+            restrict_access(file);
+            m_out.open(file, std::ios::binary | std::ios::trunc);
+            if (m_out.fail())
+                throw std::runtime_error("Failed to open capture file '" + file + "'.");
+            m_out.write(capture_file::MAGIC, sizeof(capture_file::MAGIC));
+        }
+
+        //! Writes a record stamped with current time. Message bodies are written without secrets, see \ref capture_file::redact.
+        //! \param type type of the record.
+        //! \param session id of the session.
+        //! \param data message body for \ref capture_file::MSG_IN and \ref capture_file::MSG_OUT.
+        //! \param length length of \a data.
+        //! \param seed seed for \ref capture_file::SEED.
+        void write(capture_file::RecordTypes type, std::uint64_t session, const char* data = nullptr, std::size_t length = 0, std::uint64_t seed = 0)
+        {
+            std::uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+            m_out.put(static_cast<char>(type));
+            write_varint(session);
+            write_varint(time >= m_last ? time - m_last : 0);
+            m_last = std::max(time, m_last);
+            if (type == capture_file::MSG_IN || type == capture_file::MSG_OUT)
+            {
+                std::string body = capture_file::redact(std::string(data, length));
+                write_varint(body.size());
+                m_out.write(body.data(), body.size());
+            }
+            else if (type == capture_file::SEED)
+                write_varint(seed);
+        }
+
+        //! Flushes buffered records to the file.
+        void flush() { m_out.flush(); }
+
+    private:
+        //! Creates the file accessible by its owner only, or restricts access to existing one. Does nothing on windows.
+        //! \param file path to the file.
+        static void restrict_access(const std::string& file)
+        {
+#ifndef _WIN32
+            int fd = ::open(file.c_str(), O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
+            if (fd < 0)
+                return; // reported by opening of the stream
+            ::fchmod(fd, S_IRUSR | S_IWUSR);
+            ::close(fd);
+#endif
+        }
+
+        //! Writes unsigned integer as LEB128 varint.
+        //! \param value value to write.
+        void write_varint(std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                m_out.put(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            m_out.put(static_cast<char>(value));
+        }
+
+        std::ofstream m_out; //!< Capture file.
+        std::chrono::steady_clock::time_point m_start; //!< Beginning of capture.
+        std::uint64_t m_last; //!< Time of last record.
+};
+
+/**!
+    \ingroup common
+    \brief Reads records from capture file.
+    \sa capture_file
+*/
+class capture_reader
+{
+    public:
+        //! Opens the file for reading.
+        //! \param file path to capture file.
+        //! \throws std::runtime_error if file can not be opened or is not a capture file.
+        explicit capture_reader(const std::string& file) : m_in(file, std::ios::binary), m_time(0)
+        {
+            char magic[sizeof(capture_file::MAGIC)];
+            if (!m_in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), capture_file::MAGIC))
+                throw std::runtime_error("'" + file + "' is not a capture file.");
+        }
+
+        //! Reads next record.
+        //! \param rec record to read into.
+        //! \return true if record was read, false at the end of file.
+        //! \throws std::runtime_error if the file is truncated or corrupted.
+        bool next(capture_file::record& rec)
+        {
+            int type = m_in.get();
+            if (type == std::char_traits<char>::eof())
+                return false;
+            if (type > capture_file::CLOSE)
+                throw std::runtime_error("Corrupted capture file.");
+            rec.type = static_cast<capture_file::RecordTypes>(type);
+            rec.session = read_varint();
+            rec.time = m_time += read_varint();
+            rec.body.clear();
+            rec.seed = 0;
+            if (rec.type == capture_file::MSG_IN || rec.type == capture_file::MSG_OUT)
+            {
+                rec.body.resize(static_cast<std::size_t>(read_varint()));
+                if (!rec.body.empty() && !m_in.read(&rec.body[0], rec.body.size()))
+                    throw std::runtime_error("Truncated capture file.");
+            }
+            else if (rec.type == capture_file::SEED)
+                rec.seed = read_varint();
+            return true;
+        }
+
+    private:
+        //! Reads LEB128 varint.
+        //! \return read value.
+        std::uint64_t read_varint()
+        {
+            std::uint64_t res = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                int c = m_in.get();
+                if (c == std::char_traits<char>::eof())
+                    throw std::runtime_error("Truncated capture file.");
+                res |= static_cast<std::uint64_t>(c & 0x7f) << shift;
+                if (!(c & 0x80))
+                    return res;
+            }
+            throw std::runtime_error("Corrupted capture file.");
+        }
+
+        std::ifstream m_in; //!< Capture file.
+        std::uint64_t m_time; //!< Time of last read record.
+};
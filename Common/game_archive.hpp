@@ -0,0 +1,521 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "main.hpp"
+#include "board.hpp"
+
+/**!
+    \ingroup common
+    \brief Archive of all games played on the server.
+
+    A game is stored without any board: the seed of its \ref board, starting position (only for games resumed
+    from database, otherwise the board is restarted from the seed) and played directions packed by 2 bits,
+    so game of thousand moves takes about 270 bytes. Every game can be replayed by \ref replay.
+
+    The archive is a directory of segments. Segment <em>games-NNNNNN.dat</em> starts with \ref MAGIC followed
+    by records, each prefixed by its length (varint). Record is <em>flags (1 byte), player id, start time,
+    duration, [win time] (varints), seed (4 bytes), [start blocks (16 bytes), start score (varint)], final score (varint),
+    max block (1 byte), number of moves (varint), moves</em>, where win time is present only with \ref WON flag
+    and start blocks and score only with \ref RESUMED flag. Segment has index <em>games-NNNNNN.idx</em> of fixed size entries
+    <em>player id (4 bytes), length (4 bytes), offset (8 bytes), finish time (8 bytes)</em>, which are ordered
+    by finish time. Integers of fixed size are little endian, times are unix seconds.
+    \sa archive_writer, archive_segment, archive_reader
+*/
+namespace game_archive
+{
+    static const char MAGIC[8] = { '2', '0', '4', '8', 'A', 'R', 'C', '2' }; //!< Beginning of segment file.
+    static const std::size_t INDEX_ENTRY_SIZE = 24; //!< Size of single index entry.
+
+    //! Flags of a record.
+    enum Flags
+    {
+        RESUMED = 1, //!< Game started from stored position instead of restart.
+        START_WON = 2, //!< Stored starting position was already won.
+        WON = 4, //!< Game reached \ref WINNING_BLOCK, or started won and has a move.
+        LOST = 8, //!< Game ended with no possible move, otherwise it was restarted or the player left.
+    };
+
+    //! Single archived game.
+    struct record
+    {
+        record() : flags(0), player(0), start(0), duration(0), won_at(0), seed(0), start_score(0), final_score(0), max_block(BLOCK_0), moves(0) { start_blocks.fill(BLOCK_0); }
+
+        //! Appends played direction.
+        //! \param direction the direction.
+        void add_move(Directions direction)
+        {
+            if (moves % 4 == 0)
+                packed.push_back(0);
+            packed.back() |= static_cast<std::uint8_t>(direction) << (2 * (moves % 4));
+            ++moves;
+        }
+
+        //! Gets played direction.
+        //! \param i index of the move.
+        //! \return direction of the move.
+        Directions move(std::size_t i) const { return static_cast<Directions>((packed[i / 4] >> (2 * (i % 4))) & 3); }
+
+        std::uint8_t flags; //!< Combination of \ref Flags.
+        std::uint32_t player; //!< Id of the player.
+        std::uint64_t start; //!< Unix time of start of the game.
+        std::uint32_t duration; //!< Seconds from start of the game to its last move, so idle time after it is not included.
+        std::uint32_t won_at; //!< Seconds from start of the game to its first move, after which the game was won, with \ref WON flag only.
+                              //!< Moves in the first second are skipped, because stats::won does not count 0 as fastest win.
+        std::uint32_t seed; //!< Seed of the \ref board.
+        std::array<std::uint8_t, BLOCK_COUNT_X * BLOCK_COUNT_Y> start_blocks; //!< Starting blocks of \ref RESUMED game, x-major.
+        std::uint32_t start_score; //!< Starting score of \ref RESUMED game.
+        std::uint32_t final_score; //!< Score at the end of the game.
+        Blocks max_block; //!< Biggest block at the end of the game.
+        std::uint32_t moves; //!< Number of moves.
+        std::vector<std::uint8_t> packed; //!< Directions of moves, 4 moves per byte starting from low bits.
+    };
+
+    //! Location of a record in the archive.
+    struct location
+    {
+        std::uint32_t segment; //!< Number of the segment.
+        std::uint32_t index; //!< Index of the record in the segment.
+    };
+
+    //! Entry of segment index.
+    struct index_entry
+    {
+        std::uint32_t player; //!< Id of the player.
+        std::uint32_t length; //!< Length of the record.
+        std::uint64_t offset; //!< Offset of the record in segment (after its length prefix).
+        std::uint64_t time; //!< Unix time of end of the game.
+    };
+
+    //! Gets path of segment file.
+    //! \param dir directory of the archive.
+    //! \param segment number of the segment.
+    //! \param index true for index file, false for data file.
+    //! \return path of the file.
+    inline std::string segment_path(const std::string& dir, std::uint32_t segment, bool index)
+    {
+        std::ostringstream ss;
+        ss << dir << "/games-" << std::setw(6) << std::setfill('0') << segment << (index ? ".idx" : ".dat");
+        return ss.str();
+    }
+
+    //! Appends unsigned integer as LEB128 varint.
+    //! \param out string to append to.
+    //! \param value value to write.
+    inline void put_varint(std::string& out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    //! Appends little endian integer of fixed size.
+    //! \param out string to append to.
+    //! \param value value to write.
+    //! \param bytes number of bytes.
+    inline void put_fixed(std::string& out, std::uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i)
+            out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+
+    //! Reads LEB128 varint.
+    //! \param pos position to read from, moved past the varint.
+    //! \param end end of readable data.
+    //! \param value read value.
+    //! \return true on success, false if the data are truncated.
+    inline bool get_varint(const unsigned char*& pos, const unsigned char* end, std::uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && pos < end; shift += 7)
+        {
+            unsigned char c = *pos++;
+            value |= static_cast<std::uint64_t>(c & 0x7f) << shift;
+            if (!(c & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    //! Reads little endian integer of fixed size.
+    //! \param pos position to read from.
+    //! \param bytes number of bytes.
+    //! \return read value.
+    inline std::uint64_t get_fixed(const unsigned char* pos, int bytes)
+    {
+        std::uint64_t res = 0;
+        for (int i = 0; i < bytes; ++i)
+            res |= static_cast<std::uint64_t>(pos[i]) << (8 * i);
+        return res;
+    }
+
+    //! Encodes record.
+    //! \param rec record to encode.
+    //! \param out string to append to.
+    inline void encode(const record& rec, std::string& out)
+    {
+        out.push_back(static_cast<char>(rec.flags));
+        put_varint(out, rec.player);
+        put_varint(out, rec.start);
+        put_varint(out, rec.duration);
+        if (rec.flags & WON)
+            put_varint(out, rec.won_at);
+        put_fixed(out, rec.seed, 4);
+        if (rec.flags & RESUMED)
+        {
+            out.append(reinterpret_cast<const char*>(rec.start_blocks.data()), rec.start_blocks.size());
+            put_varint(out, rec.start_score);
+        }
+        put_varint(out, rec.final_score);
+        out.push_back(static_cast<char>(rec.max_block));
+        put_varint(out, rec.moves);
+        out.append(reinterpret_cast<const char*>(rec.packed.data()), rec.packed.size());
+    }
+
+    //! Decodes record.
+    //! \param data encoded record.
+    //! \param length length of \a data.
+    //! \param rec decoded record.
+    //! \return true on success, false if the data are corrupted.
+    inline bool decode(const unsigned char* data, std::size_t length, record& rec)
+    {
+        const unsigned char* pos = data;
+        const unsigned char* end = data + length;
+        std::uint64_t player, start, duration, won_at = 0, start_score = 0, final_score, moves;
+        if (pos == end)
+            return false;
+        rec.flags = *pos++;
+        if (!get_varint(pos, end, player) || !get_varint(pos, end, start) || !get_varint(pos, end, duration)
+            || ((rec.flags & WON) && !get_varint(pos, end, won_at)) || end - pos < 4)
+            return false;
+        rec.seed = static_cast<std::uint32_t>(get_fixed(pos, 4));
+        pos += 4;
+        if (rec.flags & RESUMED)
+        {
+            if (static_cast<std::size_t>(end - pos) < rec.start_blocks.size())
+                return false;
+            std::copy(pos, pos + rec.start_blocks.size(), rec.start_blocks.begin());
+            pos += rec.start_blocks.size();
+            if (!get_varint(pos, end, start_score))
+                return false;
+        }
+        if (!get_varint(pos, end, final_score) || pos == end)
+            return false;
+        unsigned char max_block = *pos++;
+        if (max_block >= MAX_BLOCKS || !get_varint(pos, end, moves) || static_cast<std::uint64_t>(end - pos) != (moves + 3) / 4)
+            return false;
+        rec.player = static_cast<std::uint32_t>(player);
+        rec.start = start;
+        rec.duration = static_cast<std::uint32_t>(duration);
+        rec.won_at = static_cast<std::uint32_t>(won_at);
+        rec.start_score = static_cast<std::uint32_t>(start_score);
+        rec.final_score = static_cast<std::uint32_t>(final_score);
+        rec.max_block = static_cast<Blocks>(max_block);
+        rec.moves = static_cast<std::uint32_t>(moves);
+        rec.packed.assign(pos, end);
+        return true;
+    }
+
+    //! Seeds the board and sets starting position of the game.
+    //! \param rec the game.
+    //! \param b board to set, it ends in the position before first move of the game.
+    //! \return true on success, false if stored starting position is corrupted.
+    inline bool start(const record& rec, board& b)
+    {
+        b.seed(rec.seed);
+        if (!(rec.flags & RESUMED))
+        {
+            b.restart();
+            return true;
+        }
+        for (std::size_t i = 0; i < rec.start_blocks.size(); ++i)
+        {
+            if (rec.start_blocks[i] >= MAX_BLOCKS)
+                return false;
+            b.set(i / BLOCK_COUNT_Y, i % BLOCK_COUNT_Y, static_cast<Blocks>(rec.start_blocks[i]));
+        }
+        b.set_score(rec.start_score);
+        b.set_won((rec.flags & START_WON) != 0);
+        return true;
+    }
+
+    //! Checks, that replayed game ended as recorded.
+    //! \param rec the game.
+    //! \param b board after all moves of the game.
+    //! \return true if the board has recorded final score and max block, false otherwise.
+    inline bool finished(const record& rec, const board& b)
+    {
+        return static_cast<std::uint32_t>(b.score()) == rec.final_score && b.max_block() == rec.max_block;
+    }
+
+    //! Replays the game from its seed.
+    //! \param rec the game.
+    //! \param b board to play on, it ends in the final position of the game.
+    //! \return true if the replay reached recorded final score and max block, false otherwise.
+    inline bool replay(const record& rec, board& b)
+    {
+        if (!start(rec, b))
+            return false;
+        for (std::uint32_t i = 0; i < rec.moves; ++i)
+            b.play(rec.move(i));
+        return finished(rec, b);
+    }
+}
+
+/**!
+    \ingroup common
+    \brief Appends records into segments of game archive.
+
+    Each run starts a new segment after the existing ones, so an interrupted segment is never appended to.
+    Segment is replaced by next one, when it grows over its size limit.
+    \sa game_archive
+*/
+class archive_writer
+{
+    public:
+        //! Opens first unused segment in the archive.
+        //! \param dir existing directory of the archive.
+        //! \param segment_bytes size, after which next segment is started.
+        //! \throws std::runtime_error if the segment can not be created.
+        archive_writer(const std::string& dir, std::uint64_t segment_bytes) : m_dir(dir), m_segment_bytes(segment_bytes), m_segment(0), m_offset(0)
+        {
+            std::uint32_t segment = 1;
+            while (std::ifstream(game_archive::segment_path(m_dir, segment, false)))
+                ++segment;
+            open(segment);
+        }
+
+        //! Appends game into the archive.
+        //! \param rec the game.
+        //! \param time unix time of end of the game, not earlier than of previous game.
+        void write(const game_archive::record& rec, std::uint64_t time)
+        {
+            if (m_offset >= m_segment_bytes)
+                open(m_segment + 1);
+            m_buffer.clear();
+            game_archive::encode(rec, m_buffer);
+            std::string prefix;
+            game_archive::put_varint(prefix, m_buffer.size());
+            m_data.write(prefix.data(), prefix.size());
+            m_data.write(m_buffer.data(), m_buffer.size());
+            m_offset += prefix.size();
+
+            std::string entry;
+            game_archive::put_fixed(entry, rec.player, 4);
+            game_archive::put_fixed(entry, m_buffer.size(), 4);
+            game_archive::put_fixed(entry, m_offset, 8);
+            game_archive::put_fixed(entry, time, 8);
+            m_index.write(entry.data(), entry.size());
+            m_offset += m_buffer.size();
+        }
+
+        //! Flushes buffered records. Data are flushed before index, so index never points past written data.
+        void flush()
+        {
+            m_data.flush();
+            m_index.flush();
+        }
+
+    private:
+        //! Closes current segment and creates new one.
+        //! \param segment number of the new segment.
+        void open(std::uint32_t segment)
+        {
+            flush();
+            m_data.close();
+            m_index.close();
+            m_data.clear();
+            m_index.clear();
+            m_segment = segment;
+            m_data.open(game_archive::segment_path(m_dir, segment, false), std::ios::binary | std::ios::trunc);
+            m_index.open(game_archive::segment_path(m_dir, segment, true), std::ios::binary | std::ios::trunc);
+            if (m_data.fail() || m_index.fail())
+                throw std::runtime_error("Failed to create archive segment '" + game_archive::segment_path(m_dir, segment, false) + "'.");
+            m_data.write(game_archive::MAGIC, sizeof(game_archive::MAGIC));
+            m_offset = sizeof(game_archive::MAGIC);
+        }
+
+        std::string m_dir; //!< Directory of the archive.
+        std::uint64_t m_segment_bytes; //!< Size, after which next segment is started.
+        std::uint32_t m_segment; //!< Number of current segment.
+        std::uint64_t m_offset; //!< Size of current segment.
+        std::ofstream m_data; //!< Data file of current segment.
+        std::ofstream m_index; //!< Index file of current segment.
+        std::string m_buffer; //!< Encoded record, kept to reuse its memory.
+};
+
+/**!
+    \ingroup common
+    \brief Memory mapped segment of game archive.
+
+    Records are decoded straight from the mapping, so reading a game costs no I/O beyond page faults
+    and segments larger than memory are paged by the operating system.
+    \sa game_archive, archive_reader
+*/
+class archive_segment
+{
+    public:
+        //! Maps segment and reads its index. Index entries pointing past the data (of interrupted writes) are ignored.
+        //! Segment without flushed header (just started by the server) has no records.
+        //! \param dir directory of the archive.
+        //! \param segment number of the segment.
+        //! \throws std::runtime_error if the segment can not be opened or is not a segment.
+        archive_segment(const std::string& dir, std::uint32_t segment) : m_data(nullptr), m_size(0)
+        {
+            std::string path = game_archive::segment_path(dir, segment, false);
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file)
+                throw std::runtime_error("Failed to open archive segment '" + path + "'.");
+            if (file.tellg() < static_cast<std::streamoff>(sizeof(game_archive::MAGIC)))
+                return;
+            try
+            {
+                m_file = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+                m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::read_only);
+            }
+            catch (boost::interprocess::interprocess_exception&)
+            {
+                throw std::runtime_error("Failed to map archive segment '" + path + "'.");
+            }
+            m_data = static_cast<const unsigned char*>(m_region.get_address());
+            m_size = m_region.get_size();
+            if (m_size < sizeof(game_archive::MAGIC) || std::memcmp(m_data, game_archive::MAGIC, sizeof(game_archive::MAGIC)) != 0)
+                throw std::runtime_error("'" + path + "' is not an archive segment.");
+
+            std::ifstream index(game_archive::segment_path(dir, segment, true), std::ios::binary);
+            unsigned char buf[game_archive::INDEX_ENTRY_SIZE];
+            while (index.read(reinterpret_cast<char*>(buf), sizeof(buf)))
+            {
+                game_archive::index_entry entry;
+                entry.player = static_cast<std::uint32_t>(game_archive::get_fixed(buf, 4));
+                entry.length = static_cast<std::uint32_t>(game_archive::get_fixed(buf + 4, 4));
+                entry.offset = game_archive::get_fixed(buf + 8, 8);
+                entry.time = game_archive::get_fixed(buf + 16, 8);
+                if (entry.offset + entry.length > m_size)
+                    break;
+                m_entries.push_back(entry);
+            }
+        }
+
+        //! Gets number of records.
+        //! \return number of indexed records.
+        std::size_t size() const { return m_entries.size(); }
+
+        //! Gets index entry of a record.
+        //! \param i index of the record.
+        //! \return the entry.
+        const game_archive::index_entry& entry(std::size_t i) const { return m_entries[i]; }
+
+        //! Decodes a record.
+        //! \param i index of the record.
+        //! \param rec decoded record.
+        //! \return true on success, false if the record is corrupted.
+        bool get(std::size_t i, game_archive::record& rec) const { return game_archive::decode(m_data + m_entries[i].offset, m_entries[i].length, rec); }
+
+        //! Finds first record, which ended at or after given time.
+        //! \param time unix time.
+        //! \return index of the record, \ref size if there is none.
+        std::size_t lower_bound(std::uint64_t time) const
+        {
+            return std::lower_bound(m_entries.begin(), m_entries.end(), time,
+                [](const game_archive::index_entry& e, std::uint64_t t) { return e.time < t; }) - m_entries.begin();
+        }
+
+    private:
+        boost::interprocess::file_mapping m_file; //!< Mapped data file.
+        boost::interprocess::mapped_region m_region; //!< Mapping of whole data file.
+        const unsigned char* m_data; //!< Beginning of the mapping.
+        std::size_t m_size; //!< Size of the mapping.
+        std::vector<game_archive::index_entry> m_entries; //!< Index of the segment.
+};
+
+/**!
+    \ingroup common
+    \brief Random access to all games of the archive by player and time.
+
+    Segments are mapped, when first accessed. Index of players is built on first lookup by player.
+    \sa game_archive, archive_segment
+*/
+class archive_reader
+{
+    public:
+        //! Finds segments of the archive.
+        //! \param dir directory of the archive.
+        explicit archive_reader(const std::string& dir) : m_dir(dir), m_indexed(false)
+        {
+            for (std::uint32_t segment = 1; std::ifstream(game_archive::segment_path(m_dir, segment, false)); ++segment)
+                m_segments.emplace_back();
+        }
+
+        //! Gets number of segments.
+        //! \return number of segments.
+        std::uint32_t segments() const { return static_cast<std::uint32_t>(m_segments.size()); }
+
+        //! Gets segment, maps it on first access.
+        //! \param segment 1-based number of the segment.
+        //! \return the segment.
+        //! \throws std::runtime_error if the segment can not be mapped.
+        const archive_segment& segment(std::uint32_t segment)
+        {
+            std::unique_ptr<archive_segment>& res = m_segments.at(segment - 1);
+            if (!res)
+                res.reset(new archive_segment(m_dir, segment));
+            return *res;
+        }
+
+        //! Decodes a record.
+        //! \param loc location of the record.
+        //! \param rec decoded record.
+        //! \return true on success, false if the record is corrupted.
+        bool get(const game_archive::location& loc, game_archive::record& rec) { return segment(loc.segment).get(loc.index, rec); }
+
+        //! Gets all games of a player.
+        //! \param player id of the player.
+        //! \return locations of the games ordered by time.
+        const std::vector<game_archive::location>& by_player(std::uint32_t player)
+        {
+            static const std::vector<game_archive::location> none;
+            if (!m_indexed)
+            {
+                for (std::uint32_t s = 1; s <= segments(); ++s)
+                    for (std::size_t i = 0; i < segment(s).size(); ++i)
+                        m_players[segment(s).entry(i).player].push_back(game_archive::location{ s, static_cast<std::uint32_t>(i) });
+                m_indexed = true;
+            }
+            auto it = m_players.find(player);
+            return it != m_players.end() ? it->second : none;
+        }
+
+        //! Gets games, which ended in time range.
+        //! \param from unix time of beginning of the range.
+        //! \param to unix time of end of the range (excluded).
+        //! \return locations of the games ordered by time.
+        std::vector<game_archive::location> by_time(std::uint64_t from, std::uint64_t to)
+        {
+            std::vector<game_archive::location> res;
+            for (std::uint32_t s = 1; s <= segments(); ++s)
+                for (std::size_t i = segment(s).lower_bound(from); i < segment(s).size() && segment(s).entry(i).time < to; ++i)
+                    res.push_back(game_archive::location{ s, static_cast<std::uint32_t>(i) });
+            return res;
+        }
+
+    private:
+        std::string m_dir; //!< Directory of the archive.
+        std::vector<std::unique_ptr<archive_segment>> m_segments; //!< Segments, nullptr until mapped.
+        std::unordered_map<std::uint32_t, std::vector<game_archive::location>> m_players; //!< Games of each player.
+        bool m_indexed; //!< Indicates, that \ref m_players was built.
+};
@@ -1,10 +1,11 @@
 #pragma once
 #include <string>
+#include <cstdint>
 #include <algorithm>
 
 /**!
     \ingroup common
-    \brief Class providing hashing function used in password hashing.
+    \brief Class providing hashing function used in password hashing and hashing of boards.
 
     The sipher used is simple ceasar sipher with right shift of \ref SHIFT. Somehing like
     SHA-x would be more useful, but for testing purposes, it suffices.
@@ -23,6 +24,20 @@ class hasher
             return std::move(result);
         }
 
+        //! Hashes serialized board, so client and server can compare boards without sending them.
+        //! \param rects blocks serialized as by player_data::serialize_rects.
+        //! \return 64-bit FNV-1a hash of the blocks in decimal.
+        static std::string board(const std::string& rects)
+        {
+            std::uint64_t hash = 14695981039346656037ULL;
+            for (char c : rects)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ULL;
+            }
+            return std::to_string(hash);
+        }
+
     private:
         const static int SHIFT = +5; //!< Caesar sipher shift.
 };
@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+/**!
+    \ingroup common
+    \brief Latency histogram with log-linear (HDR-like) buckets.
+
+    Values below \ref SUB_BUCKETS are stored exactly, bigger values are stored in buckets
+    of relative width 1 / \ref SUB_BUCKETS (about 3% precision), which covers everything
+    from microseconds to days in a fixed amount of memory.
+    Buckets are relaxed atomics, so one thread can record while other one merges.
+*/
+class histogram
+{
+    public:
+        static const int SUB_BUCKET_BITS = 5; //!< Bits of precision inside power of two.
+        static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS; //!< Buckets per power of two.
+        static const int MAX_SHIFT = 40; //!< Biggest supported power of two above \ref SUB_BUCKETS.
+        static const int BUCKETS = SUB_BUCKETS + (MAX_SHIFT + 1) * SUB_BUCKETS; //!< Total number of buckets.
+
+        //! Constructs empty histogram.
+        histogram() { reset(); }
+
+        //! Records single value.
+        //! \param value value to record.
+        void record(std::uint64_t value)
+        {
+            m_buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+            m_sum.fetch_add(value, std::memory_order_relaxed);
+            std::uint64_t max = m_max.load(std::memory_order_relaxed);
+            while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+        }
+
+        //! Adds all values recorded in \a other into this histogram.
+        //! \param other histogram to merge.
+        void merge(const histogram& other)
+        {
+            for (int i = 0; i < BUCKETS; ++i)
+                if (std::uint64_t val = other.m_buckets[i].load(std::memory_order_relaxed))
+                    m_buckets[i].fetch_add(val, std::memory_order_relaxed);
+            m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            std::uint64_t max = other.m_max.load(std::memory_order_relaxed);
+            if (max > m_max.load(std::memory_order_relaxed))
+                m_max.store(max, std::memory_order_relaxed);
+        }
+
+        //! Clears all recorded values.
+        void reset()
+        {
+            for (auto& bucket : m_buckets)
+                bucket.store(0, std::memory_order_relaxed);
+            m_sum.store(0, std::memory_order_relaxed);
+            m_max.store(0, std::memory_order_relaxed);
+        }
+
+        //! Gets number of recorded values.
+        //! \return number of recorded values.
+        std::uint64_t count() const
+        {
+            std::uint64_t res = 0;
+            for (const auto& bucket : m_buckets)
+                res += bucket.load(std::memory_order_relaxed);
+            return res;
+        }
+
+        //! Gets mean of recorded values.
+        //! \return mean of recorded values, 0 if empty.
+        double mean() const
+        {
+            std::uint64_t cnt = count();
+            return cnt ? static_cast<double>(m_sum.load(std::memory_order_relaxed)) / cnt : 0.0;
+        }
+
+        //! Gets maximal recorded value.
+        //! \return maximal recorded value.
+        std::uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+
+        //! Gets value at given percentile.
+        //! \param percentile percentile in range <0, 100>.
+        //! \return upper bound of the bucket containing requested percentile.
+        std::uint64_t percentile(double percentile) const
+        {
+            std::uint64_t cnt = count();
+            if (!cnt)
+                return 0;
+            std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0 * cnt + 0.5);
+            if (rank < 1)
+                rank = 1;
+            std::uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; ++i)
+            {
+                seen += m_buckets[i].load(std::memory_order_relaxed);
+                if (seen >= rank)
+                    return std::min(upper_bound(i), max());
+            }
+            return max();
+        }
+
+    private:
+        //! Computes position of most significant bit.
+        //! \param value non-zero value.
+        //! \return index of the highest set bit.
+        static int msb(std::uint64_t value)
+        {
+#ifdef __GNUC__
+            return 63 - __builtin_clzll(value);
+#else
+            int res = 0;
+            while (value >>= 1)
+                ++res;
+            return res;
+#endif
+        }
+
+        //! Computes bucket index for given value.
+        //! \param value value to be recorded.
+        //! \return index into \ref m_buckets.
+        static int index(std::uint64_t value)
+        {
+            if (value < static_cast<std::uint64_t>(SUB_BUCKETS))
+                return static_cast<int>(value);
+            int shift = msb(value) - SUB_BUCKET_BITS;
+            if (shift > MAX_SHIFT)
+                return BUCKETS - 1;
+            return SUB_BUCKETS + shift * SUB_BUCKETS + static_cast<int>((value >> shift) - SUB_BUCKETS);
+        }
+
+        //! Computes highest value, which falls into given bucket.
+        //! \param index index of the bucket.
+        //! \return highest value of the bucket.
+        static std::uint64_t upper_bound(int index)
+        {
+            if (index < SUB_BUCKETS)
+                return index;
+            int shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+            std::uint64_t mantissa = SUB_BUCKETS + (index - SUB_BUCKETS) % SUB_BUCKETS;
+            return ((mantissa + 1) << shift) - 1;
+        }
+
+        std::array<std::atomic<std::uint64_t>, BUCKETS> m_buckets; //!< Bucket counters.
+        std::atomic<std::uint64_t> m_sum; //!< Sum of recorded values.
+        std::atomic<std::uint64_t> m_max; //!< Maximal recorded value.
+};
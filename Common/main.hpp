@@ -9,6 +9,7 @@
 #include <tuple>
 #include <cmath>
 #include <memory>
+#include <random>
 
 class stats;
 using coords = std::pair<int, int>;
@@ -80,6 +81,36 @@ namespace message_types
 
     static const std::string MSG_RESTART = "RES-"; //!< Restart request.
     static const std::string MSG_RESTART_OK = MSG_RESTART + "OK"; //!< Restart processed ok.
+
+    static const std::string MSG_SEED = "SED-"; //!< Request to seed random generator of the session (used by replay).
+    static const std::string MSG_SEED_OK = MSG_SEED + "OK"; //!< Seed was set.
+    static const std::string MSG_SEED_FAIL = MSG_SEED + "FAIL"; //!< Seeding is not allowed by server configuration.
+
+    static const std::string MSG_HEARTBEAT = "HBT-"; //!< Heartbeat carrying last measured round trip time in microseconds.
+    static const std::string MSG_HEARTBEAT_OK = MSG_HEARTBEAT + "OK"; //!< Heartbeat answered.
+
+    static const std::string MSG_THROTTLE = "THR-"; //!< Response to rate limited request carrying milliseconds, after which it may be repeated.
+
+    static const std::string MSG_LEADERBOARD = "LDB-"; //!< Leaderboard request.
+    static const std::string MSG_LEADERBOARD_TOP = MSG_LEADERBOARD + "TOP+"; //!< Request of best K results, followed by board name, '+' and K.
+    static const std::string MSG_LEADERBOARD_RANK = MSG_LEADERBOARD + "RANK+"; //!< Request of player's own rank, followed by board name.
+    static const std::string MSG_LEADERBOARD_OK = MSG_LEADERBOARD + "OK"; //!< Leaderboard response, followed by '+' and number of ranked players and '+rank value name' records.
+    static const std::string MSG_LEADERBOARD_FAIL = MSG_LEADERBOARD + "FAIL"; //!< Unknown board or invalid count.
+
+    static const std::string MSG_SPECTATE = "SPE-"; //!< Spectator messages.
+    static const std::string MSG_SPECTATE_WATCH = MSG_SPECTATE + "WATCH+"; //!< Request to watch game of player, followed by his name.
+    static const std::string MSG_SPECTATE_STOP = MSG_SPECTATE + "STOP"; //!< Request to stop watching.
+    static const std::string MSG_SPECTATE_OK = MSG_SPECTATE + "OK"; //!< Watching started or stopped.
+    static const std::string MSG_SPECTATE_FAIL = MSG_SPECTATE + "FAIL"; //!< Player is not online.
+    static const std::string MSG_SPECTATE_SNAPSHOT = MSG_SPECTATE + "SNAP+"; //!< Board of watched player, followed by serialized board, '+', won status and '+' and score.
+    static const std::string MSG_SPECTATE_EVENT = MSG_SPECTATE + "EVT+"; //!< Move of watched player, followed by serialized \ref play_event.
+    static const std::string MSG_SPECTATE_END = MSG_SPECTATE + "END"; //!< Watched player left.
+
+    static const std::string MSG_TOKEN = "TOK-"; //!< Request of token for resuming the session, logged players only.
+    static const std::string MSG_TOKEN_OK = MSG_TOKEN + "OK"; //!< Token issued, followed by '+' and the token.
+    static const std::string MSG_RESUME = "RSM-"; //!< Request to resume session after reconnect, followed by token, '+' board hash (see \ref hasher::board) and '+' score.
+    static const std::string MSG_RESUME_OK = MSG_RESUME + "OK"; //!< Session resumed, followed by '+' new token, '+' board hash and '+' score, then by '+' board and '+' won status, if they differ from the client's.
+    static const std::string MSG_RESUME_FAIL = MSG_RESUME + "FAIL"; //!< Unknown or expired token.
 };
 
 //! Namespace containing text direction used when client reqests play process.
@@ -91,10 +122,19 @@ namespace directions
     static const std::string DOWN = "DOWN"; //!< Down direction.
 }
 
+//! Namespace containing names of leaderboards used in leaderboard requests.
+namespace leaderboards
+{
+    static const std::string SCORE = "score"; //!< Highest score.
+    static const std::string MAX_BLOCK = "block"; //!< Maximal block.
+    static const std::string FASTEST_WIN = "fastest"; //!< Fastest win in seconds.
+}
+
 static const std::string PORT = "8881"; //!< Default port to connect to (and host server on).
 static const std::string HOST = "server.ekirei.cz"; //!< Default host to connect to.
 
 static const std::size_t SECONDS_UNTIL_TIMEOUT = 10; //!< Seconds until \ref connection_timed exception occurs.
+static const std::size_t SECONDS_BETWEEN_HEARTBEATS = 15; //!< Seconds between heartbeats sent by the client, server's idle timeout has to be longer.
 
 static const std::size_t BLOCK_COUNT_X = 4; //!< Number of Blocks in X coord.
 static const std::size_t BLOCK_COUNT_Y = 4; //!< Number of Blocks in Y coord.
@@ -163,6 +203,12 @@ inline std::vector<std::string> split(const std::string& str, char delim)
 //! \return True if chance happened, false otherwise.
 inline bool chance(int c) { return std::rand() % 100 < c; }
 
+//! Simulates rolling of <0, 100> chance using given generator, so the result is reproducible for given seed.
+//! \param c Chance to simulate.
+//! \param engine random generator to use.
+//! \return True if chance happened, false otherwise.
+inline bool chance(int c, std::mt19937& engine) { return static_cast<int>(engine() % 100) < c; }
+
 //! Computes 2 to the power of argument.
 //! \param block exponent of pow function.
 //! \return Result of the computation.
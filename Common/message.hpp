@@ -54,7 +54,7 @@ class message
 
         //! Setter for body length to <em>min(new_length, MAX_BODY_LENGTH)</em>.
         //! \param new_length Desired length of the body of the message.
-        void body_length(size_t new_length) { m_body_length = m_body_length > MAX_BODY_LENGTH ? MAX_BODY_LENGTH : new_length; }
+        void body_length(size_t new_length) { m_body_length = new_length > MAX_BODY_LENGTH ? MAX_BODY_LENGTH : new_length; }
 
         //! Decodes the header and sets appropriately body lenght.
         //! \return true if succeeded, false otherwise.